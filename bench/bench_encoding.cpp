@@ -0,0 +1,97 @@
+//
+// Compare the size and the loading time of the Json text and binary encodings of a number-heavy resource
+//
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <sys/stat.h>
+
+#include <reader.h>
+#include <writer.h>
+
+using reven::jsonresource::Metadata;
+using reven::jsonresource::MetadataWriter;
+using reven::jsonresource::Reader;
+using reven::jsonresource::ReaderOptions;
+using reven::jsonresource::ResourceEncoding;
+using reven::jsonresource::Writer;
+using reven::jsonresource::WriterOptions;
+
+namespace {
+
+class BenchMDWriter : MetadataWriter {
+public:
+	static Metadata md()
+	{
+		return write(42, "1.0.0", "BenchEncoding", "1.0.0", "Benchmark", 42424242);
+	}
+};
+
+pt::ptree generate(std::size_t records)
+{
+	pt::ptree json;
+	auto& jrecords = json.add_child("records", pt::ptree());
+	std::uint64_t state = 42;
+	for (std::size_t i = 0; i < records; ++i) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		pt::ptree record;
+		record.put("address", std::to_string(state >> 16));
+		record.put("size", std::to_string(state % 4096));
+		record.put("delta", std::to_string(static_cast<std::int64_t>(state % 2001) - 1000));
+		record.put("name", "record");
+		jrecords.push_back(pt::ptree::value_type("", record));
+	}
+	return json;
+}
+
+std::uint64_t file_size(const std::string& filename)
+{
+	struct stat st;
+	return ::stat(filename.c_str(), &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+}
+
+void run(const char* name, const std::string& filename, std::size_t iterations, bool memory_map)
+{
+	std::size_t checksum = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < iterations; ++i) {
+		checksum += Reader::open(filename.c_str(), ReaderOptions{memory_map}).json().size();
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << name << (memory_map ? " (mmap)" : "") << ": "
+	          << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / iterations << " us/load, "
+	          << file_size(filename) << " bytes" << (checksum == 0 ? " (unexpected checksum)" : "") << "\n";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t records = argc > 1 ? std::stoul(argv[1]) : 100000;
+	const std::size_t iterations = argc > 2 ? std::stoul(argv[2]) : 5;
+
+	const std::string json_file = "bench_encoding.json";
+	const std::string binary_file = "bench_encoding.cbor";
+
+	{
+		auto json = generate(records);
+		Writer::create(json, std::make_unique<std::ofstream>(json_file), BenchMDWriter::md());
+
+		WriterOptions options;
+		options.encoding = ResourceEncoding::cbor;
+		Writer::create(std::move(json), std::make_unique<std::ofstream>(binary_file), BenchMDWriter::md(), options);
+	}
+
+	for (const bool memory_map : {false, true}) {
+		run("json", json_file, iterations, memory_map);
+		run("cbor", binary_file, iterations, memory_map);
+	}
+
+	std::remove(json_file.c_str());
+	std::remove(binary_file.c_str());
+}
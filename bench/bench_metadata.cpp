@@ -0,0 +1,134 @@
+//
+// Compare the table-driven metadata decoding and encoding with lookups of each field by its path
+//
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include <metadata.h>
+
+using reven::jsonresource::CustomMetadata;
+using reven::jsonresource::Metadata;
+using reven::jsonresource::MetadataWriter;
+
+namespace {
+
+class BenchMDWriter : MetadataWriter {
+public:
+	static Metadata md(const CustomMetadata& custom_metadata)
+	{
+		return write(42, "1.0.0", "BenchMetadataWriter", "1.0.0", "Benchmark", 42424242, custom_metadata);
+	}
+};
+
+//! Field values, filled the way metadata were read before the field table
+struct PathFields {
+	std::uint32_t metadata_version;
+	std::uint32_t type;
+	std::string format_version;
+	std::string tool_version;
+	std::string tool_name;
+	std::string tool_info;
+	std::uint64_t generation_date;
+	CustomMetadata custom_metadata;
+};
+
+PathFields read_by_path(const pt::ptree& json)
+{
+	PathFields fields;
+	fields.metadata_version = json.get<std::uint32_t>("metadata.metadata_version");
+	fields.type = json.get<std::uint32_t>("metadata.type");
+	fields.format_version = json.get<std::string>("metadata.format_version");
+	fields.tool_version = json.get<std::string>("metadata.tool_version");
+	fields.tool_name = json.get<std::string>("metadata.tool_name");
+	fields.tool_info = json.get<std::string>("metadata.tool_info");
+	fields.generation_date = json.get<std::uint64_t>("metadata.generation_date");
+	const auto custom_metadata = json.get_child_optional("metadata.custom");
+	if (custom_metadata) {
+		for (const auto& custom : *custom_metadata) {
+			fields.custom_metadata.emplace(custom.first, custom.second.data());
+		}
+	}
+	return fields;
+}
+
+void write_by_path(const PathFields& fields, pt::ptree& json)
+{
+	pt::ptree jmetadata;
+	jmetadata.put("metadata_version", fields.metadata_version);
+	jmetadata.put("type", fields.type);
+	jmetadata.put("format_version", fields.format_version);
+	jmetadata.put("tool_version", fields.tool_version);
+	jmetadata.put("tool_name", fields.tool_name);
+	jmetadata.put("tool_info", fields.tool_info);
+	jmetadata.put("generation_date", fields.generation_date);
+	if (not fields.custom_metadata.empty()) {
+		pt::ptree jcustom_metadata;
+		for (const auto& custom : fields.custom_metadata) {
+			jcustom_metadata.put(custom.first, custom.second);
+		}
+		jmetadata.add_child("custom", jcustom_metadata);
+	}
+	json.push_front(pt::ptree::value_type("metadata", jmetadata));
+}
+
+template <typename Function>
+void run(const char* name, std::size_t iterations, Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < iterations; ++i) {
+		function();
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << name << ": "
+	          << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations << " ns/op\n";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+	CustomMetadata custom_metadata;
+	for (int i = 0; i < 8; ++i) {
+		custom_metadata.emplace("key" + std::to_string(i), "value" + std::to_string(i));
+	}
+
+	for (const auto& md : {BenchMDWriter::md({}), BenchMDWriter::md(custom_metadata)}) {
+		std::cout << "custom metadata: " << md.custom_metadata().size() << "\n";
+
+		pt::ptree json;
+		md.write_metadata(json);
+		// Members after the metadata, that path lookups don't have to go through but that keep the tree realistic
+		for (int i = 0; i < 16; ++i) {
+			json.put("member" + std::to_string(i), i);
+		}
+
+		std::size_t checksum = 0;
+		run("  decode by path", iterations, [&]() {
+			checksum += read_by_path(json).tool_name.size();
+		});
+		run("  decode by table", iterations, [&]() {
+			checksum += Metadata::read_metadata(json).tool_name().size();
+		});
+
+		const auto fields = read_by_path(json);
+		run("  encode by path", iterations, [&]() {
+			pt::ptree out;
+			write_by_path(fields, out);
+			checksum += out.size();
+		});
+		run("  encode by table", iterations, [&]() {
+			pt::ptree out;
+			md.write_metadata(out);
+			checksum += out.size();
+		});
+
+		if (checksum == 0) {
+			std::cout << "unexpected checksum\n";
+		}
+	}
+}
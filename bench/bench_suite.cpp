@@ -0,0 +1,411 @@
+//
+// Measure the read, write and metadata paths on synthetic resources, to compare runs against a baseline.
+//
+// Usage: bench_suite [--sizes=1K,1M] [--shapes=flat,deep,wide,custom] [--ops=reader_open,...] [--iterations=N]
+//                    [--directory=DIR]
+//
+// Each measurement is written to the standard output as one Json object per line, with the throughput in MB/s, the
+// latency percentiles in microseconds, the number of allocations per operation and the peak resident set size of
+// the process so far.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <reader.h>
+#include <writer.h>
+
+using reven::jsonresource::CustomMetadata;
+using reven::jsonresource::Metadata;
+using reven::jsonresource::MetadataWriter;
+using reven::jsonresource::Reader;
+using reven::jsonresource::ReaderOptions;
+using reven::jsonresource::Writer;
+
+namespace {
+
+std::atomic<std::uint64_t> allocation_count{0};
+
+}
+
+void* operator new(std::size_t size)
+{
+	++allocation_count;
+	if (void* ptr = std::malloc(size != 0 ? size : 1)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace {
+
+class BenchMDWriter : MetadataWriter {
+public:
+	static Metadata md(const CustomMetadata& custom_metadata = {})
+	{
+		return write(42, "1.0.0", "BenchSuite", "1.0.0", "Benchmark", 42424242, custom_metadata);
+	}
+};
+
+///
+/// Writer of the content of a synthetic resource, streamed to the file so the size is not bounded by the memory
+///
+class Generator {
+public:
+	Generator(std::ostream& out, std::uint64_t size) : out_(out), size_(size) {}
+
+	//! Top-level members with string values
+	void flat()
+	{
+		write("{");
+		for (std::uint64_t i = 0; remaining(); ++i) {
+			write(i == 0 ? "" : ",");
+			write("\n    \"member" + std::to_string(i) + "\": \"" + value() + "\"");
+		}
+		write("\n}\n");
+	}
+
+	//! Array of objects nested `depth` levels deep
+	void deep(std::size_t depth = 32)
+	{
+		write("{\n    \"records\": [");
+		for (std::uint64_t i = 0; remaining(); ++i) {
+			write(i == 0 ? "" : ",");
+			for (std::size_t level = 0; level < depth; ++level) {
+				write("{\"level" + std::to_string(level) + "\":");
+			}
+			write("\"" + value() + "\"");
+			write(std::string(depth, '}'));
+		}
+		write("]\n}\n");
+	}
+
+	//! Arrays of many small numbers
+	void wide(std::size_t width = 4096)
+	{
+		write("{\n    \"arrays\": [");
+		for (std::uint64_t i = 0; remaining(); ++i) {
+			write(i == 0 ? "[" : ",[");
+			for (std::size_t element = 0; element < width and remaining(); ++element) {
+				write((element == 0 ? "" : ",") + std::to_string(next() % 100000));
+			}
+			write("]");
+		}
+		write("]\n}\n");
+	}
+
+	//! Custom metadata of about `size` bytes, the content only has one member
+	static CustomMetadata custom(std::uint64_t size)
+	{
+		std::vector<CustomMetadata::value_type> entries;
+		for (std::uint64_t i = 0; i * 32 < size; ++i) {
+			entries.emplace_back("key" + std::to_string(i), "value" + std::to_string(i));
+		}
+		return CustomMetadata(std::move(entries));
+	}
+
+	void single_member()
+	{
+		write("{\n    \"member\": \"0\"\n}\n");
+	}
+
+private:
+	bool remaining() const { return written_ < size_; }
+
+	void write(const std::string& text)
+	{
+		out_ << text;
+		written_ += text.size();
+	}
+
+	std::uint64_t next()
+	{
+		state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+		return state_ >> 16;
+	}
+
+	std::string value()
+	{
+		return "value" + std::to_string(next());
+	}
+
+	std::ostream& out_;
+	std::uint64_t size_;
+	std::uint64_t written_ = 0;
+	std::uint64_t state_ = 42;
+};
+
+//! Generate a resource of the shape, with about `size` bytes of content
+void generate(const std::string& filename, const std::string& shape, std::uint64_t size)
+{
+	{
+		std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+		Generator generator(out, size);
+		if (shape == "flat") {
+			generator.flat();
+		} else if (shape == "deep") {
+			generator.deep();
+		} else if (shape == "wide") {
+			generator.wide();
+		} else if (shape == "custom") {
+			generator.single_member();
+		} else {
+			throw std::invalid_argument("unknown shape " + shape);
+		}
+		if (not out) {
+			throw std::runtime_error("can't write " + filename);
+		}
+	}
+
+	// The metadata are streamed in, the generated content is never loaded
+	Writer::inject_metadata(filename.c_str(), BenchMDWriter::md(shape == "custom" ? Generator::custom(size)
+	                                                                              : CustomMetadata{}));
+}
+
+std::uint64_t file_size(const std::string& filename)
+{
+	struct stat st;
+	return ::stat(filename.c_str(), &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+}
+
+std::uint64_t parse_size(const std::string& text)
+{
+	std::size_t end = 0;
+	auto size = std::stoull(text, &end);
+	switch (end < text.size() ? text[end] : ' ') {
+	case 'G': size *= 1024;
+	// fallthrough
+	case 'M': size *= 1024;
+	// fallthrough
+	case 'K': size *= 1024;
+	default: break;
+	}
+	return size;
+}
+
+std::vector<std::string> split(const std::string& text)
+{
+	std::vector<std::string> items;
+	std::istringstream input(text);
+	for (std::string item; std::getline(input, item, ',');) {
+		if (not item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+std::uint64_t peak_rss_kb()
+{
+	struct rusage usage;
+	return ::getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<std::uint64_t>(usage.ru_maxrss) : 0;
+}
+
+//! Output stream that only counts the bytes written to it, so the measures don't depend on the disk
+class CountingStream : public std::ostream {
+public:
+	CountingStream() : std::ostream(&buffer_) {}
+
+	std::uint64_t count() const { return buffer_.count; }
+
+private:
+	struct CountingBuffer : std::streambuf {
+		int_type overflow(int_type c) override
+		{
+			++count;
+			return traits_type::not_eof(c);
+		}
+
+		std::streamsize xsputn(const char*, std::streamsize size) override
+		{
+			count += static_cast<std::uint64_t>(size);
+			return size;
+		}
+
+		std::uint64_t count = 0;
+	};
+
+	CountingBuffer buffer_;
+};
+
+struct Measure {
+	std::string shape;
+	std::uint64_t size;
+	std::string op;
+};
+
+///
+/// Run the operation and print its measurement. The operation returns the number of bytes it processed.
+///
+void run(const Measure& measure, std::size_t iterations, const std::function<std::uint64_t()>& op)
+{
+	std::vector<double> latencies;
+	latencies.reserve(iterations);
+	std::uint64_t bytes = 0;
+
+	const auto allocations_before = allocation_count.load();
+	for (std::size_t i = 0; i < iterations; ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		bytes += op();
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		latencies.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+	}
+	const auto allocations = allocation_count.load() - allocations_before;
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&latencies](double p) {
+		return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()))];
+	};
+	double total = 0;
+	for (const auto latency : latencies) {
+		total += latency;
+	}
+
+	char line[512];
+	std::snprintf(line, sizeof(line),
+	              "{\"shape\": \"%s\", \"size\": %llu, \"op\": \"%s\", \"iterations\": %zu, \"mb_per_s\": %.3f, "
+	              "\"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f, "
+	              "\"allocations_per_op\": %llu, \"peak_rss_kb\": %llu}",
+	              measure.shape.c_str(), static_cast<unsigned long long>(measure.size), measure.op.c_str(), iterations,
+	              total > 0 ? static_cast<double>(bytes) / total : 0.0, percentile(0.5), percentile(0.9),
+	              percentile(0.99), latencies.back(), static_cast<unsigned long long>(allocations / iterations),
+	              static_cast<unsigned long long>(peak_rss_kb()));
+	std::cout << line << std::endl;
+}
+
+bool selected(const std::vector<std::string>& ops, const std::string& op)
+{
+	return ops.empty() or std::find(ops.begin(), ops.end(), op) != ops.end();
+}
+
+void bench(const std::string& filename, const Measure& resource, std::size_t iterations,
+           const std::vector<std::string>& ops)
+{
+	const auto size = file_size(filename);
+	auto measure = [&resource](const char* op) { return Measure{resource.shape, resource.size, op}; };
+
+	if (selected(ops, "reader_open")) {
+		run(measure("reader_open"), iterations, [&]() {
+			Reader::open(filename.c_str());
+			return size;
+		});
+	}
+	if (selected(ops, "reader_open_mmap")) {
+		ReaderOptions options;
+		options.memory_map = true;
+		run(measure("reader_open_mmap"), iterations, [&]() {
+			Reader::open(filename.c_str(), options);
+			return size;
+		});
+	}
+	if (selected(ops, "metadata_deserialize")) {
+		run(measure("metadata_deserialize"), iterations, [&]() {
+			std::ifstream input(filename, std::ios::binary);
+			Metadata::deserialize(input);
+			return size;
+		});
+	}
+
+	const auto writer_ops = {"writer_create", "writer_set_metadata", "metadata_ostream"};
+	if (std::none_of(writer_ops.begin(), writer_ops.end(), [&ops](const char* op) { return selected(ops, op); })) {
+		return;
+	}
+
+	auto reader = Reader::open(filename.c_str());
+	const auto md = reader.metadata();
+	pt::ptree content = reader.json();
+	content.erase("metadata");
+
+	auto written = [](Writer& writer) { return static_cast<CountingStream&>(*writer.output_stream()).count(); };
+
+	if (selected(ops, "writer_create")) {
+		run(measure("writer_create"), iterations, [&]() {
+			auto writer = Writer::create(content, std::make_unique<CountingStream>(), md);
+			return written(writer);
+		});
+	}
+	if (selected(ops, "writer_set_metadata")) {
+		auto writer = Writer::create(content, std::make_unique<CountingStream>(), md);
+		run(measure("writer_set_metadata"), iterations, [&]() {
+			const auto before = written(writer);
+			writer.set_metadata(md);
+			return written(writer) - before;
+		});
+	}
+	if (selected(ops, "metadata_ostream")) {
+		run(measure("metadata_ostream"), iterations, [&]() {
+			std::ostringstream out;
+			out << md;
+			return static_cast<std::uint64_t>(out.tellp());
+		});
+	}
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> sizes = {"1K", "64K", "1M"};
+	std::vector<std::string> shapes = {"flat", "deep", "wide", "custom"};
+	std::vector<std::string> ops;
+	std::size_t iterations = 10;
+	std::string directory = ".";
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const auto value = arg.substr(arg.find('=') + 1);
+		if (arg.compare(0, 8, "--sizes=") == 0) {
+			sizes = split(value);
+		} else if (arg.compare(0, 9, "--shapes=") == 0) {
+			shapes = split(value);
+		} else if (arg.compare(0, 6, "--ops=") == 0) {
+			ops = split(value);
+		} else if (arg.compare(0, 13, "--iterations=") == 0) {
+			iterations = std::max<std::size_t>(1, std::stoul(value));
+		} else if (arg.compare(0, 12, "--directory=") == 0) {
+			directory = value;
+		} else {
+			std::cerr << "unknown argument " << arg << "\n";
+			return 1;
+		}
+	}
+
+	try {
+		for (const auto& shape : shapes) {
+			for (const auto& size : sizes) {
+				const auto filename = directory + "/bench_suite_" + shape + "_" + size + ".json";
+				generate(filename, shape, parse_size(size));
+				bench(filename, Measure{shape, parse_size(size), ""}, iterations, ops);
+				std::remove(filename.c_str());
+			}
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "error: " << e.what() << "\n";
+		return 1;
+	}
+}
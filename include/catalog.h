@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "metadata.h"
+
+namespace reven {
+namespace jsonresource {
+
+///
+/// Exception that occurs when a catalog can't be built, read or written
+///
+class CatalogError : public std::runtime_error {
+public:
+	CatalogError(const char* msg) : std::runtime_error(msg) {}
+};
+
+///
+/// Metadata of a resource of a catalog, and the state of its file when they were read
+///
+struct CatalogEntry {
+	//! Path of the resource, relative to the scanned directory
+	std::string path;
+	std::uint64_t size;
+	//! Last modification time, in nanoseconds since the epoch
+	std::int64_t mtime;
+	Metadata metadata;
+};
+
+///
+/// File of a scanned tree that is not a resource or can't be read, or directory that can't be listed, and the state
+/// of the file when it was read
+///
+struct CatalogFailure {
+	//! Path of the file, relative to the scanned directory
+	std::string path;
+	std::uint64_t size;
+	//! Last modification time, in nanoseconds since the epoch
+	std::int64_t mtime;
+};
+
+///
+/// Options to scan a directory tree
+///
+struct CatalogOptions {
+	//! Number of threads reading the resources, 0 to use one per hardware thread
+	std::size_t threads = 0;
+
+	//! Only the files with this extension are read, empty to read all the files
+	std::string extension = ".json";
+};
+
+///
+/// Result of a scan
+///
+struct CatalogScan {
+	//! Resources whose metadata were read
+	std::size_t read = 0;
+	//! Resources that did not change since the previous scan, whose metadata were kept
+	std::size_t kept = 0;
+	//! Files that are not resources or can't be read, and directories that can't be listed. They are recorded apart
+	//! from the entries.
+	std::size_t failed = 0;
+	//! Files that failed at the previous scan and did not change since, they are not read again
+	std::size_t skipped = 0;
+	//! Resources and failures of the previous scan that no longer exist
+	std::size_t removed = 0;
+};
+
+///
+/// Catalog of the metadata of the resources of a directory tree.
+/// The catalog is saved as a compact Json file, so the resources can be listed and filtered without being opened.
+///
+class Catalog {
+public:
+	//! Build an empty catalog, use `scan` to fill it
+	Catalog() = default;
+
+	///
+	/// \brief load Load a catalog saved with `save`
+	/// \throws CatalogError if the file can't be read, is not a catalog, or lists entries before its version
+	static Catalog load(const char* filename);
+
+	///
+	/// \brief save Write the catalog to the file, that is atomically replaced
+	/// \throws CatalogError if the file can't be written
+	void save(const char* filename) const;
+
+	///
+	/// \brief scan Read the metadata of the resources of the directory tree with a pool of threads
+	/// Only the metadata are read, see `Reader::peek_metadata`. Resources whose size and modification time did not
+	/// change since the previous scan are not read again, so rescanning a loaded catalog is incremental. The same
+	/// goes for the files that are not resources, that are recorded as failures. Subdirectories that can't be listed
+	/// are recorded as failures too, and the rest of the tree is scanned.
+	/// \param directory The root of the tree, paths of the entries are relative to it
+	/// \throws CatalogError if the directory can't be listed
+	CatalogScan scan(const char* directory, const CatalogOptions& options = {});
+
+	//! Entries of the catalog, sorted by path
+	const std::vector<CatalogEntry>& entries() const { return entries_; }
+
+	//! Files of the tree that are not resources and directories that can't be listed, sorted by path
+	const std::vector<CatalogFailure>& failures() const { return failures_; }
+
+	//! Return the entry of the resource, or nullptr if it is not part of the catalog
+	const CatalogEntry* find(const std::string& path) const;
+
+	//! Return the entries whose metadata satisfy the predicate
+	template <typename Predicate>
+	std::vector<const CatalogEntry*> select(Predicate predicate) const
+	{
+		std::vector<const CatalogEntry*> result;
+		for (const auto& entry : entries_) {
+			if (predicate(entry.metadata)) {
+				result.push_back(&entry);
+			}
+		}
+		return result;
+	}
+
+private:
+	std::vector<CatalogEntry> entries_;
+	std::vector<CatalogFailure> failures_;
+};
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+
+namespace reven {
+namespace jsonresource {
+
+///
+/// Raw Metadata class that contains the metadata in the format stored and retrieved by the reader.
+/// It is not meant to be used directly by clients, instead use converters that give a semantics to the metadata
+///
+/// The entries are stored contiguously and sorted by key, so they are always iterated, and thus serialized, in the
+/// same order. Keys are looked up without building a string.
+/// Like a map, the values can be modified through the iterators. Unlike a map, the key of an entry is not const
+/// but must not be modified, as the entries would no longer be sorted.
+///
+class CustomMetadata {
+public:
+	using value_type = std::pair<std::string /* key */, std::string /* value */>;
+	using iterator = std::vector<value_type>::iterator;
+	using const_iterator = std::vector<value_type>::const_iterator;
+
+	CustomMetadata() = default;
+
+	//! Build from entries in any order. When a key is repeated, its first entry is kept.
+	CustomMetadata(std::vector<value_type> entries);
+	CustomMetadata(std::initializer_list<value_type> entries) : CustomMetadata(std::vector<value_type>(entries)) {}
+
+	//! Insert the entry if the key is not already present, and return its position and whether it was inserted.
+	//! Insertion is linear in the number of entries, build from a vector to add many entries at once.
+	std::pair<iterator, bool> emplace(std::string key, std::string value);
+	std::pair<iterator, bool> insert(value_type entry)
+	{
+		return emplace(std::move(entry.first), std::move(entry.second));
+	}
+
+	//! Return the value of the key, inserting an empty value if the key is not present
+	std::string& operator[](std::string key) { return emplace(std::move(key), std::string()).first->second; }
+
+	//! Position of the entry of the key, or `end()`
+	iterator find(boost::string_view key);
+	const_iterator find(boost::string_view key) const;
+
+	//! \throws std::out_of_range if the key is not present
+	std::string& at(boost::string_view key);
+	const std::string& at(boost::string_view key) const;
+
+	std::size_t count(boost::string_view key) const { return find(key) != end() ? 1 : 0; }
+
+	std::size_t size() const { return entries_.size(); }
+	bool empty() const { return entries_.empty(); }
+
+	iterator begin() { return entries_.begin(); }
+	iterator end() { return entries_.end(); }
+	const_iterator begin() const { return entries_.begin(); }
+	const_iterator end() const { return entries_.end(); }
+
+	bool operator==(const CustomMetadata& other) const { return entries_ == other.entries_; }
+	bool operator!=(const CustomMetadata& other) const { return entries_ != other.entries_; }
+
+private:
+	iterator lower_bound(boost::string_view key);
+
+	std::vector<value_type> entries_;
+};
+
+}} // namespace reven::jsonresource
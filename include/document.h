@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include "format.h"
+
+namespace pt = boost::property_tree;
+
+namespace reven {
+namespace jsonresource {
+
+///
+/// Type of the value of a leaf of a Document
+///
+enum class ValueType : std::uint8_t {
+	//! Written as a Json string, and the only type of the values read from a ptree
+	string,
+	unsigned_integer,
+	signed_integer,
+	floating,
+	boolean,
+	null,
+	//! A Json number that does not fit the native types, such as 1e400 or an integer of more than 64 bits
+	number,
+};
+
+namespace detail {
+
+//! Value of a leaf that is not a string, stored along with its Json text
+union NativeValue {
+	std::uint64_t unsigned_integer;
+	std::int64_t signed_integer;
+	double floating;
+	bool boolean;
+};
+
+//! Native type in which values of type T are stored
+template <typename T>
+using NativeType = typename std::conditional<std::is_same<T, bool>::value, bool,
+                   typename std::conditional<std::is_floating_point<T>::value, double,
+                   typename std::conditional<std::is_signed<T>::value, std::int64_t, std::uint64_t>::type>::type>::type;
+
+//! Whether the native value can be converted to T without overflow
+template <typename T>
+bool fits(std::uint64_t value) { return value <= std::numeric_limits<T>::max(); }
+template <typename T>
+bool fits(std::int64_t value)
+{
+	return value >= std::numeric_limits<T>::min() and value <= std::numeric_limits<T>::max();
+}
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value, bool>::type fits(double value)
+{
+	// Infinities and NaN are represented in all the floating types
+	return not std::isfinite(value) or
+	       (value >= std::numeric_limits<T>::lowest() and value <= std::numeric_limits<T>::max());
+}
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, bool>::type fits(double value)
+{
+	// Unlike the maximum of 64-bit integers, 2^digits is exactly represented by a double
+	const double bound = std::ldexp(1.0, std::numeric_limits<T>::digits);
+	return std::trunc(value) == value and value < bound and value >= (std::is_signed<T>::value ? -bound : 0.0);
+}
+template <typename T>
+bool fits(bool) { return true; }
+
+struct NodeData {
+	boost::string_view key;
+	boost::string_view data;
+
+	ValueType type = ValueType::string;
+	NativeValue value = {0};
+
+	NodeData* first_child = nullptr;
+	NodeData* last_child = nullptr;
+	NodeData* next = nullptr;
+	std::size_t size = 0;
+};
+
+///
+/// Monotonic allocator: memory is taken from big blocks and only released all at once
+///
+class Arena {
+public:
+	Arena() = default;
+	Arena(Arena&& other) noexcept { *this = std::move(other); }
+	Arena& operator=(Arena&& other) noexcept;
+
+	void* allocate(std::size_t size, std::size_t alignment);
+
+	//! Copy the string in the arena
+	boost::string_view store(boost::string_view str);
+
+	//! Total size of the blocks owned by the arena
+	std::size_t allocated_bytes() const { return allocated_bytes_; }
+
+private:
+	std::vector<std::unique_ptr<char[]>> blocks_;
+	char* current_ = nullptr;
+	std::size_t remaining_ = 0;
+	std::size_t allocated_bytes_ = 0;
+};
+
+} // namespace detail
+
+class Document;
+
+///
+/// Handle on a node of a Document.
+/// Follows the conventions of pt::ptree: a node has either a data or children, and children with empty keys are
+/// array elements. Unlike in a ptree, a data can also be a number, a boolean or null, that is written without quotes.
+/// Handles are only valid as long as the Document they come from.
+///
+class DocumentNode {
+public:
+	class const_iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = DocumentNode;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = DocumentNode;
+
+		const_iterator(Document* doc, detail::NodeData* node) : doc_(doc), node_(node) {}
+
+		DocumentNode operator*() const { return DocumentNode(doc_, node_); }
+		const_iterator& operator++() { node_ = node_->next; return *this; }
+		const_iterator operator++(int) { auto it = *this; ++*this; return it; }
+		bool operator==(const const_iterator& other) const { return node_ == other.node_; }
+		bool operator!=(const const_iterator& other) const { return node_ != other.node_; }
+
+	private:
+		Document* doc_;
+		detail::NodeData* node_;
+	};
+
+	boost::string_view key() const { return node_->key; }
+
+	//! The Json text of the value, without quotes for strings
+	boost::string_view data() const { return node_->data; }
+
+	ValueType type() const { return node_->type; }
+
+	bool empty() const { return node_->first_child == nullptr; }
+	std::size_t size() const { return node_->size; }
+
+	const_iterator begin() const { return {doc_, node_->first_child}; }
+	const_iterator end() const { return {doc_, nullptr}; }
+
+	//! Replace the data of the node by a string
+	void put_value(boost::string_view value);
+
+	//! Replace the data of the node by a number or a boolean, stored natively and written without quotes
+	template <typename T>
+	typename std::enable_if<std::is_arithmetic<T>::value>::type put_value(T value)
+	{
+		put_native(static_cast<detail::NativeType<T>>(value));
+	}
+
+	//! Replace the data of the node by null
+	void put_null();
+
+	//! Replace the data of the node by a Json number that keeps its text, so it is written back unchanged. The number
+	//! is also stored natively when it fits one of the native types, otherwise its type is `ValueType::number`.
+	//! \throws std::runtime_error if the text is not a Json number
+	void put_number(boost::string_view text);
+
+	///
+	/// \brief get_value_optional Return the value converted to T, or none if it can't be represented in T
+	/// Native values are converted without parsing. Strings, such as numbers quoted in the Json, are parsed without
+	/// allocation and independently of the locale.
+	template <typename T>
+	typename std::enable_if<std::is_arithmetic<T>::value, boost::optional<T>>::type get_value_optional() const
+	{
+		detail::NativeType<T> value;
+		if (not get_native(value) or not detail::fits<T>(value)) {
+			return boost::none;
+		}
+		return static_cast<T>(value);
+	}
+
+	//! Append a child, use an empty key to append an array element
+	DocumentNode push_back(boost::string_view key);
+
+	//! Prepend a child, use an empty key to prepend an array element
+	DocumentNode push_front(boost::string_view key);
+
+	//! Append a child with the data passed in parameter
+	DocumentNode put(boost::string_view key, boost::string_view value);
+
+	//! Append a deep copy of the ptree
+	DocumentNode add_child(boost::string_view key, const pt::ptree& json);
+
+	//! Copy the data and append a deep copy of the children of the ptree
+	void assign(const pt::ptree& json);
+
+	//! Return the first child with the key passed in parameter
+	boost::optional<DocumentNode> get_child_optional(boost::string_view key) const;
+
+	//! Remove the children with the key passed in parameter and return how many were removed
+	std::size_t erase(boost::string_view key);
+
+	//! Build a ptree that is a deep copy of the node
+	pt::ptree to_ptree() const;
+
+private:
+	DocumentNode(Document* doc, detail::NodeData* node) : doc_(doc), node_(node) {}
+
+	detail::NodeData* new_child(boost::string_view key);
+
+	void put_native(std::uint64_t value);
+	void put_native(std::int64_t value);
+	void put_native(double value);
+	void put_native(bool value);
+
+	bool get_native(std::uint64_t& value) const;
+	bool get_native(std::int64_t& value) const;
+	bool get_native(double& value) const;
+	bool get_native(bool& value) const;
+
+	Document* doc_;
+	detail::NodeData* node_;
+
+	friend class Document;
+};
+
+///
+/// Mutable Json document whose nodes and strings are allocated in an arena.
+/// Building a document makes few big allocations instead of one per node and per string, and all the memory is
+/// released in one step when the document is destroyed.
+///
+class Document {
+public:
+	//! Build an empty document, that does not allocate until a node is added
+	Document() = default;
+
+	Document(Document&& other) noexcept;
+	Document& operator=(Document&& other) noexcept;
+
+	Document(const Document&) = delete;
+	Document& operator=(const Document&) = delete;
+
+	///
+	/// \brief read_json Build a document from a Json input, with the conventions of `pt::read_json`
+	/// Numbers, booleans and null keep their type.
+	/// \throws std::runtime_error if the input is malformed
+	static Document read_json(std::istream& input);
+
+	//! Build a document that is a deep copy of the ptree
+	static Document from_ptree(const pt::ptree& json);
+
+	//! Build a ptree that is a deep copy of the document
+	pt::ptree to_ptree() const;
+
+	//! Build a deep copy of the document in a new arena, without going through a ptree
+	Document copy() const;
+
+	DocumentNode root() { return DocumentNode(this, &root_); }
+
+	//! Total size of the memory blocks owned by the document
+	std::size_t allocated_bytes() const { return arena_.allocated_bytes(); }
+
+private:
+	detail::Arena arena_;
+	detail::NodeData root_;
+
+	friend class DocumentNode;
+	friend void write_json(std::ostream& out, const Document& doc, const OutputFormat& format);
+};
+
+///
+/// \brief write_json Write the document to the stream, with the same output as `pt::write_json`
+/// Except that values that are not strings are written without quotes.
+/// \param format The layout of the output
+/// \throws std::runtime_error if the document can't be represented in Json or if the stream fails
+void write_json(std::ostream& out, const Document& doc, const OutputFormat& format = {});
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <boost/optional.hpp>
+
+namespace reven {
+namespace jsonresource {
+
+///
+/// Reason why a resource or its metadata can't be read. Each code matches an exception of the throwing API.
+///
+enum class ErrorCode {
+	none,
+	//! `ReaderError`: the file can't be opened or its content is malformed
+	read_error,
+	//! `ReadMetadataError`: the input of the metadata is malformed
+	read_metadata_error,
+	//! `MissingMetadata`
+	missing_metadata,
+	//! `MissingMetadataVersion`
+	missing_metadata_version,
+	//! `IncompatibleMetadataVersion`
+	incompatible_metadata_version,
+	//! `MissingMetadataField`
+	missing_metadata_field,
+	//! `BadMetadataField`
+	bad_metadata_field,
+};
+
+///
+/// Error returned by the non-throwing API. It only holds the details of the error, its message is built on demand.
+///
+class ResourceError {
+public:
+	ResourceError() = default;
+
+	ErrorCode code() const { return code_; }
+
+	//! Build the message of the error, that is the message of the matching exception
+	std::string message() const;
+
+	//! Throw the exception that the throwing API would have thrown
+	[[noreturn]] void raise() const;
+
+private:
+	ResourceError(ErrorCode code, std::string detail = {}) : code_(code), detail_(std::move(detail)) {}
+
+	ErrorCode code_ = ErrorCode::none;
+
+	//! Message of the parser for read errors
+	std::string detail_;
+
+	//! Name of the field or of the type that can't be decoded, in static storage
+	const char* name_ = nullptr;
+
+	//! Version of incompatible metadata
+	std::uint32_t version_ = 0;
+
+	friend class Metadata;
+	friend class Reader;
+};
+
+///
+/// Either a value or the error that prevented to build it
+///
+template <typename T>
+class Expected {
+public:
+	Expected(T&& value) : value_(std::move(value)) {}
+	Expected(const ResourceError& error) : error_(error) {}
+
+	bool has_value() const { return bool(value_); }
+	explicit operator bool() const { return has_value(); }
+
+	//! Return the value
+	//! \throws The exception of the error if there is no value
+	T& value()
+	{
+		if (not value_) {
+			error_.raise();
+		}
+		return *value_;
+	}
+
+	T& operator*() { return *value_; }
+	const T& operator*() const { return *value_; }
+	T* operator->() { return value_.get_ptr(); }
+	const T* operator->() const { return value_.get_ptr(); }
+
+	//! The error, whose code is `ErrorCode::none` if there is a value
+	const ResourceError& error() const { return error_; }
+
+private:
+	boost::optional<T> value_;
+	ResourceError error_;
+};
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+namespace reven {
+namespace jsonresource {
+
+///
+/// Layout of a serialized resource
+///
+struct OutputFormat {
+	//! Number of spaces written after the metadata object.
+	//! They are reserved so that a later update of the metadata can be written in place.
+	std::size_t metadata_padding = 0;
+
+	//! Number of spaces per nesting level
+	std::size_t indent = 4;
+
+	//! Write everything on a single line, without indentation
+	bool compact = false;
+};
+
+namespace detail {
+
+struct FormatManipulator {
+	OutputFormat format;
+};
+
+std::ostream& operator<<(std::ostream& stream, const FormatManipulator& manipulator);
+
+}
+
+///
+/// Stream manipulator selecting the format used by `operator<<(std::ostream&, const Metadata&)` on this stream.
+///
+/// Example:
+///
+/// ```cpp
+/// OutputFormat format;
+/// format.compact = true;
+/// std::cout << set_format(format) << md;
+/// ```
+inline detail::FormatManipulator set_format(const OutputFormat& format)
+{
+	return detail::FormatManipulator{format};
+}
+
+//! Return the format selected on the stream with `set_format`, or the default format
+OutputFormat get_format(std::ios_base& stream);
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Immutable value shared through a process-wide pool: all the live handles on equal values point to the same
+/// instance. Copying a handle copies a pointer, and equal handles are found by comparing pointers.
+/// A value is removed from the pool when its last handle is destroyed.
+///
+/// The pool is instantiated for `std::string` and `CustomMetadata`.
+///
+template <typename T>
+class Interned {
+public:
+	//! The empty value, that is not stored in the pool
+	Interned() = default;
+
+	//! Return the handle of the value in the pool, that is added if it is not already there
+	explicit Interned(T value);
+
+	const T& get() const { return ptr_ ? *ptr_ : empty(); }
+
+	//! Two live values are equal only if they are the same instance of the pool
+	bool operator==(const Interned& other) const { return ptr_ == other.ptr_; }
+	bool operator!=(const Interned& other) const { return ptr_ != other.ptr_; }
+
+private:
+	static const T& empty();
+
+	std::shared_ptr<const T> ptr_;
+};
+
+}}} // namespace reven::jsonresource::detail
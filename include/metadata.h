@@ -2,11 +2,16 @@
 
 #include <cstdint>
 #include <string>
-#include <unordered_map>
 #include <stdexcept>
 #include <ostream>
 
 #include <boost/property_tree/json_parser.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include "custom_metadata.h"
+#include "error.h"
+#include "format.h"
+#include "interned.h"
 
 namespace pt = boost::property_tree;
 
@@ -77,36 +82,63 @@ public:
 	IncompatibleMetadataVersion(const char* msg) : ReadMetadataError(msg) {}
 };
 
-///
-/// Raw Metadata class that contains the metadata in the format stored and retrieved by the reader.
-/// It is not meant to be used directly by clients, instead use converters that give a semantics to the metadata
-///
-using CustomMetadata = std::unordered_map<std::string /* key */, std::string /* value */>;
+namespace detail {
+//! Whether the metadata field is written as a Json number
+bool is_number_field(boost::string_view name);
+}
 
 class Metadata {
 public:
-	static Metadata deserialize(std::istream& input);
+	///
+	/// \brief deserialize Read a whole resource and return its metadata
+	/// \param input The stream to read
+	/// \param rewind Whether to read the stream from its beginning. Otherwise it is consumed from its current position
+	/// without ever being seeked, which allows to read pipes, sockets or decompressors.
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static Metadata deserialize(std::istream& input, bool rewind = true);
+
+	///
+	/// \brief peek Read the metadata of a resource without parsing the whole document
+	/// The input is scanned up to the end of the "metadata" object, other values are skipped without being built.
+	/// Binary resources are detected and read transparently.
+	/// \param input The stream to read
+	/// \param rewind Whether to read the stream from its beginning, or from its current position without seeking it
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static Metadata peek(std::istream& input, bool rewind = true);
+
 	static Metadata read_metadata(pt::ptree& json);
 
+	///
+	/// \brief try_deserialize Same as `deserialize`, but return the error instead of throwing it
+	/// Invalid metadata are reported without any exception, and the message of the error is only built if requested.
+	static Expected<Metadata> try_deserialize(std::istream& input, bool rewind = true);
+
+	//! Same as `peek`, but return the error instead of throwing it
+	static Expected<Metadata> try_peek(std::istream& input, bool rewind = true);
+
+	//! Same as `read_metadata`, but return the error instead of throwing it
+	static Expected<Metadata> try_read_metadata(const pt::ptree& json);
+
 public:
 	/// Magic representing the resource type
 	std::uint32_t type() const { return type_; }
 	/// A version for the resource file format (should be of format "x.y.z-suffix" with an optional suffix)
-	const std::string& format_version() const { return format_version_; }
+	const std::string& format_version() const { return format_version_.get(); }
 	/// Name of the tool that generated the resource
-	const std::string& tool_name() const { return tool_name_; }
+	const std::string& tool_name() const { return tool_name_.get(); }
 	/// A version for the tool that generated the resource (should be of format "x.y.z-suffix" with an optional suffix)
-	const std::string& tool_version() const { return tool_version_; }
+	const std::string& tool_version() const { return tool_version_.get(); }
 	/// The version of the tool and possibly the version of the writer library used
-	const std::string& tool_info() const { return tool_info_; }
+	const std::string& tool_info() const { return tool_info_.get(); }
 	/// The date of the generation
 	std::uint64_t generation_date() const { return generation_date_; }
 
-	const CustomMetadata& custom_metadata() const { return custom_metadata_; }
+	const CustomMetadata& custom_metadata() const { return custom_metadata_.get(); }
 
 	void write_metadata(pt::ptree& json) const;
-	void serialize(pt::ptree& json, std::ostream& out) const;
+	void serialize(pt::ptree& json, std::ostream& out, const OutputFormat& format = {}) const;
 
+	//! The strings and the custom metadata are interned, so they are compared by identity
 	bool operator==(const Metadata& md) const
 	{
 		return type_ == md.type_ and format_version_ == md.format_version_ and tool_name_ == md.tool_name_
@@ -118,24 +150,35 @@ private:
 	// General clients are not expected to be able to build Metadata
 	Metadata() = default;
 
+	// Table of the fields, used to read and write them
+	struct Fields;
+
+	//! Decode the metadata of the resource, return false and set the error if they are not valid.
+	//! The throwing and non-throwing API both validate the metadata with it.
+	static bool decode_metadata(const pt::ptree& json, Metadata& md, ResourceError& error);
+
 	std::uint32_t type_;
-	std::string format_version_;
-	std::string tool_name_;
-	std::string tool_version_;
-	std::string tool_info_;
+	// Shared with all the metadata holding the same values, so that copying metadata does not copy strings
+	detail::Interned<std::string> format_version_;
+	detail::Interned<std::string> tool_name_;
+	detail::Interned<std::string> tool_version_;
+	detail::Interned<std::string> tool_info_;
 	std::uint64_t generation_date_;
-	CustomMetadata custom_metadata_;
+	detail::Interned<CustomMetadata> custom_metadata_;
 
 	// Special class that is allowed to build Metadata
 	friend class MetadataWriter;
 	// Special permission for Reader to build Metadata
 	friend class Reader;
+	// Reads the field table
+	friend bool detail::is_number_field(boost::string_view name);
 };
 
+//! Write the metadata as a Json resource, in the format selected on the stream with `set_format`
 inline std::ostream& operator<<(std::ostream& stream, const Metadata& md)
 {
 	pt::ptree json;
-	md.serialize(json, stream);
+	md.serialize(json, stream, get_format(stream));
 	return stream;
 }
 
@@ -169,12 +212,12 @@ protected:
 	                      std::uint64_t generation_date, const CustomMetadata& custom_metadata={}) {
 		Metadata md;
 		md.type_ = type;
-		md.format_version_ = std::move(format_version);
-		md.tool_name_ = std::move(tool_name);
-		md.tool_version_ = std::move(tool_version);
-		md.tool_info_ = std::move(tool_info);
+		md.format_version_ = detail::Interned<std::string>(std::move(format_version));
+		md.tool_name_ = detail::Interned<std::string>(std::move(tool_name));
+		md.tool_version_ = detail::Interned<std::string>(std::move(tool_version));
+		md.tool_info_ = detail::Interned<std::string>(std::move(tool_info));
 		md.generation_date_ = generation_date;
-		md.custom_metadata_ = custom_metadata;
+		md.custom_metadata_ = detail::Interned<CustomMetadata>(custom_metadata);
 		return md;
 	}
 };
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <exception>
 #include <istream>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include <boost/optional.hpp>
 #include <boost/property_tree/json_parser.hpp>
+#include <boost/utility/string_view.hpp>
 
 #include "metadata.h"
+#include "stats.h"
 
 namespace pt = boost::property_tree;
 
@@ -20,6 +26,55 @@ public:
 	ReaderError(const char* msg) : std::runtime_error(msg) {}
 };
 
+namespace detail {
+class MappedFile;
+}
+
+///
+/// Instruction set used to locate the structural characters when parsing a Json resource.
+/// A level that the processor doesn't support is lowered to the best supported one.
+///
+enum class SimdLevel {
+	//! The best level supported by the processor
+	automatic,
+	//! Portable code, one byte at a time
+	scalar,
+	sse2,
+	avx2,
+};
+
+///
+/// Options to open a resource from a file
+///
+struct ReaderOptions {
+	//! Map the file read-only in memory and parse the document directly from the mapped bytes
+	bool memory_map = false;
+
+	//! Only used when reading a stream: whether to read it from its beginning. Otherwise the stream is consumed from
+	//! its current position without ever being seeked, which allows to read pipes, sockets or decompressors.
+	bool rewind = true;
+
+	//! Instruction set of the Json parser. All the levels build the same document, this only matters for speed.
+	SimdLevel simd = SimdLevel::automatic;
+};
+
+///
+/// Options to open a batch of resources, see `Reader::open_many`
+///
+struct OpenManyOptions {
+	//! How each file is accessed
+	ReaderOptions reader;
+
+	//! Number of threads parsing the resources, 0 to use one per hardware thread
+	std::size_t threads = 0;
+
+	//! Return the results in the order of the paths. Otherwise, they are returned in the order they complete.
+	bool keep_order = true;
+};
+
+struct ReaderResult;
+class QueryResult;
+
 ///
 /// A Reader of Json resource
 ///
@@ -32,14 +87,120 @@ public:
 	/// \throws MetadataError if an error occurs during the reading the metadata
 	static Reader open(const char* filename);
 
+	///
+	/// \brief open Open a resource from the filename passed in parameter
+	/// \param filename The filename of the resource to open
+	/// \param options How the file is accessed
+	/// \throws ReaderError if an error occurs during the reading of the file
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static Reader open(const char* filename, const ReaderOptions& options);
+
 	///
 	/// \brief open Open a resource from a stream passed in parameter
+	/// Binary (see `ResourceEncoding::cbor`) and compressed resources are detected and read transparently.
 	/// \param stream The stream to read
 	/// \throws ReaderError if an error occurs during the reading of the stream
 	/// \throws MetadataError if an error occurs during the reading the metadata
 	static Reader open(std::istream& stream);
 
+	///
+	/// \brief open Open a resource from a stream passed in parameter
+	/// \param stream The stream to read
+	/// \param options Whether the stream is rewound before being read
+	/// \throws ReaderError if an error occurs during the reading of the stream
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static Reader open(std::istream& stream, const ReaderOptions& options);
+
+	///
+	/// \brief try_open Same as `open`, but return the error instead of throwing it
+	/// The metadata are validated by the same code as `open`, and invalid metadata are reported without any
+	/// exception. The message of the error is only built if requested.
+	/// \param filename The filename of the resource to open
+	/// \param options How the file is accessed
+	static Expected<Reader> try_open(const char* filename, const ReaderOptions& options = {});
+
+	//! Same as `open`, but return the error instead of throwing it
+	static Expected<Reader> try_open(std::istream& stream, const ReaderOptions& options = {});
+
+	///
+	/// \brief peek_metadata Read only the metadata of the resource from the filename passed in parameter
+	/// The rest of the document is not parsed, which makes it cheap even on big resources. Compressed resources are
+	/// only decompressed up to the end of the metadata.
+	/// \param filename The filename of the resource to read
+	/// \throws ReaderError if the file can't be opened
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static Metadata peek_metadata(const char* filename);
+
+	///
+	/// \brief open_section Open only the metadata and one top-level key of a resource
+	/// When the resource has an up-to-date sidecar index (see `WriterOptions::write_index`), only the requested
+	/// subtree is parsed. Otherwise, the whole resource is parsed.
+	/// \param filename The filename of the resource to open
+	/// \param key The top-level key to read, absent from `json()` if the resource doesn't contain it
+	/// \throws ReaderError if an error occurs during the reading of the file
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static Reader open_section(const char* filename, const std::string& key);
+
+	///
+	/// \brief open_elements Open only the metadata and a range of elements of a top-level array of a resource
+	/// When the resource has an up-to-date sidecar index, only the chunks containing the elements are parsed.
+	/// Otherwise, the whole resource is parsed.
+	/// \param filename The filename of the resource to open
+	/// \param key The top-level key of the array
+	/// \param first The index of the first element to read
+	/// \param count The maximum number of elements to read
+	/// \throws ReaderError if an error occurs during the reading of the file
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static Reader open_elements(const char* filename, const std::string& key, std::uint64_t first,
+	                            std::uint64_t count);
+
+	///
+	/// \brief open_many Open resources concurrently on a bounded pool of threads
+	/// An error on a resource doesn't stop the others, it is returned in the result of the resource.
+	/// \param paths The filenames of the resources to open
+	/// \param options How the files are accessed, how many threads parse them and the order of the results
+	/// \return One result per path
+	static std::vector<ReaderResult> open_many(const std::vector<std::string>& paths,
+	                                           const OpenManyOptions& options = {});
+
+	///
+	/// \brief query Read the value referenced by a JSON Pointer (RFC 6901) without parsing the whole resource
+	/// See `query_many`.
+	/// \param filename The filename of the resource to read
+	/// \param pointer The JSON Pointer, such as "/key/0/member"
+	/// \throws ReaderError if the pointer is invalid or if an error occurs during the reading of the file
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static QueryResult query(const char* filename, const std::string& pointer);
+
+	///
+	/// \brief query_many Read the values referenced by JSON Pointers (RFC 6901) without parsing the whole resource
+	/// The mapped file is scanned once, only the referenced values and the metadata are built. The scan stops once
+	/// all the pointers are resolved, so the rest of the resource is not validated.
+	/// The metadata are validated as by `open`. Binary and compressed resources are fully parsed.
+	/// \param filename The filename of the resource to read
+	/// \param pointers The JSON Pointers, such as "/key/0/member"
+	/// \throws ReaderError if a pointer is invalid or if an error occurs during the reading of the file
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	static QueryResult query_many(const char* filename, const std::vector<std::string>& pointers);
+
 public:
+	Reader(const Reader&) = default;
+	Reader& operator=(const Reader&) = default;
+
+	Reader(Reader&& other)
+		: mapping_(std::move(other.mapping_)), md_(std::move(other.md_)), stats_(other.stats_) {
+		// pt::ptree has no move constructor, swap it instead of deep copying it
+		json_.swap(other.json_);
+	}
+
+	Reader& operator=(Reader&& other) {
+		mapping_ = std::move(other.mapping_);
+		json_.swap(other.json_);
+		md_ = std::move(other.md_);
+		stats_ = other.stats_;
+		return *this;
+	}
+
 	//! Return the ptree used
 	pt::ptree& json() {
 		return json_;
@@ -51,23 +212,109 @@ public:
 	//! Returns the metadata read at the opening
 	const Metadata& metadata() const { return md_; }
 
+	//! Returns the statistics of the opening, that are only collected when enabled (see `enable_stats`)
+	const OperationStats& stats() const { return stats_; }
+
+	//! Return the raw bytes of the resource when it was opened with `ReaderOptions::memory_map`, empty otherwise or
+	//! if the resource is compressed.
+	//! The bytes reference the mapping without any copy and stay valid as long as a copy of this reader exists.
+	boost::string_view raw() const;
+
 private:
-	Reader(std::istream& stream) {
-		stream.clear();
-		stream.seekg(0, std::ios::beg);
-		try {
-			pt::read_json(stream, json_);
-		} catch (const std::exception& e) {
-			throw ReaderError((std::string("Json input malformed: ") + e.what()).c_str());
-		}
-	}
+	Reader() = default;
+
+	//! Parse the Json or binary resource from the stream
+	Reader(std::istream& stream, const ReaderOptions& options);
+
+	static Reader open_file(const char* filename, const ReaderOptions& options, ResourceError* error);
+	static Reader open_stream(std::istream& stream, const ReaderOptions& options, ResourceError* error);
 
 	Metadata read_metadata();
 
+	//! Decode the metadata of the content. The error is stored in `error`, or thrown if it is null.
+	void decode_metadata(ResourceError* error);
+
 private:
+	std::shared_ptr<const detail::MappedFile> mapping_;
+
 	pt::ptree json_;
 
 	Metadata md_;
+
+	OperationStats stats_;
+};
+
+///
+/// Outcome of the opening of one resource of a batch: either a Reader or the error that occurred
+///
+struct ReaderResult {
+	//! Position of the resource in the paths passed to `Reader::open_many`
+	std::size_t index = 0;
+
+	std::string path;
+
+	//! Set if the resource was opened
+	boost::optional<Reader> reader;
+
+	//! The ReaderError or the MetadataError that occurred otherwise
+	std::exception_ptr error;
+
+	bool ok() const { return bool(reader); }
+
+	//! Return the reader
+	//! \throws The error of the resource if it couldn't be opened
+	Reader& get() {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+		return *reader;
+	}
+};
+
+///
+/// Values of the JSON Pointers queried on a resource, see `Reader::query_many`
+///
+class QueryResult {
+public:
+	//! Returns the metadata of the resource
+	const Metadata& metadata() const { return md_; }
+
+	//! Number of queried pointers
+	std::size_t size() const { return values_.size(); }
+
+	//! Whether the i-th pointer references a value of the resource
+	bool found(std::size_t i) const { return bool(values_.at(i)); }
+
+	//! Return the value referenced by the i-th pointer, following the conventions of `pt::read_json`
+	//! \throws ReaderError if the pointer doesn't reference a value
+	const pt::ptree& value(std::size_t i) const {
+		if (not found(i)) {
+			throw ReaderError("No value at the JSON Pointer");
+		}
+		return *values_[i];
+	}
+
+	//! Return the value referenced by the i-th pointer converted to T
+	//! \throws ReaderError if the pointer doesn't reference a value
+	//! \throws pt::ptree_bad_data if the value can't be converted
+	template <typename T>
+	T get(std::size_t i) const {
+		return value(i).get_value<T>();
+	}
+
+	//! Return the value referenced by the i-th pointer converted to T, or none if it is absent or can't be converted
+	template <typename T>
+	boost::optional<T> get_optional(std::size_t i) const {
+		return found(i) ? values_[i]->get_value_optional<T>() : boost::none;
+	}
+
+private:
+	explicit QueryResult(Metadata md) : md_(std::move(md)) {}
+
+	Metadata md_;
+	std::vector<boost::optional<pt::ptree>> values_;
+
+	friend class Reader;
 };
 
 }} // namespace reven::jsonresource
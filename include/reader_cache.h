@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "reader.h"
+
+namespace reven {
+namespace jsonresource {
+
+///
+/// Counters of a ReaderCache
+///
+struct ReaderCacheStats {
+	std::uint64_t hits = 0;
+	std::uint64_t misses = 0;
+	std::uint64_t evictions = 0;
+
+	//! Number of resources currently in the cache
+	std::size_t entries = 0;
+	//! Estimate of the memory used by the resources currently in the cache
+	std::uint64_t bytes = 0;
+};
+
+///
+/// Cache of opened resources, shared by all the threads of a process.
+/// Resources are identified by the device, inode, size and modification time of their file, so a resource is read
+/// again as soon as its file changes, and an unchanged resource costs a `stat` instead of a parse. The entry of a
+/// resource whose file changed is dropped when the file is opened again.
+/// The least recently used resources are evicted when the estimate of the memory they use exceeds the budget. The
+/// estimate counts the nodes of their content and its strings, it is usually several times the size of the files.
+/// Evicted resources are released outside of the lock of the cache.
+///
+class ReaderCache {
+public:
+	//! \param byte_budget Maximum estimate of the memory used by the cached resources
+	explicit ReaderCache(std::uint64_t byte_budget);
+
+	ReaderCache(const ReaderCache&) = delete;
+	ReaderCache& operator=(const ReaderCache&) = delete;
+
+	///
+	/// \brief open Return the resource from the cache, or open it with `Reader::open` and cache it
+	/// The returned reader is shared and stays valid after its eviction from the cache.
+	/// \param filename The filename of the resource to open
+	/// \param options How the file is accessed when it is not in the cache
+	/// \throws ReaderError if an error occurs during the reading of the file
+	/// \throws MetadataError if an error occurs during the reading the metadata
+	std::shared_ptr<const Reader> open(const char* filename, const ReaderOptions& options = {});
+
+	//! Remove all the resources from the cache, counters are kept
+	void clear();
+
+	ReaderCacheStats stats() const;
+
+private:
+	struct Key {
+		std::uint64_t device;
+		std::uint64_t inode;
+		std::uint64_t size;
+		std::int64_t mtime;
+
+		bool operator==(const Key& other) const
+		{
+			return device == other.device and inode == other.inode and size == other.size and mtime == other.mtime;
+		}
+	};
+
+	struct KeyHash {
+		std::size_t operator()(const Key& key) const;
+	};
+
+	struct Entry {
+		Key key;
+		std::string filename;
+		//! Estimate of the memory used by the reader
+		std::uint64_t size;
+		std::shared_ptr<const Reader> reader;
+	};
+
+	//! Remove the entry, its reader is moved to `released` to be destroyed once the lock is released
+	void erase(std::list<Entry>::iterator entry, std::vector<std::shared_ptr<const Reader>>& released);
+
+	void evict(std::vector<std::shared_ptr<const Reader>>& released);
+
+	std::uint64_t byte_budget_;
+
+	mutable std::mutex mutex_;
+	//! Most recently used first
+	std::list<Entry> entries_;
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+	//! Cached entry of each filename, whose file may have changed since
+	std::unordered_map<std::string, std::list<Entry>::iterator> files_;
+	ReaderCacheStats stats_;
+};
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace reven {
+namespace jsonresource {
+
+///
+/// Operation measured by the statistics
+///
+enum class Operation {
+	//! `Reader::open`, from a file or a stream
+	reader_open,
+	//! `Metadata::deserialize`
+	metadata_deserialize,
+	//! `Writer::set_metadata`, `Writer::commit_async` and the first write of `Writer::create`
+	writer_commit,
+};
+
+///
+/// Statistics of one operation. They are only collected while enabled, see `enable_stats` and `set_stats_callback`.
+///
+struct OperationStats {
+	Operation operation = Operation::reader_open;
+
+	//! Bytes consumed from the input, or produced to the output. 0 when the stream can't tell its position.
+	std::uint64_t bytes_read = 0;
+	std::uint64_t bytes_written = 0;
+
+	//! Reading and building the content, the input is read while it is parsed
+	std::chrono::nanoseconds parse_time{0};
+
+	//! Validating and decoding the metadata
+	std::chrono::nanoseconds validate_time{0};
+
+	//! Encoding the content to the stream
+	std::chrono::nanoseconds serialize_time{0};
+
+	//! Flushing the stream and writing the sidecar index
+	std::chrono::nanoseconds flush_time{0};
+
+	//! Number of nodes of the content read or written, the root included
+	std::uint64_t node_count = 0;
+
+	//! Allocations made during the operation, only counted when an allocation counter is set
+	std::uint64_t allocation_count = 0;
+};
+
+//! Called with the statistics of each operation that completes. It can be called from several threads at once.
+using StatsCallback = std::function<void(const OperationStats&)>;
+
+///
+/// \brief enable_stats Collect statistics on the objects, available with `Reader::stats` and `Writer::stats`
+/// Statistics are disabled by default, and then only cost a check of a flag per operation.
+void enable_stats(bool enable);
+
+///
+/// \brief set_stats_callback Set the process-wide callback that receives the statistics of every operation
+/// Setting a callback enables the collection of statistics, an empty callback removes it.
+void set_stats_callback(StatsCallback callback);
+
+///
+/// \brief set_allocation_counter Set the function returning the number of allocations made by the process so far,
+/// for example from a replaced `operator new` or from the statistics of the allocator.
+/// Allocations are not counted without it, `nullptr` removes it.
+void set_allocation_counter(std::uint64_t (*counter)());
+
+}} // namespace reven::jsonresource
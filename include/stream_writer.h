@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+
+#include "metadata.h"
+#include "writer.h"
+
+namespace reven {
+namespace jsonresource {
+
+namespace detail {
+class JsonEmitter;
+}
+
+///
+/// A streaming Writer of Json resource.
+/// The metadata are written first, then the content is written to the stream as it is produced, without building
+/// the document in memory. The writer is already inside the root object: the content starts with a `key`.
+///
+/// Example:
+///
+/// ```cpp
+/// auto writer = StreamWriter::create("resource.json", md);
+/// writer.key("values").begin_array();
+/// for (std::uint64_t i = 0; i < count; ++i) {
+///		writer.value(i);
+/// }
+/// writer.end_array();
+/// std::move(writer).finalize();
+/// ```
+class StreamWriter {
+public:
+	///
+	/// \brief create Start a resource with the metadata and filename passed in parameter
+	/// \param filename The filename of the resource to write, overwritten if it exists
+	/// \param md The metadata to write in the file
+	/// \param format The layout of the resource
+	/// \throws WriterError if an error occurs during the writing of the file
+	static StreamWriter create(const char* filename, const Metadata& md,
+	                           const OutputFormat& format = OutputFormat{default_metadata_padding});
+
+	///
+	/// \brief create Start a resource with the metadata and stream passed in parameter
+	/// \param stream The output stream to write
+	/// \param md The metadata to write in the stream
+	/// \param format The layout of the resource
+	/// \throws WriterError if an error occurs during the writing of the stream
+	static StreamWriter create(std::unique_ptr<std::ostream>&& stream, const Metadata& md,
+	                           const OutputFormat& format = OutputFormat{default_metadata_padding});
+
+	StreamWriter(StreamWriter&&);
+	~StreamWriter();
+
+	/// All the following methods throw WriterError if they don't produce valid Json at this point.
+
+	StreamWriter& begin_object();
+	StreamWriter& end_object();
+	StreamWriter& begin_array();
+	StreamWriter& end_array();
+
+	//! Write the key of the next member of the current object
+	StreamWriter& key(boost::string_view key);
+
+	StreamWriter& value(boost::string_view value);
+	StreamWriter& value(const char* value) { return this->value(boost::string_view(value)); }
+	StreamWriter& value(const std::string& value) { return this->value(boost::string_view(value)); }
+	StreamWriter& value(std::uint64_t value);
+	StreamWriter& value(std::int64_t value);
+	StreamWriter& value(std::uint32_t value) { return this->value(static_cast<std::uint64_t>(value)); }
+	StreamWriter& value(std::int32_t value) { return this->value(static_cast<std::int64_t>(value)); }
+	StreamWriter& value(double value);
+	StreamWriter& value(bool value);
+	StreamWriter& null();
+
+	///
+	/// \brief finalize Close the root object and retrieve the stream
+	/// \throws WriterError if some containers are not closed or if the stream failed
+	std::unique_ptr<std::ostream> finalize() &&;
+
+private:
+	StreamWriter(std::unique_ptr<std::ostream>&& stream, const Metadata& md, const OutputFormat& format);
+
+	void before_value();
+	void end_container(bool object);
+
+	//! Stored in a pointer because ostream itself is not movable
+	std::unique_ptr<std::ostream> stream_;
+	std::unique_ptr<detail::JsonEmitter> emitter_;
+
+	//! For each opened container, whether it is an object
+	std::vector<bool> objects_;
+	bool after_key_ = false;
+};
+
+}} // namespace reven::jsonresource
@@ -1,17 +1,24 @@
 #pragma once
 
+#include <future>
 #include <ostream>
 #include <memory>
 
 #include <boost/property_tree/json_parser.hpp>
 
+#include "document.h"
 #include "metadata.h"
+#include "stats.h"
 
 namespace pt = boost::property_tree;
 
 namespace reven {
 namespace jsonresource {
 
+namespace detail {
+class CommitQueue;
+}
+
 ///
 /// Exception that occurs when there is an error in the writing
 ///
@@ -20,6 +27,69 @@ public:
 	WriterError(const char* msg) : std::runtime_error(msg) {}
 };
 
+///
+/// Storage used by a Writer for the content of the resource
+///
+enum class WriterBackend {
+	//! Content stored in a pt::ptree, accessed with `Writer::json()`
+	ptree,
+	//! Content stored in an arena-allocated Document, accessed with `Writer::document()`
+	arena,
+};
+
+///
+/// Encoding of the written resource
+///
+enum class ResourceEncoding {
+	//! Json text
+	json,
+	//! CBOR binary encoding of the same document, that `Reader` detects and loads transparently.
+	//! Binary resources can't be indexed nor patched in place.
+	cbor,
+};
+
+///
+/// Compression of the written resource. Compressed resources are detected and decompressed by `Reader`.
+///
+enum class Compression {
+	none,
+	gzip,
+	zlib,
+	bzip2,
+};
+
+//! Number of spaces reserved after the metadata by default, see `Writer::patch_metadata`
+constexpr std::size_t default_metadata_padding = 128;
+
+///
+/// Options to create or open a resource
+///
+struct WriterOptions {
+	//! Only used when the content is read from a file, otherwise the backend is given by the type of the content
+	WriterBackend backend = WriterBackend::ptree;
+
+	//! Layout of the written resource
+	OutputFormat format = OutputFormat{default_metadata_padding};
+
+	//! Encoding of the written resource, the layout of the format only applies to Json text
+	ResourceEncoding encoding = ResourceEncoding::json;
+
+	//! Compression of the resources written to a file. Compressed resources can't be indexed nor patched in place.
+	Compression compression = Compression::none;
+
+	//! Compression level, from 1 (fastest) to 9 (smallest), or -1 for the default level of the compression.
+	//! For bzip2, it is the block size in units of 100k.
+	int compression_level = -1;
+
+	//! Write a sidecar index next to resources written to a file, mapping their top-level keys to byte ranges.
+	//! It is used by `Reader::open_section` and `Reader::open_elements` to parse only a part of the resource.
+	bool write_index = false;
+
+	//! When writing an index, also index the elements of top-level arrays by chunks of this many elements.
+	//! 0 disables the indexing of array elements.
+	std::uint64_t index_array_chunk = 0;
+};
+
 ///
 /// A Writer of Json resource
 ///
@@ -32,13 +102,49 @@ public:
 	/// \throws WriterError if an error occurs during the writing of the file
 	static Writer create(const char* filename, const Metadata& md);
 
+	///
+	/// \brief create Create a resource with the metadata and filename passed in parameter
+	/// The file is streamed into a temporary file next to it, with the metadata inserted as its first member, and
+	/// the temporary file then atomically replaces the original. The memory used does not depend on the size of the
+	/// file, and the original file is left untouched if an error occurs. The content is only read in the writer when
+	/// it is accessed (see `json` and `document`). Binary resources, and resources written in a binary encoding, are
+	/// converted through the content of the writer.
+	/// \param filename The filename of the resource to open
+	/// \param md The metadata to write in the file
+	/// \param options How the content of the resource is stored
+	/// \throws WriterError if an error occurs during the writing of the file
+	static Writer create(const char* filename, const Metadata& md, const WriterOptions& options);
+
 	///
 	/// \brief create Create a resource with the metadata and stream passed in parameter
 	/// \param json The ptree containing the JSON objects to write
 	/// \param stream The output stream to write
 	/// \param md The metadata to write in the file
+	/// \param options The format of the resource
 	/// \throws WriterError if an error occurs during the writing of the stream
-	static Writer create(pt::ptree& json, std::unique_ptr<std::ostream>&& stream, const Metadata& md);
+	static Writer create(pt::ptree& json, std::unique_ptr<std::ostream>&& stream, const Metadata& md,
+	                     const WriterOptions& options = {});
+
+	///
+	/// \brief create Create a resource with the metadata and stream passed in parameter
+	/// The ptree is moved into the writer, so its content is never copied.
+	/// \param json The ptree containing the JSON objects to write
+	/// \param stream The output stream to write
+	/// \param md The metadata to write in the file
+	/// \param options The format of the resource
+	/// \throws WriterError if an error occurs during the writing of the stream
+	static Writer create(pt::ptree&& json, std::unique_ptr<std::ostream>&& stream, const Metadata& md,
+	                     const WriterOptions& options = {});
+
+	///
+	/// \brief create Create a resource backed by an arena-allocated document
+	/// \param doc The document containing the JSON objects to write
+	/// \param stream The output stream to write
+	/// \param md The metadata to write in the file
+	/// \param options The format of the resource
+	/// \throws WriterError if an error occurs during the writing of the stream
+	static Writer create(Document&& doc, std::unique_ptr<std::ostream>&& stream, const Metadata& md,
+	                     const WriterOptions& options = {});
 
 	///
 	/// \brief open Open an already versioned resource with the filename passed in parameter
@@ -47,44 +153,221 @@ public:
 	/// \throws MetadataError if an error occurs during the reading the existing metadata
 	static Writer open(const char* filename);
 
+	///
+	/// \brief open Open an already versioned resource with the filename passed in parameter
+	/// Only the metadata are read to be checked. Like with `create`, the resource is rewritten through a temporary
+	/// file that replaces it, and its content is only read in the writer when it is accessed.
+	/// Binary resources are read transparently, and written back in the encoding of the options.
+	/// \param filename The filename of the resource to open and write
+	/// \param options How the content of the resource is stored
+	/// \throws WriterError if an error occurs during the reading of the file
+	/// \throws MetadataError if an error occurs during the reading the existing metadata
+	static Writer open(const char* filename, const WriterOptions& options);
+
+	///
+	/// \brief open Open an already versioned resource with the stream passed in parameter
+	/// \param stream The output stream to write
+	/// \param options The format of the resource
+	/// \throws WriterError if an error occurs during the reading of the stream
+	/// \throws MetadataError if an error occurs during the reading the existing metadata
+	static Writer open(pt::ptree& json, std::unique_ptr<std::ostream>&& stream,
+	                   const WriterOptions& options = {});
+
 	///
 	/// \brief open Open an already versioned resource with the stream passed in parameter
+	/// The ptree is moved into the writer, so its content is never copied.
+	/// \param stream The output stream to write
+	/// \param options The format of the resource
+	/// \throws WriterError if an error occurs during the reading of the stream
+	/// \throws MetadataError if an error occurs during the reading the existing metadata
+	static Writer open(pt::ptree&& json, std::unique_ptr<std::ostream>&& stream,
+	                   const WriterOptions& options = {});
+
+	///
+	/// \brief open Open an already versioned resource backed by an arena-allocated document
+	/// \param doc The document containing the JSON objects to write
 	/// \param stream The output stream to write
+	/// \param options The format of the resource
 	/// \throws WriterError if an error occurs during the reading of the stream
 	/// \throws MetadataError if an error occurs during the reading the existing metadata
-	static Writer open(pt::ptree& json, std::unique_ptr<std::ostream>&& stream);
+	static Writer open(Document&& doc, std::unique_ptr<std::ostream>&& stream,
+	                   const WriterOptions& options = {});
+
+	///
+	/// \brief inject_metadata Add metadata to an existing file without loading its content
+	/// Like `create`, the file is streamed into a temporary file next to it, with the metadata inserted as its
+	/// first member, and the temporary file then atomically replaces the original. Unlike `create`, the members of
+	/// the resource keep their original bytes, so the layout of the options only applies to the metadata. They are
+	/// compressed as requested by the options. A binary output, or a compressed or binary file, can't keep the bytes
+	/// of the members: the resource is then created like `create` does.
+	/// A missing or empty file results in a resource that only contains the metadata.
+	/// \param filename The filename of the resource to create
+	/// \param md The metadata to write in the resource
+	/// \param options The format and the encoding of the resource, and whether to write an index
+	/// \throws WriterError if the file is not a Json object, already contains metadata, or can't be written
+	static void inject_metadata(const char* filename, const Metadata& md, const WriterOptions& options = {});
+
+	///
+	/// \brief patch_metadata Replace the metadata of an already versioned resource without rewriting its content
+	/// The new metadata are written in place when they fit in the space of the previous ones and of the padding
+	/// that follows them (see `OutputFormat::metadata_padding`). Otherwise, the resource is rewritten by streaming
+	/// it into a temporary file that then replaces it. Compressed and binary resources are always rewritten, with
+	/// the compression and the encoding they already have.
+	/// \param filename The filename of the resource to update
+	/// \param md The metadata to write in the resource
+	/// \param options The format of the metadata if the resource is rewritten, and whether to update its index
+	/// \return true if the metadata were written in place
+	/// \throws WriterError if an error occurs during the reading or the writing of the file
+	/// \throws MetadataError if an error occurs during the reading the existing metadata
+	static bool patch_metadata(const char* filename, const Metadata& md, const WriterOptions& options = {});
 
 public:
-	//! Return the ptree used
-	pt::ptree& json() {
-		return json_;
+	Writer(Writer&& other)
+		: stream_(std::move(other.stream_)), backend_(other.backend_), document_(std::move(other.document_)),
+		  committed_json_(std::move(other.committed_json_)), committed_document_(std::move(other.committed_document_)),
+		  filename_(std::move(other.filename_)), options_(other.options_), loaded_(other.loaded_), stats_(other.stats_),
+		  commits_(std::move(other.commits_)) {
+		// pt::ptree has no move constructor, swap it instead of deep copying it
+		json_.swap(other.json_);
 	}
 
-	//! Return the stream used
-	std::ostream& stream() {
-		return *stream_;
+	Writer& operator=(Writer&& other) {
+		// The pending commits write to the current stream, they are waited for before it is released
+		commits_ = std::move(other.commits_);
+		stream_ = std::move(other.stream_);
+		backend_ = other.backend_;
+		json_.swap(other.json_);
+		document_ = std::move(other.document_);
+		committed_json_ = std::move(other.committed_json_);
+		committed_document_ = std::move(other.committed_document_);
+		filename_ = std::move(other.filename_);
+		options_ = other.options_;
+		loaded_ = other.loaded_;
+		stats_ = other.stats_;
+		return *this;
 	}
 
-	//! Retrieve the stream in case someone want to access it after the end of the writing
-	std::unique_ptr<std::ostream>&& finalize() && {
-		return std::move(stream_);
+	//! Return the ptree used. If the writer uses the arena backend, its content is first converted to a ptree and
+	//! the writer switches to the ptree backend.
+	pt::ptree& json();
+
+	//! Return the document used. If the writer uses the ptree backend, its content is first converted to a
+	//! document and the writer switches to the arena backend.
+	Document& document();
+
+	//! Return the backend currently storing the content
+	WriterBackend backend() const {
+		return backend_;
 	}
 
+	//! Return the stream the resource is written to, once the pending commits are written. Resources written to a
+	//! file have none, as the file is replaced at each write: this accessor returns nullptr for them, and replaces
+	//! `stream()` that returned the stream of the file.
+	std::ostream* output_stream();
+
+	//! Retrieve the stream in case someone want to access it after the end of the writing.
+	//! The pending commits are written first. Resources written to a file have no stream.
+	std::unique_ptr<std::ostream>&& finalize() &&;
+
 	///
 	/// \brief set_metadata Update the metadata of an already existing resource
 	/// \param md The metadata to write in the resource
 	/// \throws WriterError if an error occurs during the writing of the resource
 	void set_metadata(const Metadata& md);
 
+	//! Return the statistics of the last write made by `set_metadata` or `create`, that are only collected when
+	//! enabled (see `enable_stats`). Asynchronous commits only report their statistics to the callback.
+	const OperationStats& stats() const {
+		return stats_;
+	}
+
+	///
+	/// \brief commit_async Update the metadata of the resource, and write it on a background thread
+	/// The metadata are set in the content, that is then handed over to the commit without being copied, and
+	/// serialized and flushed to the stream by a thread owned by the writer. The writer takes the content back when
+	/// it is accessed again: it is only copied if the commit is still running at that time, so the content can be
+	/// modified as soon as the call returns, and waiting for the future first avoids the copy. Commits are written
+	/// in the order of the calls, and a commit that is still waiting when another one is requested is replaced by
+	/// it: the last commit wins, and the futures of both commits get its outcome. `set_metadata`, `output_stream`,
+	/// `finalize` and the destruction of the writer wait for the pending commits.
+	/// \param md The metadata to write in the resource
+	/// \return A future that is ready when the resource is written, and that holds the exception that
+	/// `set_metadata` would have thrown otherwise
+	std::future<void> commit_async(const Metadata& md);
+
 private:
-	Writer(pt::ptree& json, std::unique_ptr<std::ostream>&& stream)
-		: stream_{std::move(stream)}, json_(json) {}
+	//! Build a writer of the file, whose content is read when accessed in the backend selected by the options
+	static Writer from_file(const char* filename, const WriterOptions& options);
+
+	//! Take the content back from the last asynchronous commit, then read the content of the file if it isn't yet
+	void load_content();
+
+	//! Take the content back from the last asynchronous commit, by copying it if the commit still uses it
+	void reclaim_content();
+
+	//! Write the resource of the file with the metadata, by streaming it when its content isn't read
+	//! \param replace Whether the resource already has metadata, otherwise it must not have any
+	OperationStats write_resource(const Metadata& md, bool replace);
+
+	void check_stream() const;
+	void check_no_metadata();
+	void check_metadata();
+
+	//! Write the resource a first time with its metadata
+	void create_resource(const Metadata& md);
+
+	//! Replace the metadata of the content
+	void apply_metadata(const Metadata& md);
+
+	//! Write the content to the stream, then flush it, and return the statistics of the commit
+	template <typename Content>
+	static OperationStats commit(std::ostream& stream, Content& content, const WriterOptions& options);
+
+	//! Write the content to a temporary file that then replaces the file, write the index, and return the
+	//! statistics of the commit
+	template <typename Content>
+	static OperationStats commit_file(Content& content, const std::string& filename, const WriterOptions& options);
+
+	//! Write the content in the encoding and format of the options
+	static void write_content(std::ostream& stream, const pt::ptree& json, const WriterOptions& options);
+	static void write_content(std::ostream& stream, Document& doc, const WriterOptions& options);
+
+	Writer(const pt::ptree& json, std::unique_ptr<std::ostream>&& stream)
+		: stream_{std::move(stream)}, backend_(WriterBackend::ptree), json_(json) {}
+
+	Writer(pt::ptree&& json, std::unique_ptr<std::ostream>&& stream)
+		: stream_{std::move(stream)}, backend_(WriterBackend::ptree) {
+		json_.swap(json);
+	}
+
+	Writer(Document&& doc, std::unique_ptr<std::ostream>&& stream)
+		: stream_{std::move(stream)}, backend_(WriterBackend::arena), document_(std::move(doc)) {}
 
 private:
 	//! Stored in a pointer because ostream itself is not movable
 	std::unique_ptr<std::ostream> stream_;
 
+	WriterBackend backend_;
 	pt::ptree json_;
+	Document document_;
+
+	//! Content handed over to the last asynchronous commit, in place of `json_` or `document_`
+	std::shared_ptr<pt::ptree> committed_json_;
+	std::shared_ptr<Document> committed_document_;
+
+	//! Filename and options of resources opened from a file
+	std::string filename_;
+	WriterOptions options_;
+
+	//! Whether the content of a resource opened from a file is read. It is read when accessed.
+	bool loaded_ = true;
+
+	//! Statistics of the last synchronous commit
+	OperationStats stats_;
+
+	//! Created by the first asynchronous commit. Declared last so it is destroyed first, while the stream that the
+	//! pending commits write to still exists.
+	std::shared_ptr<detail::CommitQueue> commits_;
 };
 
 }} // namespace reven::binresource
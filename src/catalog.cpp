@@ -0,0 +1,308 @@
+#include "catalog.h"
+#include "reader.h"
+#include "file_stat.h"
+#include "json_emitter.h"
+#include "json_scanner.h"
+#include "temporary_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+#include <boost/optional.hpp>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace reven {
+namespace jsonresource {
+
+namespace {
+
+constexpr std::uint32_t catalog_version = 1;
+
+struct CatalogFile {
+	std::string path;
+	detail::FileStat st;
+	//! A directory that can't be listed, recorded as a failure
+	bool unlisted = false;
+};
+
+bool has_extension(const std::string& name, const std::string& extension)
+{
+	return name.size() >= extension.size() and
+	       name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+//! List the regular files of the tree recursively, symbolic links to directories are not followed. The
+//! subdirectories that can't be listed are listed themselves, as unlisted.
+//! \throws CatalogError if the directory can't be listed
+void list_files(const std::string& directory, const std::string& prefix, const std::string& extension,
+                std::vector<CatalogFile>& files)
+{
+	const auto dir = ::opendir(directory.c_str());
+	if (dir == nullptr) {
+		throw CatalogError((std::string("Can't list directory ") + directory).c_str());
+	}
+
+	while (const auto entry = ::readdir(dir)) {
+		const std::string name = entry->d_name;
+		if (name == "." or name == "..") {
+			continue;
+		}
+
+		const auto path = directory + "/" + name;
+		bool is_directory = entry->d_type == DT_DIR;
+		if (entry->d_type == DT_UNKNOWN) {
+			struct stat buf;
+			is_directory = ::lstat(path.c_str(), &buf) == 0 and S_ISDIR(buf.st_mode);
+		}
+
+		if (is_directory) {
+			try {
+				list_files(path, prefix + name + "/", extension, files);
+			} catch (const CatalogError&) {
+				CatalogFile file;
+				file.path = prefix + name;
+				file.unlisted = true;
+				detail::stat_file(path.c_str(), file.st);
+				files.push_back(std::move(file));
+			} catch (...) {
+				::closedir(dir);
+				throw;
+			}
+			continue;
+		}
+
+		CatalogFile file;
+		if (has_extension(name, extension) and detail::stat_file(path.c_str(), file.st)) {
+			file.path = prefix + name;
+			files.push_back(std::move(file));
+		}
+	}
+	::closedir(dir);
+}
+
+//! Element of a sorted vector with the path, or nullptr
+template <typename Element>
+const Element* find_path(const std::vector<Element>& elements, const std::string& path)
+{
+	const auto it = std::lower_bound(elements.begin(), elements.end(), path,
+	                                 [](const Element& element, const std::string& path) {
+		return element.path < path;
+	});
+	if (it == elements.end() or it->path != path) {
+		return nullptr;
+	}
+	return &*it;
+}
+
+}
+
+Catalog Catalog::load(const char* filename)
+{
+	std::ifstream input(filename, std::ios::binary);
+	if (not input) {
+		throw CatalogError((std::string("Can't open ") + filename).c_str());
+	}
+
+	Catalog catalog;
+	try {
+		detail::JsonScanner scanner(input);
+		bool has_version = false;
+		scanner.expect('{');
+		if (not scanner.consume('}')) {
+			do {
+				const auto key = scanner.read_string();
+				scanner.expect(':');
+				if (key == "catalog_version") {
+					if (scanner.read_string() != std::to_string(catalog_version)) {
+						throw std::runtime_error("unsupported catalog version");
+					}
+					has_version = true;
+				} else if ((key == "entries" or key == "failures") and not has_version) {
+					throw std::runtime_error(key + " before the catalog version");
+				} else if (key == "entries") {
+					// Entries are built one at a time, the file is never loaded as a whole
+					scanner.expect('[');
+					if (not scanner.consume(']')) {
+						do {
+							pt::ptree jentry;
+							scanner.read_value(jentry);
+							catalog.entries_.push_back(CatalogEntry{
+								jentry.get<std::string>("path"), jentry.get<std::uint64_t>("size"),
+								jentry.get<std::int64_t>("mtime"), Metadata::read_metadata(jentry)
+							});
+						} while (scanner.consume(','));
+						scanner.expect(']');
+					}
+				} else if (key == "failures") {
+					scanner.expect('[');
+					if (not scanner.consume(']')) {
+						do {
+							pt::ptree jfailure;
+							scanner.read_value(jfailure);
+							catalog.failures_.push_back(CatalogFailure{
+								jfailure.get<std::string>("path"), jfailure.get<std::uint64_t>("size"),
+								jfailure.get<std::int64_t>("mtime")
+							});
+						} while (scanner.consume(','));
+						scanner.expect(']');
+					}
+				} else {
+					scanner.skip_value();
+				}
+			} while (scanner.consume(','));
+			scanner.expect('}');
+		}
+		if (not has_version) {
+			throw std::runtime_error("missing catalog version");
+		}
+	} catch (const std::exception& e) {
+		throw CatalogError((std::string("Can't read catalog: ") + e.what()).c_str());
+	}
+
+	std::sort(catalog.entries_.begin(), catalog.entries_.end(),
+	          [](const CatalogEntry& a, const CatalogEntry& b) { return a.path < b.path; });
+	std::sort(catalog.failures_.begin(), catalog.failures_.end(),
+	          [](const CatalogFailure& a, const CatalogFailure& b) { return a.path < b.path; });
+	return catalog;
+}
+
+void Catalog::save(const char* filename) const
+{
+	OutputFormat format;
+	format.compact = true;
+
+	try {
+		detail::TemporaryFile output(filename);
+		detail::JsonEmitter emitter(output.stream(), format);
+		emitter.begin_object();
+		emitter.key("catalog_version");
+		emitter.string(std::to_string(catalog_version));
+		emitter.key("entries");
+		emitter.begin_array();
+		for (const auto& entry : entries_) {
+			emitter.begin_object();
+			emitter.key("path");
+			emitter.string(entry.path);
+			emitter.key("size");
+			emitter.string(std::to_string(entry.size));
+			emitter.key("mtime");
+			emitter.string(std::to_string(entry.mtime));
+
+			pt::ptree json;
+			entry.metadata.write_metadata(json);
+			emitter.key("metadata");
+			detail::emit_metadata(emitter, json.get_child("metadata"));
+			emitter.end_object();
+		}
+		emitter.end_array();
+		emitter.key("failures");
+		emitter.begin_array();
+		for (const auto& failure : failures_) {
+			emitter.begin_object();
+			emitter.key("path");
+			emitter.string(failure.path);
+			emitter.key("size");
+			emitter.string(std::to_string(failure.size));
+			emitter.key("mtime");
+			emitter.string(std::to_string(failure.mtime));
+			emitter.end_object();
+		}
+		emitter.end_array();
+		emitter.end_object();
+		emitter.end_document();
+		output.commit();
+	} catch (const std::exception& e) {
+		throw CatalogError((std::string("Can't write catalog: ") + e.what()).c_str());
+	}
+}
+
+CatalogScan Catalog::scan(const char* directory, const CatalogOptions& options)
+{
+	std::vector<CatalogFile> files;
+	list_files(directory, "", options.extension, files);
+	std::sort(files.begin(), files.end(),
+	          [](const CatalogFile& a, const CatalogFile& b) { return a.path < b.path; });
+
+	CatalogScan result;
+
+	// Keep the entries and the failures of unchanged files, and queue the others
+	std::vector<CatalogEntry> entries;
+	std::vector<CatalogFailure> failures;
+	std::vector<const CatalogFile*> jobs;
+	std::size_t still_present = 0;
+	for (const auto& file : files) {
+		const auto previous = find(file.path);
+		const auto failure = find_path(failures_, file.path);
+		still_present += previous != nullptr or failure != nullptr ? 1 : 0;
+		if (file.unlisted) {
+			failures.push_back(CatalogFailure{file.path, file.st.size, file.st.mtime});
+			++result.failed;
+			continue;
+		}
+		if (previous != nullptr and previous->size == file.st.size and previous->mtime == file.st.mtime) {
+			entries.push_back(*previous);
+			++result.kept;
+			continue;
+		}
+		if (failure != nullptr and failure->size == file.st.size and failure->mtime == file.st.mtime) {
+			failures.push_back(*failure);
+			++result.skipped;
+			continue;
+		}
+		jobs.push_back(&file);
+	}
+	result.removed = entries_.size() + failures_.size() - still_present;
+
+	std::vector<boost::optional<Metadata>> metadata(jobs.size());
+	std::atomic<std::size_t> next{0};
+	auto worker = [&]() {
+		for (auto i = next++; i < jobs.size(); i = next++) {
+			// Files that are not resources are common in scanned trees, they are left out without any exception
+			std::ifstream input(std::string(directory) + "/" + jobs[i]->path, std::ios::binary);
+			auto md = Metadata::try_peek(input);
+			if (md) {
+				metadata[i] = std::move(*md);
+			}
+		}
+	};
+
+	auto thread_count = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+	thread_count = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, jobs.size()));
+	std::vector<std::thread> threads;
+	for (std::size_t i = 1; i < thread_count; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	for (std::size_t i = 0; i < jobs.size(); ++i) {
+		if (not metadata[i]) {
+			failures.push_back(CatalogFailure{jobs[i]->path, jobs[i]->st.size, jobs[i]->st.mtime});
+			++result.failed;
+			continue;
+		}
+		entries.push_back(CatalogEntry{jobs[i]->path, jobs[i]->st.size, jobs[i]->st.mtime, *metadata[i]});
+		++result.read;
+	}
+
+	std::sort(entries.begin(), entries.end(),
+	          [](const CatalogEntry& a, const CatalogEntry& b) { return a.path < b.path; });
+	std::sort(failures.begin(), failures.end(),
+	          [](const CatalogFailure& a, const CatalogFailure& b) { return a.path < b.path; });
+	entries_ = std::move(entries);
+	failures_ = std::move(failures);
+	return result;
+}
+
+const CatalogEntry* Catalog::find(const std::string& path) const
+{
+	return find_path(entries_, path);
+}
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,427 @@
+#include "cbor.h"
+#include "number.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+enum Major : std::uint8_t {
+	unsigned_integer = 0,
+	negative_integer = 1,
+	byte_string = 2,
+	text_string = 3,
+	array = 4,
+	map = 5,
+	tag = 6,
+	simple = 7,
+};
+
+constexpr std::uint8_t simple_false = 20;
+constexpr std::uint8_t simple_true = 21;
+constexpr std::uint8_t simple_null = 22;
+constexpr std::uint8_t simple_double = 27;
+
+//! Parse an integer written without sign for positive values and without leading zeros, return false otherwise
+bool parse_integer(const std::string& text, bool& negative, std::uint64_t& magnitude)
+{
+	negative = not text.empty() and text[0] == '-';
+	const auto digits = text.c_str() + (negative ? 1 : 0);
+	const auto size = text.size() - (negative ? 1 : 0);
+	if (size == 0 or size > 20 or (digits[0] == '0' and (size > 1 or negative))) {
+		return false;
+	}
+
+	magnitude = 0;
+	for (std::size_t i = 0; i < size; ++i) {
+		if (digits[i] < '0' or digits[i] > '9') {
+			return false;
+		}
+		const std::uint64_t digit = static_cast<std::uint64_t>(digits[i] - '0');
+		if (magnitude > (std::numeric_limits<std::uint64_t>::max() - digit) / 10) {
+			return false;
+		}
+		magnitude = magnitude * 10 + digit;
+	}
+	return true;
+}
+
+class CborEncoder {
+public:
+	explicit CborEncoder(std::ostream& out) : out_(out) {}
+
+	void head(Major major, std::uint64_t argument)
+	{
+		char bytes[9];
+		std::size_t size = 0;
+		const auto initial = static_cast<std::uint8_t>(major << 5);
+		if (argument < 24) {
+			bytes[0] = static_cast<char>(initial | argument);
+			size = 1;
+		} else {
+			std::size_t width = argument <= 0xFF ? 1 : argument <= 0xFFFF ? 2 : argument <= 0xFFFFFFFF ? 4 : 8;
+			bytes[0] = static_cast<char>(initial | (width == 1 ? 24 : width == 2 ? 25 : width == 4 ? 26 : 27));
+			for (std::size_t i = 0; i < width; ++i) {
+				bytes[width - i] = static_cast<char>(argument >> (8 * i));
+			}
+			size = width + 1;
+		}
+		out_.write(bytes, static_cast<std::streamsize>(size));
+	}
+
+	void text(boost::string_view value)
+	{
+		head(text_string, value.size());
+		out_.write(value.data(), static_cast<std::streamsize>(value.size()));
+	}
+
+	void leaf(const std::string& value)
+	{
+		bool negative = false;
+		std::uint64_t magnitude = 0;
+		if (not parse_integer(value, negative, magnitude)) {
+			text(value);
+		} else if (negative) {
+			head(negative_integer, magnitude - 1);
+		} else {
+			head(unsigned_integer, magnitude);
+		}
+	}
+
+	//! Write the native value of the node, strings are written as the leaves of a ptree
+	void typed_leaf(DocumentNode node)
+	{
+		switch (node.type()) {
+		// Numbers that don't fit the native types have no item that the decoder reads, they are kept as text
+		case ValueType::string:
+		case ValueType::number:
+			leaf(node.data().to_string());
+			return;
+		case ValueType::unsigned_integer:
+			head(unsigned_integer, *node.get_value_optional<std::uint64_t>());
+			return;
+		case ValueType::signed_integer: {
+			const auto value = *node.get_value_optional<std::int64_t>();
+			if (value < 0) {
+				head(negative_integer, ~static_cast<std::uint64_t>(value));
+			} else {
+				head(unsigned_integer, static_cast<std::uint64_t>(value));
+			}
+			return;
+		}
+		case ValueType::floating: {
+			const auto value = *node.get_value_optional<double>();
+			if (not std::isfinite(value)) {
+				throw std::runtime_error("document contains data that cannot be represented in JSON format");
+			}
+			std::uint64_t bits = 0;
+			std::memcpy(&bits, &value, sizeof(bits));
+			char bytes[9] = {static_cast<char>((simple << 5) | simple_double)};
+			for (std::size_t i = 0; i < 8; ++i) {
+				bytes[8 - i] = static_cast<char>(bits >> (8 * i));
+			}
+			out_.write(bytes, sizeof(bytes));
+			return;
+		}
+		case ValueType::boolean:
+			head(simple, *node.get_value_optional<bool>() ? simple_true : simple_false);
+			return;
+		case ValueType::null:
+			head(simple, simple_null);
+			return;
+		}
+	}
+
+	void node(const pt::ptree& json, bool root)
+	{
+		if (not json.data().empty() and (root or not json.empty())) {
+			throw std::runtime_error("ptree contains data that cannot be represented in JSON format");
+		}
+
+		if (not root and json.empty()) {
+			leaf(json.data());
+			return;
+		}
+
+		const bool is_array = not root and json.count(std::string()) == json.size();
+		head(is_array ? array : map, json.size());
+		for (const auto& child : json) {
+			if (not is_array) {
+				text(child.first);
+			}
+			node(child.second, false);
+		}
+	}
+
+	void node(DocumentNode node, bool root)
+	{
+		if (not node.data().empty() and (root or not node.empty())) {
+			throw std::runtime_error("document contains data that cannot be represented in JSON format");
+		}
+
+		if (not root and node.empty()) {
+			typed_leaf(node);
+			return;
+		}
+
+		bool is_array = not root;
+		for (const auto child : node) {
+			is_array = is_array and child.key().empty();
+		}
+		head(is_array ? array : map, node.size());
+		for (const auto child : node) {
+			if (not is_array) {
+				text(child.key());
+			}
+			this->node(child, false);
+		}
+	}
+
+private:
+	std::ostream& out_;
+};
+
+template <typename Root>
+void write_document(std::ostream& out, Root& root)
+{
+	out.write(cbor_magic, cbor_magic_size);
+	CborEncoder encoder(out);
+	encoder.node(root, true);
+	out.flush();
+	if (not out.good()) {
+		throw std::runtime_error("write error");
+	}
+}
+
+}
+
+bool is_cbor(const char* data, std::size_t size)
+{
+	return size >= cbor_magic_size and std::memcmp(data, cbor_magic, cbor_magic_size) == 0;
+}
+
+void write_cbor(std::ostream& out, const pt::ptree& json)
+{
+	write_document(out, json);
+}
+
+void write_cbor(std::ostream& out, Document& doc)
+{
+	auto root = doc.root();
+	write_document(out, root);
+}
+
+void CborDecoder::read_document(pt::ptree& json)
+{
+	read_magic();
+	const auto initial = input_.sgetc();
+	if (initial == std::streambuf::traits_type::eof() or (static_cast<std::uint8_t>(initial) >> 5) != map) {
+		error("root is not a map");
+	}
+	read_value(json);
+	if (input_.sgetc() != std::streambuf::traits_type::eof()) {
+		error("garbage after data");
+	}
+}
+
+bool CborDecoder::read_metadata(pt::ptree& json)
+{
+	read_magic();
+	const auto initial = get();
+	if ((initial >> 5) != map) {
+		error("root is not a map");
+	}
+
+	for (auto count = read_argument(initial); count != 0; --count) {
+		if (read_text() == "metadata") {
+			read_value(json.add_child("metadata", pt::ptree()));
+			return true;
+		}
+		skip_value();
+	}
+	return false;
+}
+
+void CborDecoder::read_magic()
+{
+	char magic[cbor_magic_size];
+	if (input_.sgetn(magic, cbor_magic_size) != cbor_magic_size or not is_cbor(magic, cbor_magic_size)) {
+		error("bad magic");
+	}
+	offset_ += cbor_magic_size;
+}
+
+std::uint8_t CborDecoder::get()
+{
+	const auto c = input_.sbumpc();
+	if (c == std::streambuf::traits_type::eof()) {
+		error("unexpected end of input");
+	}
+	++offset_;
+	return static_cast<std::uint8_t>(c);
+}
+
+std::uint64_t CborDecoder::read_argument(std::uint8_t initial)
+{
+	const std::uint8_t info = initial & 0x1F;
+	if (info < 24) {
+		return info;
+	}
+	if (info > 27) {
+		error("unsupported argument");
+	}
+
+	std::uint64_t argument = 0;
+	for (std::size_t i = 0; i < (std::size_t(1) << (info - 24)); ++i) {
+		argument = (argument << 8) | get();
+	}
+	return argument;
+}
+
+std::string CborDecoder::read_text()
+{
+	const auto initial = get();
+	if ((initial >> 5) != text_string) {
+		error("expected text string");
+	}
+
+	// Read by chunks, so a corrupted length fails at the end of the input instead of allocating it
+	std::string text;
+	for (auto remaining = read_argument(initial); remaining != 0;) {
+		char buffer[16 * 1024];
+		const auto size = static_cast<std::streamsize>(std::min<std::uint64_t>(remaining, sizeof(buffer)));
+		if (input_.sgetn(buffer, size) != size) {
+			error("unexpected end of input");
+		}
+		text.append(buffer, static_cast<std::size_t>(size));
+		remaining -= static_cast<std::uint64_t>(size);
+		offset_ += static_cast<std::uint64_t>(size);
+	}
+	return text;
+}
+
+void CborDecoder::read_value(pt::ptree& value)
+{
+	const auto initial = input_.sgetc();
+	if (initial == std::streambuf::traits_type::eof()) {
+		error("unexpected end of input");
+	}
+
+	switch (static_cast<std::uint8_t>(initial) >> 5) {
+	case unsigned_integer:
+		value.data() = std::to_string(read_argument(get()));
+		return;
+	case negative_integer: {
+		const auto argument = read_argument(get());
+		value.data() = argument == std::numeric_limits<std::uint64_t>::max() ? "-18446744073709551616"
+		                                                                      : "-" + std::to_string(argument + 1);
+		return;
+	}
+	case text_string:
+		value.data() = read_text();
+		return;
+	case array:
+		for (auto count = read_argument(get()); count != 0; --count) {
+			read_value(value.push_back(pt::ptree::value_type(std::string(), pt::ptree()))->second);
+		}
+		return;
+	case map:
+		for (auto count = read_argument(get()); count != 0; --count) {
+			auto key = read_text();
+			read_value(value.push_back(pt::ptree::value_type(std::move(key), pt::ptree()))->second);
+		}
+		return;
+	case simple: {
+		const auto simple_initial = get();
+		switch (simple_initial & 0x1F) {
+		case simple_false: value.data() = "false"; return;
+		case simple_true: value.data() = "true"; return;
+		case simple_null: value.data() = "null"; return;
+		case simple_double: {
+			const auto bits = read_argument(simple_initial);
+			double number = 0;
+			std::memcpy(&number, &bits, sizeof(number));
+			if (not std::isfinite(number)) {
+				error("non-finite number");
+			}
+			char buffer[max_number_size];
+			value.data().assign(buffer, format_number(number, buffer));
+			return;
+		}
+		default: break;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+	error("unsupported item");
+}
+
+void CborDecoder::skip_value()
+{
+	// Walk the item headers without building the values, counting the items that remain to be skipped
+	for (std::uint64_t remaining = 1; remaining != 0; --remaining) {
+		const auto initial = get();
+		switch (initial >> 5) {
+		case unsigned_integer:
+		case negative_integer:
+			read_argument(initial);
+			break;
+		case text_string:
+			skip_bytes(read_argument(initial));
+			break;
+		case array:
+		case map: {
+			const auto count = read_argument(initial);
+			const std::uint64_t items = (initial >> 5) == map ? 2 : 1;
+			if (count > (std::numeric_limits<std::uint64_t>::max() - remaining) / items) {
+				error("too many items");
+			}
+			remaining += count * items;
+			break;
+		}
+		case simple:
+			switch (initial & 0x1F) {
+			case simple_false:
+			case simple_true:
+			case simple_null:
+				break;
+			case simple_double:
+				skip_bytes(sizeof(double));
+				break;
+			default:
+				error("unsupported item");
+			}
+			break;
+		default:
+			error("unsupported item");
+		}
+	}
+}
+
+void CborDecoder::skip_bytes(std::uint64_t size)
+{
+	while (size != 0) {
+		char buffer[16 * 1024];
+		const auto chunk = static_cast<std::streamsize>(std::min<std::uint64_t>(size, sizeof(buffer)));
+		if (input_.sgetn(buffer, chunk) != chunk) {
+			error("unexpected end of input");
+		}
+		size -= static_cast<std::uint64_t>(chunk);
+		offset_ += static_cast<std::uint64_t>(chunk);
+	}
+}
+
+void CborDecoder::error(const std::string& msg) const
+{
+	throw CborError(msg + " at offset " + std::to_string(offset_));
+}
+
+}}} // namespace reven::jsonresource::detail
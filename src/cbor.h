@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "document.h"
+
+namespace pt = boost::property_tree;
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Binary encoding of resources in CBOR (RFC 8949).
+///
+/// The document is prefixed by the self-described CBOR tag, that is used as magic to detect the encoding. It follows
+/// the conventions of `pt::write_json`: the root is a map, nodes whose children all have empty keys are arrays and
+/// leaves are text strings. Leaves holding an integer in canonical form are encoded as CBOR integers, and read back
+/// as the same text.
+///
+
+//! Self-described CBOR tag (55799), that starts every binary resource
+constexpr char cbor_magic[] = {'\xd9', '\xd9', '\xf7'};
+constexpr std::size_t cbor_magic_size = sizeof(cbor_magic);
+
+///
+/// Exception that occurs when the input is not a valid binary resource
+///
+class CborError : public std::runtime_error {
+public:
+	CborError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+//! Whether the bytes start with the magic of binary resources
+bool is_cbor(const char* data, std::size_t size);
+
+///
+/// \brief write_cbor Write the root ptree of a resource in the binary encoding
+/// \throws std::runtime_error if the ptree can't be represented in Json or if the stream fails
+void write_cbor(std::ostream& out, const pt::ptree& json);
+
+//! \copydoc write_cbor
+void write_cbor(std::ostream& out, Document& doc);
+
+///
+/// Reader of binary resources, from a stream buffer positioned on the magic
+///
+class CborDecoder {
+public:
+	explicit CborDecoder(std::streambuf& input) : input_(input) {}
+
+	//! Read the whole document into `json`
+	void read_document(pt::ptree& json);
+
+	//! Read the members of the root map up to the metadata, that are stored in `json`.
+	//! Return false if the document has no metadata.
+	bool read_metadata(pt::ptree& json);
+
+private:
+	void read_magic();
+	std::uint8_t get();
+	std::uint64_t read_argument(std::uint8_t initial);
+	std::string read_text();
+	void read_value(pt::ptree& value);
+	void skip_value();
+	void skip_bytes(std::uint64_t size);
+
+	[[noreturn]] void error(const std::string& msg) const;
+
+	std::streambuf& input_;
+	std::uint64_t offset_ = 0;
+};
+
+///
+/// Stream buffer reading a memory range, to decode binary resources that are already in memory
+///
+class MemoryBuffer : public std::streambuf {
+public:
+	MemoryBuffer(const char* begin, const char* end)
+	{
+		auto data = const_cast<char*>(begin);
+		setg(data, data, data + (end - begin));
+	}
+
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+	{
+		const auto base = dir == std::ios_base::beg ? eback() : dir == std::ios_base::cur ? gptr() : egptr();
+		const auto target = base + off;
+		if (not (which & std::ios_base::in) or target < eback() or target > egptr()) {
+			return pos_type(off_type(-1));
+		}
+		setg(eback(), target, egptr());
+		return pos_type(target - eback());
+	}
+
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+	{
+		return seekoff(off_type(pos), std::ios_base::beg, which);
+	}
+};
+
+}}} // namespace reven::jsonresource::detail
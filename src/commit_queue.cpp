@@ -0,0 +1,79 @@
+#include "commit_queue.h"
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+CommitQueue::~CommitQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	changed_.notify_all();
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+}
+
+std::future<void> CommitQueue::push(std::function<void()> commit)
+{
+	std::promise<void> promise;
+	auto future = promise.get_future();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pending_ = std::move(commit);
+		waiters_.push_back(std::move(promise));
+		if (not thread_.joinable()) {
+			thread_ = std::thread(&CommitQueue::run, this);
+		}
+	}
+	changed_.notify_all();
+	return future;
+}
+
+void CommitQueue::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	changed_.wait(lock, [this]() { return not pending_ and not running_; });
+}
+
+void CommitQueue::run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		changed_.wait(lock, [this]() { return pending_ or stopping_; });
+		if (not pending_) {
+			return;
+		}
+
+		auto commit = std::move(pending_);
+		pending_ = nullptr;
+		auto waiters = std::move(waiters_);
+		waiters_.clear();
+		running_ = true;
+		lock.unlock();
+
+		std::exception_ptr error;
+		try {
+			commit();
+		} catch (...) {
+			error = std::current_exception();
+		}
+		// Release what the commit holds before the futures are ready, so the writer can take its content back
+		commit = nullptr;
+		for (auto& waiter : waiters) {
+			if (error) {
+				waiter.set_exception(error);
+			} else {
+				waiter.set_value();
+			}
+		}
+
+		lock.lock();
+		running_ = false;
+		changed_.notify_all();
+	}
+}
+
+}}} // namespace reven::jsonresource::detail
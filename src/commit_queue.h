@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Background thread running the commits of a writer one at a time.
+///
+/// The queue is double-buffered: one commit is written while at most one other waits. A commit pushed while another
+/// is waiting replaces it, as only the last state of the resource matters, and the futures of both commits get the
+/// outcome of the one that is written.
+///
+class CommitQueue {
+public:
+	CommitQueue() = default;
+
+	//! Wait for the commits left in the queue before stopping the thread
+	~CommitQueue();
+
+	CommitQueue(const CommitQueue&) = delete;
+	CommitQueue& operator=(const CommitQueue&) = delete;
+
+	//! Queue the commit, the exceptions it throws are stored in the future
+	std::future<void> push(std::function<void()> commit);
+
+	//! Wait until every queued commit is done
+	void wait();
+
+private:
+	void run();
+
+	std::mutex mutex_;
+	std::condition_variable changed_;
+
+	std::function<void()> pending_;
+	std::vector<std::promise<void>> waiters_;
+
+	bool running_ = false;
+	bool stopping_ = false;
+	std::thread thread_;
+};
+
+}}} // namespace reven::jsonresource::detail
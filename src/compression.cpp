@@ -0,0 +1,145 @@
+#include "compression.h"
+#include "cbor.h"
+
+#include <cstdint>
+#include <fstream>
+
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/bzip2.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+namespace io = boost::iostreams;
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+constexpr std::size_t max_magic_size = 3;
+constexpr std::size_t chunk_size = 16 * 1024;
+
+}
+
+Compression detect_compression(const char* data, std::size_t size)
+{
+	const auto byte = [data](std::size_t i) { return static_cast<std::uint8_t>(data[i]); };
+
+	if (size >= 2 and byte(0) == 0x1F and byte(1) == 0x8B) {
+		return Compression::gzip;
+	}
+	if (size >= 3 and data[0] == 'B' and data[1] == 'Z' and data[2] == 'h') {
+		return Compression::bzip2;
+	}
+	// Deflate method with a valid window size and header checksum, Json resources start with '{' or a whitespace
+	if (size >= 2 and (byte(0) & 0x0F) == 8 and (byte(0) >> 4) <= 7 and ((byte(0) << 8) | byte(1)) % 31 == 0) {
+		return Compression::zlib;
+	}
+	return Compression::none;
+}
+
+PrefixedBuffer::PrefixedBuffer(const char* prefix, std::size_t size, std::streambuf& source)
+	: source_(source), buffer_(prefix, prefix + size)
+{
+	setg(buffer_.data(), buffer_.data(), buffer_.data() + buffer_.size());
+}
+
+PrefixedBuffer::int_type PrefixedBuffer::underflow()
+{
+	if (gptr() == egptr()) {
+		buffer_.resize(chunk_size);
+		const auto count = source_.sgetn(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+		setg(buffer_.data(), buffer_.data(), buffer_.data() + (count > 0 ? count : 0));
+	}
+	return gptr() == egptr() ? traits_type::eof() : traits_type::to_int_type(*gptr());
+}
+
+ResourceInput::ResourceInput(std::istream& input, bool rewind)
+	: stream_(&input)
+{
+	char magic[max_magic_size];
+	if (rewind) {
+		input.clear();
+		input.seekg(0, std::ios::beg);
+		input.read(magic, max_magic_size);
+		compression_ = detect_compression(magic, static_cast<std::size_t>(input.gcount()));
+		input.clear();
+		input.seekg(0, std::ios::beg);
+	} else {
+		// The magic is consumed, and given back by the prefixed buffer
+		const auto size = input.rdbuf()->sgetn(magic, max_magic_size);
+		compression_ = detect_compression(magic, static_cast<std::size_t>(size > 0 ? size : 0));
+		prefixed_buffer_ = std::make_unique<PrefixedBuffer>(magic, static_cast<std::size_t>(size > 0 ? size : 0),
+		                                                    *input.rdbuf());
+		prefixed_ = std::make_unique<std::istream>(prefixed_buffer_.get());
+		stream_ = prefixed_.get();
+	}
+
+	if (compression_ == Compression::none) {
+		return;
+	}
+
+	filter_ = std::make_unique<io::filtering_istream>();
+	switch (compression_) {
+	case Compression::gzip: filter_->push(io::gzip_decompressor()); break;
+	case Compression::zlib: filter_->push(io::zlib_decompressor()); break;
+	case Compression::bzip2: filter_->push(io::bzip2_decompressor()); break;
+	case Compression::none: break;
+	}
+	filter_->push(*stream_);
+	stream_ = filter_.get();
+}
+
+bool ResourceInput::is_binary()
+{
+	return stream_->rdbuf()->sgetc() == std::char_traits<char>::to_int_type(cbor_magic[0]);
+}
+
+namespace {
+
+void push_compressor(io::filtering_ostream& stream, Compression compression, int level)
+{
+	switch (compression) {
+	case Compression::gzip:
+		stream.push(io::gzip_compressor(level < 0 ? io::zlib::default_compression : level));
+		break;
+	case Compression::zlib:
+		stream.push(io::zlib_compressor(level < 0 ? io::zlib::default_compression : level));
+		break;
+	case Compression::bzip2:
+		stream.push(io::bzip2_compressor(level < 0 ? io::bzip2::default_block_size : level));
+		break;
+	case Compression::none:
+		break;
+	}
+}
+
+}
+
+std::unique_ptr<std::ostream> open_output(const char* filename, Compression compression, int level)
+{
+	if (compression == Compression::none) {
+		return std::make_unique<std::ofstream>(filename, std::fstream::trunc);
+	}
+
+	io::file_sink file(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (not file.is_open()) {
+		throw WriterError("Bad stream");
+	}
+
+	auto stream = std::make_unique<io::filtering_ostream>();
+	push_compressor(*stream, compression, level);
+	stream->push(file);
+	return stream;
+}
+
+std::unique_ptr<io::filtering_ostream> open_output(std::ostream& sink, Compression compression, int level)
+{
+	auto stream = std::make_unique<io::filtering_ostream>();
+	push_compressor(*stream, compression, level);
+	stream->push(sink);
+	return stream;
+}
+
+}}} // namespace reven::jsonresource::detail
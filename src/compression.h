@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include "writer.h"
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+//! Detect the compression from the first bytes of a resource
+Compression detect_compression(const char* data, std::size_t size);
+
+///
+/// Stream buffer that gives back bytes already consumed from a source before reading the rest of the source.
+/// It allows to look at the first bytes of a stream that can't be rewound.
+///
+class PrefixedBuffer : public std::streambuf {
+public:
+	PrefixedBuffer(const char* prefix, std::size_t size, std::streambuf& source);
+
+protected:
+	int_type underflow() override;
+
+private:
+	std::streambuf& source_;
+	std::vector<char> buffer_;
+};
+
+///
+/// Input of a resource, that is transparently decompressed when its first bytes are the magic of a compression format
+///
+class ResourceInput {
+public:
+	///
+	/// \param rewind Whether to read the stream from its beginning. Otherwise the stream is read from its current
+	/// position and is never seeked, so it can be a pipe or a socket.
+	explicit ResourceInput(std::istream& input, bool rewind = true);
+
+	ResourceInput(const ResourceInput&) = delete;
+	ResourceInput& operator=(const ResourceInput&) = delete;
+
+	Compression compression() const { return compression_; }
+
+	//! The decompressed content of the resource. It is decompressed while it is read, so reading only the
+	//! beginning of the resource only decompresses the beginning of the file.
+	std::istream& stream() { return *stream_; }
+
+	//! Whether the content is a binary resource, detected without consuming it
+	bool is_binary();
+
+private:
+	Compression compression_ = Compression::none;
+	std::unique_ptr<PrefixedBuffer> prefixed_buffer_;
+	std::unique_ptr<std::istream> prefixed_;
+	std::unique_ptr<boost::iostreams::filtering_istream> filter_;
+	std::istream* stream_;
+};
+
+///
+/// \brief open_output Open the file for writing, through a compressor if requested
+/// \param level The compression level, -1 for the default level of the format
+/// \throws std::runtime_error if the file can't be opened
+std::unique_ptr<std::ostream> open_output(const char* filename, Compression compression, int level);
+
+///
+/// \brief open_output Stream writing to `sink`, through a compressor if requested
+/// The compressed data are only complete once the returned stream is reset or destroyed.
+/// \param level The compression level, -1 for the default level of the format
+std::unique_ptr<boost::iostreams::filtering_ostream> open_output(std::ostream& sink, Compression compression,
+                                                                 int level);
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,63 @@
+#include "custom_metadata.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace reven {
+namespace jsonresource {
+
+CustomMetadata::CustomMetadata(std::vector<value_type> entries) : entries_(std::move(entries))
+{
+	// Stable, so that the first entry of a repeated key comes first and is the one kept
+	std::stable_sort(entries_.begin(), entries_.end(),
+	                 [](const value_type& lhs, const value_type& rhs) { return lhs.first < rhs.first; });
+	entries_.erase(std::unique(entries_.begin(), entries_.end(),
+	                           [](const value_type& lhs, const value_type& rhs) { return lhs.first == rhs.first; }),
+	               entries_.end());
+	entries_.shrink_to_fit();
+}
+
+CustomMetadata::iterator CustomMetadata::lower_bound(boost::string_view key)
+{
+	return std::lower_bound(entries_.begin(), entries_.end(), key,
+	                        [](const value_type& entry, boost::string_view key) { return entry.first < key; });
+}
+
+std::pair<CustomMetadata::iterator, bool> CustomMetadata::emplace(std::string key, std::string value)
+{
+	const auto position = lower_bound(key);
+	if (position != entries_.end() and position->first == key) {
+		return {position, false};
+	}
+	return {entries_.emplace(position, std::move(key), std::move(value)), true};
+}
+
+CustomMetadata::iterator CustomMetadata::find(boost::string_view key)
+{
+	const auto position = lower_bound(key);
+	if (position != entries_.end() and position->first == key) {
+		return position;
+	}
+	return entries_.end();
+}
+
+CustomMetadata::const_iterator CustomMetadata::find(boost::string_view key) const
+{
+	return const_cast<CustomMetadata*>(this)->find(key);
+}
+
+std::string& CustomMetadata::at(boost::string_view key)
+{
+	const auto position = find(key);
+	if (position == entries_.end()) {
+		throw std::out_of_range("No such custom metadata");
+	}
+	return position->second;
+}
+
+const std::string& CustomMetadata::at(boost::string_view key) const
+{
+	return const_cast<CustomMetadata*>(this)->at(key);
+}
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,515 @@
+#include "document.h"
+#include "json_emitter.h"
+#include "json_scanner.h"
+#include "number.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace reven {
+namespace jsonresource {
+
+namespace detail {
+
+namespace {
+
+constexpr std::size_t min_block_size = 64 * 1024;
+constexpr std::size_t max_block_size = 4 * 1024 * 1024;
+
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+	blocks_ = std::move(other.blocks_);
+	current_ = other.current_;
+	remaining_ = other.remaining_;
+	allocated_bytes_ = other.allocated_bytes_;
+	other.blocks_.clear();
+	other.current_ = nullptr;
+	other.remaining_ = 0;
+	other.allocated_bytes_ = 0;
+	return *this;
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment)
+{
+	auto padding = [this, alignment]() {
+		return (alignment - reinterpret_cast<std::uintptr_t>(current_) % alignment) % alignment;
+	};
+
+	if (current_ == nullptr or remaining_ < size + padding()) {
+		// Blocks grow with the document to keep the number of allocations logarithmic
+		const auto block_size = std::max(size + alignment,
+		                                 std::min(max_block_size, std::max(min_block_size, allocated_bytes_)));
+		blocks_.emplace_back(new char[block_size]);
+		current_ = blocks_.back().get();
+		remaining_ = block_size;
+		allocated_bytes_ += block_size;
+	}
+
+	const auto pad = padding();
+	void* result = current_ + pad;
+	current_ += pad + size;
+	remaining_ -= pad + size;
+	return result;
+}
+
+boost::string_view Arena::store(boost::string_view str)
+{
+	if (str.empty()) {
+		return {};
+	}
+	auto data = static_cast<char*>(allocate(str.size(), 1));
+	std::memcpy(data, str.data(), str.size());
+	return {data, str.size()};
+}
+
+namespace {
+
+void read_node(JsonScanner& scanner, DocumentNode node)
+{
+	switch (scanner.peek()) {
+	case '{':
+		scanner.expect('{');
+		if (scanner.consume('}')) {
+			return;
+		}
+		do {
+			const auto key = scanner.read_string();
+			scanner.expect(':');
+			read_node(scanner, node.push_back(key));
+		} while (scanner.consume(','));
+		scanner.expect('}');
+		return;
+	case '[':
+		scanner.expect('[');
+		if (scanner.consume(']')) {
+			return;
+		}
+		do {
+			read_node(scanner, node.push_back({}));
+		} while (scanner.consume(','));
+		scanner.expect(']');
+		return;
+	case '"':
+		node.put_value(scanner.read_string());
+		return;
+	default:
+		break;
+	}
+
+	// Literals keep their type, and numbers their text
+	const auto literal = scanner.read_literal();
+	if (literal == "true" or literal == "false") {
+		node.put_value(literal == "true");
+	} else if (literal == "null") {
+		node.put_null();
+	} else {
+		node.put_number(literal);
+	}
+}
+
+//! Copy the value of the node, with its type
+void copy_value(const NodeData* node, DocumentNode copy)
+{
+	switch (node->type) {
+	case ValueType::string:
+		copy.put_value(node->data);
+		return;
+	case ValueType::unsigned_integer:
+	case ValueType::signed_integer:
+	case ValueType::number:
+		copy.put_number(node->data);
+		return;
+	case ValueType::floating:
+		// Non-finite values have no Json text
+		if (std::isfinite(node->value.floating)) {
+			copy.put_number(node->data);
+		} else {
+			copy.put_value(node->value.floating);
+		}
+		return;
+	case ValueType::boolean:
+		copy.put_value(node->value.boolean);
+		return;
+	case ValueType::null:
+		copy.put_null();
+		return;
+	}
+}
+
+void copy_ptree(const pt::ptree& json, DocumentNode node)
+{
+	node.put_value(json.data());
+	for (const auto& child : json) {
+		copy_ptree(child.second, node.push_back(child.first));
+	}
+}
+
+void copy_node(const NodeData* node, pt::ptree& json)
+{
+	json.data().assign(node->data.data(), node->data.size());
+	for (auto child = node->first_child; child != nullptr; child = child->next) {
+		auto it = json.push_back(pt::ptree::value_type(std::string(child->key.data(), child->key.size()),
+		                                               pt::ptree()));
+		copy_node(child, it->second);
+	}
+}
+
+void copy_node(const NodeData* node, DocumentNode copy)
+{
+	copy_value(node, copy);
+	for (auto child = node->first_child; child != nullptr; child = child->next) {
+		copy_node(child, copy.push_back(child->key));
+	}
+}
+
+bool is_array(const NodeData* node)
+{
+	for (auto child = node->first_child; child != nullptr; child = child->next) {
+		if (not child->key.empty()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool verify_json(const NodeData* node, bool root)
+{
+	if (not node->data.empty() and (root or node->first_child != nullptr)) {
+		return false;
+	}
+	if (node->type == ValueType::floating and not std::isfinite(node->value.floating)) {
+		return false;
+	}
+	for (auto child = node->first_child; child != nullptr; child = child->next) {
+		if (not verify_json(child, false)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void write_node(JsonEmitter& emitter, const NodeData* node)
+{
+	if (node->first_child == nullptr and node->type == ValueType::string) {
+		emitter.string(node->data);
+	} else if (node->first_child == nullptr) {
+		emitter.raw(node->data);
+	} else if (is_array(node)) {
+		emitter.begin_array();
+		for (auto child = node->first_child; child != nullptr; child = child->next) {
+			write_node(emitter, child);
+		}
+		emitter.end_array();
+	} else {
+		emitter.begin_object();
+		for (auto child = node->first_child; child != nullptr; child = child->next) {
+			emitter.key(child->key);
+			write_node(emitter, child);
+		}
+		emitter.end_object();
+	}
+}
+
+}
+
+} // namespace detail
+
+void DocumentNode::put_value(boost::string_view value)
+{
+	node_->data = doc_->arena_.store(value);
+	node_->type = ValueType::string;
+}
+
+void DocumentNode::put_null()
+{
+	node_->data = "null";
+	node_->type = ValueType::null;
+}
+
+void DocumentNode::put_number(boost::string_view text)
+{
+	if (not detail::is_json_number(text)) {
+		throw std::runtime_error("'" + text.to_string() + "' is not a Json number");
+	}
+
+	// Integers that overflow 64 bits are not stored as doubles, that would round them
+	const bool integer = text.find_first_of(".eE") == boost::string_view::npos;
+	if (detail::parse_number(text, node_->value.unsigned_integer)) {
+		node_->type = ValueType::unsigned_integer;
+	} else if (detail::parse_number(text, node_->value.signed_integer)) {
+		node_->type = ValueType::signed_integer;
+	} else if (not integer and detail::parse_number(text, node_->value.floating)) {
+		node_->type = ValueType::floating;
+	} else {
+		node_->type = ValueType::number;
+		node_->value.unsigned_integer = 0;
+	}
+	node_->data = doc_->arena_.store(text);
+}
+
+void DocumentNode::put_native(std::uint64_t value)
+{
+	char buffer[detail::max_number_size];
+	node_->data = doc_->arena_.store(boost::string_view(buffer, detail::format_number(value, buffer)));
+	node_->type = ValueType::unsigned_integer;
+	node_->value.unsigned_integer = value;
+}
+
+void DocumentNode::put_native(std::int64_t value)
+{
+	char buffer[detail::max_number_size];
+	node_->data = doc_->arena_.store(boost::string_view(buffer, detail::format_number(value, buffer)));
+	node_->type = ValueType::signed_integer;
+	node_->value.signed_integer = value;
+}
+
+void DocumentNode::put_native(double value)
+{
+	if (std::isfinite(value)) {
+		char buffer[detail::max_number_size];
+		node_->data = doc_->arena_.store(boost::string_view(buffer, detail::format_number(value, buffer)));
+	} else {
+		// Rejected when the document is written
+		node_->data = std::isnan(value) ? "nan" : value > 0 ? "inf" : "-inf";
+	}
+	node_->type = ValueType::floating;
+	node_->value.floating = value;
+}
+
+void DocumentNode::put_native(bool value)
+{
+	node_->data = value ? "true" : "false";
+	node_->type = ValueType::boolean;
+	node_->value.boolean = value;
+}
+
+bool DocumentNode::get_native(std::uint64_t& value) const
+{
+	switch (node_->type) {
+	case ValueType::string:
+	case ValueType::number:
+		return detail::parse_number(node_->data, value);
+	case ValueType::unsigned_integer:
+		value = node_->value.unsigned_integer;
+		return true;
+	case ValueType::signed_integer:
+		value = static_cast<std::uint64_t>(node_->value.signed_integer);
+		return node_->value.signed_integer >= 0;
+	default:
+		return false;
+	}
+}
+
+bool DocumentNode::get_native(std::int64_t& value) const
+{
+	switch (node_->type) {
+	case ValueType::string:
+	case ValueType::number:
+		return detail::parse_number(node_->data, value);
+	case ValueType::unsigned_integer:
+		value = static_cast<std::int64_t>(node_->value.unsigned_integer);
+		return node_->value.unsigned_integer <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+	case ValueType::signed_integer:
+		value = node_->value.signed_integer;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool DocumentNode::get_native(double& value) const
+{
+	switch (node_->type) {
+	case ValueType::string:
+	case ValueType::number:
+		return detail::parse_number(node_->data, value);
+	case ValueType::unsigned_integer:
+		value = static_cast<double>(node_->value.unsigned_integer);
+		return true;
+	case ValueType::signed_integer:
+		value = static_cast<double>(node_->value.signed_integer);
+		return true;
+	case ValueType::floating:
+		value = node_->value.floating;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool DocumentNode::get_native(bool& value) const
+{
+	if (node_->type == ValueType::boolean) {
+		value = node_->value.boolean;
+		return true;
+	}
+	if (node_->type == ValueType::string and (node_->data == "true" or node_->data == "false")) {
+		value = node_->data == "true";
+		return true;
+	}
+	return false;
+}
+
+detail::NodeData* DocumentNode::new_child(boost::string_view key)
+{
+	auto child = new (doc_->arena_.allocate(sizeof(detail::NodeData), alignof(detail::NodeData))) detail::NodeData;
+	child->key = doc_->arena_.store(key);
+	++node_->size;
+	return child;
+}
+
+DocumentNode DocumentNode::push_back(boost::string_view key)
+{
+	auto child = new_child(key);
+	if (node_->last_child != nullptr) {
+		node_->last_child->next = child;
+	} else {
+		node_->first_child = child;
+	}
+	node_->last_child = child;
+	return DocumentNode(doc_, child);
+}
+
+DocumentNode DocumentNode::push_front(boost::string_view key)
+{
+	auto child = new_child(key);
+	child->next = node_->first_child;
+	node_->first_child = child;
+	if (node_->last_child == nullptr) {
+		node_->last_child = child;
+	}
+	return DocumentNode(doc_, child);
+}
+
+DocumentNode DocumentNode::put(boost::string_view key, boost::string_view value)
+{
+	auto child = push_back(key);
+	child.put_value(value);
+	return child;
+}
+
+DocumentNode DocumentNode::add_child(boost::string_view key, const pt::ptree& json)
+{
+	auto child = push_back(key);
+	child.assign(json);
+	return child;
+}
+
+void DocumentNode::assign(const pt::ptree& json)
+{
+	detail::copy_ptree(json, *this);
+}
+
+boost::optional<DocumentNode> DocumentNode::get_child_optional(boost::string_view key) const
+{
+	for (auto child = node_->first_child; child != nullptr; child = child->next) {
+		if (child->key == key) {
+			return DocumentNode(doc_, child);
+		}
+	}
+	return boost::none;
+}
+
+std::size_t DocumentNode::erase(boost::string_view key)
+{
+	// Erased nodes stay in the arena until the document is destroyed
+	std::size_t count = 0;
+	detail::NodeData* previous = nullptr;
+	for (auto child = node_->first_child; child != nullptr; child = child->next) {
+		if (child->key != key) {
+			previous = child;
+			continue;
+		}
+		if (previous != nullptr) {
+			previous->next = child->next;
+		} else {
+			node_->first_child = child->next;
+		}
+		++count;
+	}
+	node_->last_child = previous;
+	node_->size -= count;
+	return count;
+}
+
+pt::ptree DocumentNode::to_ptree() const
+{
+	pt::ptree json;
+	detail::copy_node(node_, json);
+	return json;
+}
+
+Document::Document(Document&& other) noexcept
+	: arena_(std::move(other.arena_)), root_(other.root_)
+{
+	other.root_ = detail::NodeData();
+}
+
+Document& Document::operator=(Document&& other) noexcept
+{
+	arena_ = std::move(other.arena_);
+	root_ = other.root_;
+	other.root_ = detail::NodeData();
+	return *this;
+}
+
+Document Document::read_json(std::istream& input)
+{
+	Document doc;
+	detail::JsonScanner scanner(input);
+	scanner.skip_bom();
+	detail::read_node(scanner, doc.root());
+	if (scanner.peek() != 0) {
+		throw detail::JsonScanError("garbage after data at offset " + std::to_string(scanner.offset()));
+	}
+	return doc;
+}
+
+Document Document::from_ptree(const pt::ptree& json)
+{
+	Document doc;
+	detail::copy_ptree(json, doc.root());
+	return doc;
+}
+
+pt::ptree Document::to_ptree() const
+{
+	pt::ptree json;
+	detail::copy_node(&root_, json);
+	return json;
+}
+
+Document Document::copy() const
+{
+	Document doc;
+	detail::copy_node(&root_, doc.root());
+	return doc;
+}
+
+void write_json(std::ostream& out, const Document& doc, const OutputFormat& format)
+{
+	if (not detail::verify_json(&doc.root_, true)) {
+		throw std::runtime_error("document contains data that cannot be represented in JSON format");
+	}
+
+	detail::JsonEmitter emitter(out, format);
+	emitter.begin_object();
+	for (auto child = doc.root_.first_child; child != nullptr; child = child->next) {
+		emitter.key(child->key);
+		detail::write_node(emitter, child);
+		if (child->key == "metadata") {
+			emitter.padding(format.metadata_padding);
+		}
+	}
+	emitter.end_object();
+	emitter.end_document();
+	if (not out.good()) {
+		throw std::runtime_error("write error");
+	}
+}
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,56 @@
+#include "error.h"
+#include "common.h"
+#include "metadata.h"
+#include "reader.h"
+
+namespace reven {
+namespace jsonresource {
+
+std::string ResourceError::message() const
+{
+	switch (code_) {
+	case ErrorCode::none:
+		return {};
+	case ErrorCode::read_error:
+	case ErrorCode::read_metadata_error:
+		return detail_;
+	case ErrorCode::missing_metadata:
+		return "Missing \"metadata\" field";
+	case ErrorCode::missing_metadata_version:
+		return "Missing \"metadata_version\" field";
+	case ErrorCode::incompatible_metadata_version:
+		return "Can't read a metadata with metadata version bigger than the current (" + std::to_string(version_) +
+		       " > " + std::to_string(metadata_version) + ")";
+	case ErrorCode::missing_metadata_field:
+		return std::string("Missing metadata field: No such node (metadata.") + name_ + ")";
+	case ErrorCode::bad_metadata_field:
+		return std::string("Can't read a metadata field: conversion of data to type \"") + name_ + "\" failed";
+	}
+	return {};
+}
+
+void ResourceError::raise() const
+{
+	const auto msg = message();
+	switch (code_) {
+	case ErrorCode::none:
+		break;
+	case ErrorCode::read_error:
+		throw ReaderError(msg.c_str());
+	case ErrorCode::read_metadata_error:
+		throw ReadMetadataError(msg.c_str());
+	case ErrorCode::missing_metadata:
+		throw MissingMetadata(msg.c_str());
+	case ErrorCode::missing_metadata_version:
+		throw MissingMetadataVersion(msg.c_str());
+	case ErrorCode::incompatible_metadata_version:
+		throw IncompatibleMetadataVersion(msg.c_str());
+	case ErrorCode::missing_metadata_field:
+		throw MissingMetadataField(msg.c_str());
+	case ErrorCode::bad_metadata_field:
+		throw BadMetadataField(msg.c_str());
+	}
+	throw std::logic_error("No error to raise");
+}
+
+}} // namespace reven::jsonresource
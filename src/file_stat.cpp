@@ -0,0 +1,23 @@
+#include "file_stat.h"
+
+#include <sys/stat.h>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+bool stat_file(const char* filename, FileStat& st)
+{
+	struct stat buf;
+	if (::stat(filename, &buf) != 0) {
+		return false;
+	}
+
+	st.device = static_cast<std::uint64_t>(buf.st_dev);
+	st.inode = static_cast<std::uint64_t>(buf.st_ino);
+	st.size = static_cast<std::uint64_t>(buf.st_size);
+	st.mtime = static_cast<std::int64_t>(buf.st_mtim.tv_sec) * 1000000000 + buf.st_mtim.tv_nsec;
+	return true;
+}
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Identity and state of a file, used to detect when a file changed
+///
+struct FileStat {
+	std::uint64_t device = 0;
+	std::uint64_t inode = 0;
+	std::uint64_t size = 0;
+	//! Last modification time, in nanoseconds since the epoch
+	std::int64_t mtime = 0;
+
+	bool operator==(const FileStat& other) const
+	{
+		return device == other.device and inode == other.inode and size == other.size and mtime == other.mtime;
+	}
+	bool operator!=(const FileStat& other) const { return not (*this == other); }
+};
+
+//! Fill `st` with the state of the file, return false if the file can't be stat'ed
+bool stat_file(const char* filename, FileStat& st);
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,42 @@
+#include "format.h"
+
+namespace reven {
+namespace jsonresource {
+
+namespace {
+
+// The fields are stored shifted by one, so that 0 (the initial value of an iword) means "not set"
+const int indent_index = std::ios_base::xalloc();
+const int compact_index = std::ios_base::xalloc();
+const int padding_index = std::ios_base::xalloc();
+
+}
+
+namespace detail {
+
+std::ostream& operator<<(std::ostream& stream, const FormatManipulator& manipulator)
+{
+	stream.iword(indent_index) = static_cast<long>(manipulator.format.indent) + 1;
+	stream.iword(compact_index) = manipulator.format.compact ? 2 : 1;
+	stream.iword(padding_index) = static_cast<long>(manipulator.format.metadata_padding) + 1;
+	return stream;
+}
+
+}
+
+OutputFormat get_format(std::ios_base& stream)
+{
+	OutputFormat format;
+	if (stream.iword(indent_index) != 0) {
+		format.indent = static_cast<std::size_t>(stream.iword(indent_index) - 1);
+	}
+	if (stream.iword(compact_index) != 0) {
+		format.compact = stream.iword(compact_index) == 2;
+	}
+	if (stream.iword(padding_index) != 0) {
+		format.metadata_padding = static_cast<std::size_t>(stream.iword(padding_index) - 1);
+	}
+	return format;
+}
+
+}} // namespace reven::jsonresource
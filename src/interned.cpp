@@ -0,0 +1,120 @@
+#include "interned.h"
+#include "metadata.h"
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+std::size_t hash_value(const std::string& value)
+{
+	return std::hash<std::string>()(value);
+}
+
+std::size_t hash_value(const CustomMetadata& value)
+{
+	std::size_t hash = value.size();
+	for (const auto& entry : value) {
+		hash = (hash * 31 + hash_value(entry.first)) * 31 + hash_value(entry.second);
+	}
+	return hash;
+}
+
+//! The pool is split in shards selected by the hash of the values, each with its own lock, so threads interning
+//! different values rarely wait for each other
+template <typename T>
+class Pool {
+public:
+	//! Never destroyed, as handles can outlive static objects
+	static Pool& instance()
+	{
+		static auto pool = new Pool();
+		return *pool;
+	}
+
+	std::shared_ptr<const T> intern(T&& value)
+	{
+		const auto hash = hash_value(value);
+		auto& shard = shard_of(hash);
+
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		const auto range = shard.entries.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			// An expired entry is being released, its deleter waits for the lock to remove it
+			auto ptr = it->second.weak.lock();
+			if (ptr and *ptr == value) {
+				return ptr;
+			}
+		}
+
+		std::shared_ptr<const T> ptr(new T(std::move(value)),
+		                             [this, hash](const T* released) { release(released, hash); });
+		shard.entries.emplace(hash, Entry{ptr.get(), ptr});
+		return ptr;
+	}
+
+private:
+	struct Entry {
+		const T* value;
+		std::weak_ptr<const T> weak;
+	};
+
+	struct Shard {
+		std::mutex mutex;
+		std::unordered_multimap<std::size_t, Entry> entries;
+	};
+
+	static constexpr std::size_t shard_count = 64;
+
+	Shard& shard_of(std::size_t hash)
+	{
+		// The low bits also select the bucket in the shard, mix the high ones in
+		return shards_[(hash ^ (hash >> 16) ^ (hash >> 24)) % shard_count];
+	}
+
+	void release(const T* value, std::size_t hash)
+	{
+		{
+			auto& shard = shard_of(hash);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			const auto range = shard.entries.equal_range(hash);
+			for (auto it = range.first; it != range.second; ++it) {
+				if (it->second.value == value) {
+					shard.entries.erase(it);
+					break;
+				}
+			}
+		}
+		delete value;
+	}
+
+	Shard shards_[shard_count];
+};
+
+}
+
+template <typename T>
+Interned<T>::Interned(T value)
+{
+	if (not value.empty()) {
+		ptr_ = Pool<T>::instance().intern(std::move(value));
+	}
+}
+
+template <typename T>
+const T& Interned<T>::empty()
+{
+	static const T value{};
+	return value;
+}
+
+template class Interned<std::string>;
+template class Interned<CustomMetadata>;
+
+}}} // namespace reven::jsonresource::detail
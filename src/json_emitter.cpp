@@ -0,0 +1,219 @@
+#include "json_emitter.h"
+#include "metadata.h"
+#include "number.h"
+
+#include <stdexcept>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+bool is_plain(unsigned char c)
+{
+	// Same escaping rules as pt::write_json: everything else than control characters, '"', '/' and '\' is kept
+	return c == 0x20 or c == 0x21 or (c >= 0x23 and c <= 0x2E) or (c >= 0x30 and c <= 0x5B) or c >= 0x5D;
+}
+
+}
+
+void JsonEmitter::newline()
+{
+	if (compact_) {
+		return;
+	}
+	out_.put('\n');
+	for (std::size_t i = 0; i < (base_depth_ + empty_.size()) * indent_; ++i) {
+		out_.put(' ');
+	}
+}
+
+void JsonEmitter::before_value()
+{
+	if (after_key_) {
+		after_key_ = false;
+		return;
+	}
+	if (empty_.empty()) {
+		return;
+	}
+	if (not empty_.back()) {
+		out_.put(',');
+	}
+	empty_.back() = false;
+	newline();
+}
+
+void JsonEmitter::begin_container(char c)
+{
+	before_value();
+	out_.put(c);
+	empty_.push_back(true);
+}
+
+void JsonEmitter::end_container(char c)
+{
+	empty_.pop_back();
+	newline();
+	out_.put(c);
+}
+
+void JsonEmitter::key(boost::string_view key)
+{
+	before_value();
+	out_.put('"');
+	write_escaped(key);
+	out_.write("\": ", compact_ ? 2 : 3);
+	after_key_ = true;
+}
+
+void JsonEmitter::string(boost::string_view value)
+{
+	before_value();
+	out_.put('"');
+	write_escaped(value);
+	out_.put('"');
+}
+
+void JsonEmitter::raw(boost::string_view value)
+{
+	before_value();
+	out_.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+void JsonEmitter::padding(std::size_t size)
+{
+	for (std::size_t i = 0; i < size; ++i) {
+		out_.put(' ');
+	}
+}
+
+void JsonEmitter::end_document()
+{
+	out_.put('\n');
+	out_.flush();
+}
+
+void JsonEmitter::write_escaped(boost::string_view str)
+{
+	static constexpr char hexdigits[] = "0123456789ABCDEF";
+
+	const char* run = str.data();
+	const char* const end = str.data() + str.size();
+	for (const char* it = run; it != end; ++it) {
+		const auto c = static_cast<unsigned char>(*it);
+		if (is_plain(c)) {
+			continue;
+		}
+
+		out_.write(run, it - run);
+		run = it + 1;
+
+		char escape[6] = {'\\', 0, 0, 0, 0, 0};
+		std::streamsize size = 2;
+		switch (c) {
+		case '\b': escape[1] = 'b'; break;
+		case '\f': escape[1] = 'f'; break;
+		case '\n': escape[1] = 'n'; break;
+		case '\r': escape[1] = 'r'; break;
+		case '\t': escape[1] = 't'; break;
+		case '/': escape[1] = '/'; break;
+		case '"': escape[1] = '"'; break;
+		case '\\': escape[1] = '\\'; break;
+		default:
+			escape[1] = 'u';
+			escape[2] = '0';
+			escape[3] = '0';
+			escape[4] = hexdigits[c >> 4];
+			escape[5] = hexdigits[c & 0xF];
+			size = 6;
+		}
+		out_.write(escape, size);
+	}
+	out_.write(run, end - run);
+}
+
+void emit_ptree(JsonEmitter& emitter, const boost::property_tree::ptree& json, bool root)
+{
+	if (not root and json.empty()) {
+		emitter.string(json.data());
+	} else if (not root and json.count(std::string()) == json.size()) {
+		emitter.begin_array();
+		for (const auto& child : json) {
+			emit_ptree(emitter, child.second, false);
+		}
+		emitter.end_array();
+	} else {
+		emitter.begin_object();
+		for (const auto& child : json) {
+			emitter.key(child.first);
+			emit_ptree(emitter, child.second, false);
+		}
+		emitter.end_object();
+	}
+}
+
+void emit_metadata(JsonEmitter& emitter, const boost::property_tree::ptree& jmetadata)
+{
+	if (jmetadata.empty()) {
+		emit_ptree(emitter, jmetadata, false);
+		return;
+	}
+
+	emitter.begin_object();
+	for (const auto& child : jmetadata) {
+		emitter.key(child.first);
+		const auto& value = child.second;
+		if (value.empty() and is_number_field(child.first) and is_json_number(value.data())) {
+			emitter.raw(value.data());
+		} else {
+			emit_ptree(emitter, value, false);
+		}
+	}
+	emitter.end_object();
+}
+
+namespace {
+
+bool verify_json(const boost::property_tree::ptree& json, bool root)
+{
+	if (not json.data().empty() and (root or not json.empty())) {
+		return false;
+	}
+	for (const auto& child : json) {
+		if (not verify_json(child.second, false)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+void emit_document(std::ostream& out, const boost::property_tree::ptree& json, const OutputFormat& format)
+{
+	if (not verify_json(json, true)) {
+		throw std::runtime_error("ptree contains data that cannot be represented in JSON format");
+	}
+
+	JsonEmitter emitter(out, format);
+	emitter.begin_object();
+	for (const auto& child : json) {
+		emitter.key(child.first);
+		if (child.first == "metadata") {
+			emit_metadata(emitter, child.second);
+			emitter.padding(format.metadata_padding);
+		} else {
+			emit_ptree(emitter, child.second, false);
+		}
+	}
+	emitter.end_object();
+	emitter.end_document();
+
+	if (not out.good()) {
+		throw std::runtime_error("write error");
+	}
+}
+
+}}} // namespace reven::jsonresource::detail
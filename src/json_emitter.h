@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include "format.h"
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Token-level Json writer.
+/// Strings are escaped straight into the stream, and the default layout matches the one of `pt::write_json`.
+///
+class JsonEmitter {
+public:
+	//! \param base_depth Number of containers written by other means, in which the written value is nested
+	explicit JsonEmitter(std::ostream& out, const OutputFormat& format = {}, std::size_t base_depth = 0)
+		: out_(out), indent_(format.indent), compact_(format.compact), base_depth_(base_depth) {}
+
+	void begin_object() { begin_container('{'); }
+	void end_object() { end_container('}'); }
+	void begin_array() { begin_container('['); }
+	void end_array() { end_container(']'); }
+
+	//! Write the key of the next object member
+	void key(boost::string_view key);
+
+	//! Write a string value
+	void string(boost::string_view value);
+
+	//! Write a value as is (numbers, booleans, null)
+	void raw(boost::string_view value);
+
+	//! Write whitespaces after the last value
+	void padding(std::size_t size);
+
+	//! Terminate the root value
+	void end_document();
+
+	//! Number of containers currently opened
+	std::size_t depth() const { return empty_.size(); }
+
+	std::ostream& stream() { return out_; }
+
+private:
+	void begin_container(char c);
+	void end_container(char c);
+	void before_value();
+	void newline();
+	void write_escaped(boost::string_view str);
+
+	std::ostream& out_;
+	std::size_t indent_;
+	bool compact_;
+	std::size_t base_depth_;
+
+	//! For each opened container, whether it has no element yet
+	std::vector<bool> empty_;
+	bool after_key_ = false;
+};
+
+///
+/// \brief emit_ptree Write the ptree with the conventions of `pt::write_json`
+/// Leaves are written as strings and nodes whose children all have empty keys as arrays.
+/// \param root Whether the ptree is the root of the document, that is always written as an object
+void emit_ptree(JsonEmitter& emitter, const boost::property_tree::ptree& json, bool root);
+
+///
+/// \brief emit_metadata Write the value of the "metadata" member, with the number fields written without quotes
+void emit_metadata(JsonEmitter& emitter, const boost::property_tree::ptree& jmetadata);
+
+///
+/// \brief emit_document Write the root ptree of a resource, laid out according to the format
+/// The metadata are written with `emit_metadata`.
+void emit_document(std::ostream& out, const boost::property_tree::ptree& json, const OutputFormat& format);
+
+}}} // namespace reven::jsonresource::detail
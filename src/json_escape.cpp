@@ -0,0 +1,55 @@
+#include "json_escape.h"
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+int hex_digit(int c)
+{
+	if (c >= '0' and c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' and c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' and c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+int trailing_bytes(unsigned char lead)
+{
+	if (lead < 0xc0) {
+		return -1;
+	}
+	if (lead < 0xe0) {
+		return 1;
+	}
+	if (lead < 0xf0) {
+		return 2;
+	}
+	return lead < 0xf8 ? 3 : -1;
+}
+
+void append_utf8(unsigned codepoint, std::string& out)
+{
+	const auto trail = [](unsigned bits) { return static_cast<char>(0x80 | (bits & 0x3F)); };
+	if (codepoint < 0x80) {
+		out += static_cast<char>(codepoint);
+	} else if (codepoint < 0x800) {
+		out += static_cast<char>(0xC0 | (codepoint >> 6));
+		out += trail(codepoint);
+	} else if (codepoint < 0x10000) {
+		out += static_cast<char>(0xE0 | (codepoint >> 12));
+		out += trail(codepoint >> 6);
+		out += trail(codepoint);
+	} else {
+		out += static_cast<char>(0xF0 | (codepoint >> 18));
+		out += trail(codepoint >> 12);
+		out += trail(codepoint >> 6);
+		out += trail(codepoint);
+	}
+}
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Decoding of Json strings, shared by the scanner and the parser.
+///
+
+//! Value of the hexadecimal digit, or -1 if the character is not one
+int hex_digit(int c);
+
+//! Number of continuation bytes following the lead byte of a UTF-8 sequence, or -1 if the byte can't start one
+int trailing_bytes(unsigned char lead);
+
+//! Append the UTF-8 encoding of the codepoint
+void append_utf8(unsigned codepoint, std::string& out);
+
+///
+/// \brief decode_escape Decode the escape sequence following a backslash and append the character it stands for,
+/// encoded in UTF-8. A high surrogate must be followed by the escape of a low surrogate, the pair is decoded as one
+/// character.
+/// \param next Consume the next character of the input and return it as an unsigned char, or return -1 at the end
+/// \param error Throw the exception of the input with the message passed in parameter
+template <typename Next, typename Error>
+void decode_escape(Next&& next, Error&& error, std::string& out)
+{
+	auto read_hex_quad = [&]() {
+		unsigned value = 0;
+		for (int i = 0; i < 4; ++i) {
+			const auto digit = hex_digit(next());
+			if (digit < 0) {
+				error("invalid escape sequence");
+			}
+			value = value * 16 + static_cast<unsigned>(digit);
+		}
+		return value;
+	};
+
+	switch (next()) {
+	case '"': out += '"'; return;
+	case '\\': out += '\\'; return;
+	case '/': out += '/'; return;
+	case 'b': out += '\b'; return;
+	case 'f': out += '\f'; return;
+	case 'n': out += '\n'; return;
+	case 'r': out += '\r'; return;
+	case 't': out += '\t'; return;
+	case 'u': break;
+	default: error("invalid escape sequence");
+	}
+
+	auto codepoint = read_hex_quad();
+	if ((codepoint & 0xFC00) == 0xDC00) {
+		error("invalid codepoint, stray low surrogate");
+	}
+	if ((codepoint & 0xFC00) == 0xD800) {
+		if (next() != '\\') {
+			error("invalid codepoint, stray high surrogate");
+		}
+		if (next() != 'u') {
+			error("expected codepoint reference after high surrogate");
+		}
+		const auto low = read_hex_quad();
+		if ((low & 0xFC00) != 0xDC00) {
+			error("expected low surrogate after high surrogate");
+		}
+		codepoint = 0x10000 + (((codepoint & 0x3FF) << 10) | (low & 0x3FF));
+	}
+	append_utf8(codepoint, out);
+}
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,686 @@
+#include "json_parser.h"
+#include "json_escape.h"
+#include "json_scanner.h"
+#include "number.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RVN_JSON_PARSER_X86
+#include <immintrin.h>
+#endif
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+constexpr std::size_t block_size = 64;
+
+//! Number of positions indexed ahead of the tree building, so that the index stays small for large inputs
+constexpr std::size_t batch_positions = 8192;
+
+[[noreturn]] void parse_error(const std::string& msg, std::size_t offset)
+{
+	throw JsonScanError(msg + " at offset " + std::to_string(offset));
+}
+
+unsigned count_trailing_zeros(std::uint64_t bits)
+{
+#if defined(__GNUC__)
+	return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+	unsigned count = 0;
+	for (; (bits & 1) == 0; bits >>= 1) {
+		++count;
+	}
+	return count;
+#endif
+}
+
+//! Bit i is the xor of the bits 0 to i, which turns the quotes into the ranges they delimit
+std::uint64_t prefix_xor(std::uint64_t bits)
+{
+	bits ^= bits << 1;
+	bits ^= bits << 2;
+	bits ^= bits << 4;
+	bits ^= bits << 8;
+	bits ^= bits << 16;
+	bits ^= bits << 32;
+	return bits;
+}
+
+///
+/// Characters of a block of 64 bytes, the bit i of each mask is set when the byte i is in the class
+///
+struct BlockMasks {
+	std::uint64_t quote = 0;
+	std::uint64_t backslash = 0;
+
+	//! `{`, `}`, `[`, `]`, `:` and `,`
+	std::uint64_t op = 0;
+
+	//! The whitespaces of Json: space, tab, line feed and carriage return
+	std::uint64_t whitespace = 0;
+
+	//! Bytes below 0x20, that strings can't contain
+	std::uint64_t control = 0;
+};
+
+using Classifier = void (*)(const unsigned char* block, BlockMasks& masks);
+
+enum CharacterClass : std::uint8_t {
+	quote_class = 1,
+	backslash_class = 2,
+	op_class = 4,
+	whitespace_class = 8,
+	control_class = 16,
+};
+
+std::array<std::uint8_t, 256> make_class_table()
+{
+	std::array<std::uint8_t, 256> table{};
+	for (std::size_t c = 0; c < 0x20; ++c) {
+		table[c] = control_class;
+	}
+	table['"'] = quote_class;
+	table['\\'] = backslash_class;
+	for (const char c : {'{', '}', '[', ']', ':', ','}) {
+		table[static_cast<unsigned char>(c)] = op_class;
+	}
+	for (const char c : {' ', '\t', '\n', '\r'}) {
+		table[static_cast<unsigned char>(c)] |= whitespace_class;
+	}
+	return table;
+}
+
+void classify_scalar(const unsigned char* block, BlockMasks& masks)
+{
+	static const auto table = make_class_table();
+	for (std::size_t i = 0; i < block_size; ++i) {
+		const auto classes = table[block[i]];
+		masks.quote |= static_cast<std::uint64_t>((classes & quote_class) != 0) << i;
+		masks.backslash |= static_cast<std::uint64_t>((classes & backslash_class) != 0) << i;
+		masks.op |= static_cast<std::uint64_t>((classes & op_class) != 0) << i;
+		masks.whitespace |= static_cast<std::uint64_t>((classes & whitespace_class) != 0) << i;
+		masks.control |= static_cast<std::uint64_t>((classes & control_class) != 0) << i;
+	}
+}
+
+#ifdef RVN_JSON_PARSER_X86
+
+__attribute__((target("sse2"))) std::uint64_t bits_sse2(__m128i matches, std::size_t offset)
+{
+	return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(matches))) << offset;
+}
+
+__attribute__((target("sse2"))) void classify_sse2(const unsigned char* block, BlockMasks& masks)
+{
+	const auto quote = _mm_set1_epi8('"');
+	const auto backslash = _mm_set1_epi8('\\');
+	// `[` and `]` only differ from `{` and `}` by the bit 0x20
+	const auto lower_case = _mm_set1_epi8(0x20);
+	const auto open = _mm_set1_epi8('{');
+	const auto close = _mm_set1_epi8('}');
+	const auto colon = _mm_set1_epi8(':');
+	const auto comma = _mm_set1_epi8(',');
+	const auto space = _mm_set1_epi8(' ');
+	const auto tab = _mm_set1_epi8('\t');
+	const auto line_feed = _mm_set1_epi8('\n');
+	const auto carriage_return = _mm_set1_epi8('\r');
+	const auto last_control = _mm_set1_epi8(0x1f);
+
+	for (std::size_t offset = 0; offset < block_size; offset += 16) {
+		const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + offset));
+		const auto folded = _mm_or_si128(bytes, lower_case);
+		masks.quote |= bits_sse2(_mm_cmpeq_epi8(bytes, quote), offset);
+		masks.backslash |= bits_sse2(_mm_cmpeq_epi8(bytes, backslash), offset);
+		masks.op |= bits_sse2(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+		                                   _mm_or_si128(_mm_cmpeq_epi8(bytes, colon), _mm_cmpeq_epi8(bytes, comma))),
+		                      offset);
+		masks.whitespace |=
+		    bits_sse2(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, tab)),
+		                           _mm_or_si128(_mm_cmpeq_epi8(bytes, line_feed), _mm_cmpeq_epi8(bytes, carriage_return))),
+		              offset);
+		// Unsigned comparison: the byte is at most 0x1f when the maximum of both is 0x1f
+		masks.control |= bits_sse2(_mm_cmpeq_epi8(_mm_max_epu8(bytes, last_control), last_control), offset);
+	}
+}
+
+__attribute__((target("avx2"))) std::uint64_t bits_avx2(__m256i matches, std::size_t offset)
+{
+	return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(matches))) << offset;
+}
+
+__attribute__((target("avx2"))) void classify_avx2(const unsigned char* block, BlockMasks& masks)
+{
+	const auto quote = _mm256_set1_epi8('"');
+	const auto backslash = _mm256_set1_epi8('\\');
+	const auto lower_case = _mm256_set1_epi8(0x20);
+	const auto open = _mm256_set1_epi8('{');
+	const auto close = _mm256_set1_epi8('}');
+	const auto colon = _mm256_set1_epi8(':');
+	const auto comma = _mm256_set1_epi8(',');
+	const auto space = _mm256_set1_epi8(' ');
+	const auto tab = _mm256_set1_epi8('\t');
+	const auto line_feed = _mm256_set1_epi8('\n');
+	const auto carriage_return = _mm256_set1_epi8('\r');
+	const auto last_control = _mm256_set1_epi8(0x1f);
+
+	for (std::size_t offset = 0; offset < block_size; offset += 32) {
+		const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + offset));
+		const auto folded = _mm256_or_si256(bytes, lower_case);
+		masks.quote |= bits_avx2(_mm256_cmpeq_epi8(bytes, quote), offset);
+		masks.backslash |= bits_avx2(_mm256_cmpeq_epi8(bytes, backslash), offset);
+		masks.op |= bits_avx2(
+		    _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+		                    _mm256_or_si256(_mm256_cmpeq_epi8(bytes, colon), _mm256_cmpeq_epi8(bytes, comma))),
+		    offset);
+		masks.whitespace |= bits_avx2(
+		    _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), _mm256_cmpeq_epi8(bytes, tab)),
+		                    _mm256_or_si256(_mm256_cmpeq_epi8(bytes, line_feed),
+		                                    _mm256_cmpeq_epi8(bytes, carriage_return))),
+		    offset);
+		masks.control |= bits_avx2(_mm256_cmpeq_epi8(_mm256_max_epu8(bytes, last_control), last_control), offset);
+	}
+}
+
+#endif
+
+Classifier classifier(SimdLevel level)
+{
+	switch (level) {
+#ifdef RVN_JSON_PARSER_X86
+	case SimdLevel::avx2:
+		return classify_avx2;
+	case SimdLevel::sse2:
+		return classify_sse2;
+#endif
+	default:
+		return classify_scalar;
+	}
+}
+
+SimdLevel supported_level()
+{
+#ifdef RVN_JSON_PARSER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return SimdLevel::avx2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return SimdLevel::sse2;
+	}
+#endif
+	return SimdLevel::scalar;
+}
+
+///
+/// Input of the parser: a memory range, or a stream read by chunks. The offsets are counted from the beginning of the
+/// input, and a stream only keeps in memory the bytes from the oldest offset that the parser still needs.
+///
+class ParserInput {
+public:
+	ParserInput(const char* begin, const char* end)
+		: data_(begin), size_(static_cast<std::size_t>(end - begin)), complete_(true)
+	{
+	}
+
+	explicit ParserInput(std::streambuf& stream) : stream_(&stream) {}
+
+	//! Offset of the end of the bytes read so far, the size of the input once it is complete
+	std::size_t size() const { return size_; }
+
+	//! Whether the whole input is read
+	bool complete() const { return complete_; }
+
+	//! The byte at the offset, that must be between the kept offset and `size()`
+	const char* at(std::size_t offset) const { return data_ + (offset - base_); }
+
+	std::size_t offset(const char* it) const { return base_ + static_cast<std::size_t>(it - data_); }
+
+	//! Read the next chunk of the stream, the bytes before `keep` may be released. Return false at the end.
+	bool read_more(std::size_t keep);
+
+private:
+	static constexpr std::size_t chunk_size = 64 * 1024;
+
+	std::streambuf* stream_ = nullptr;
+	std::vector<char> buffer_;
+
+	const char* data_ = nullptr;
+	//! Offset of `data_`
+	std::size_t base_ = 0;
+	std::size_t size_ = 0;
+	bool complete_ = false;
+};
+
+bool ParserInput::read_more(std::size_t keep)
+{
+	if (complete_) {
+		return false;
+	}
+
+	// The kept bytes are only moved to the front of the buffer when that frees at least half of it, so they are
+	// moved a bounded number of times
+	auto filled = size_ - base_;
+	const auto released = keep - base_;
+	if (released != 0 and released >= filled / 2) {
+		std::memmove(buffer_.data(), buffer_.data() + released, filled - released);
+		base_ = keep;
+		filled -= released;
+	}
+	if (buffer_.size() < filled + chunk_size) {
+		buffer_.resize(std::max(buffer_.size() * 2, filled + chunk_size));
+	}
+
+	const auto count = stream_->sgetn(buffer_.data() + filled, static_cast<std::streamsize>(chunk_size));
+	data_ = buffer_.data();
+	if (count <= 0) {
+		complete_ = true;
+		return false;
+	}
+	size_ = base_ + filled + static_cast<std::size_t>(count);
+	return true;
+}
+
+///
+/// Stage 1: offsets of the structural characters outside strings, of the quotes delimiting strings and of the first
+/// character of each literal. The input is indexed by batches, the state crossing block boundaries being carried.
+///
+class StructuralIndex {
+public:
+	StructuralIndex(ParserInput& input, std::size_t first, Classifier classify)
+		: input_(input), offset_(first), keep_(first), classify_(classify)
+	{
+		positions_.reserve(batch_positions + block_size);
+	}
+
+	//! Offset of the next indexed position, or the size of the input once all the positions have been returned.
+	//! The input keeps the bytes from the returned offset until the next call.
+	std::size_t next()
+	{
+		keep_ = peek();
+		current_ += current_ != positions_.size() ? 1 : 0;
+		return keep_;
+	}
+
+	//! Offset of the next indexed position without moving past it. The input then holds the bytes up to it.
+	std::size_t peek()
+	{
+		if (current_ == positions_.size() and not refill()) {
+			return input_.size();
+		}
+		return positions_[current_];
+	}
+
+private:
+	bool refill();
+	void index_block(const unsigned char* block);
+
+	//! Characters preceded by a backslash that is not itself escaped
+	std::uint64_t escaped_characters(std::uint64_t backslash);
+
+	ParserInput& input_;
+	std::size_t offset_;
+	//! Last offset returned, whose bytes the tree building may still read
+	std::size_t keep_;
+	Classifier classify_;
+
+	std::vector<std::size_t> positions_;
+	std::size_t current_ = 0;
+
+	//! 1 when the last byte of the previous block is a backslash that escapes the first byte of the block
+	std::uint64_t escape_pending_ = 0;
+
+	//! All ones when the previous block ends inside a string
+	std::uint64_t in_string_ = 0;
+
+	//! 1 when the last byte of the previous block is part of a literal
+	std::uint64_t in_literal_ = 0;
+};
+
+bool StructuralIndex::refill()
+{
+	positions_.clear();
+	current_ = 0;
+	while (positions_.size() < batch_positions) {
+		while (input_.size() < offset_ + block_size and input_.read_more(keep_)) {
+		}
+		if (offset_ >= input_.size()) {
+			break;
+		}
+		const auto block = reinterpret_cast<const unsigned char*>(input_.at(offset_));
+		if (input_.size() - offset_ >= block_size) {
+			index_block(block);
+		} else {
+			// Whitespaces neither start literals nor change the state carried by the last block
+			unsigned char last[block_size];
+			std::memset(last, ' ', block_size);
+			std::memcpy(last, block, input_.size() - offset_);
+			index_block(last);
+		}
+		offset_ += block_size;
+	}
+	if (offset_ >= input_.size() and input_.complete() and in_string_ != 0) {
+		parse_error("unterminated string", input_.size());
+	}
+	return not positions_.empty();
+}
+
+void StructuralIndex::index_block(const unsigned char* block)
+{
+	BlockMasks masks;
+	classify_(block, masks);
+
+	const auto quotes = masks.quote & ~escaped_characters(masks.backslash);
+
+	// Set from each opening quote included to the closing quote excluded
+	const auto in_string = prefix_xor(quotes) ^ in_string_;
+	in_string_ = 0 - (in_string >> 63);
+	const auto string_content = in_string & ~quotes;
+
+	if ((masks.control & string_content) != 0) {
+		parse_error("invalid code sequence", offset_ + count_trailing_zeros(masks.control & string_content));
+	}
+
+	const auto literal = ~(masks.op | masks.whitespace | quotes);
+	const auto literal_start = literal & ~(literal << 1 | in_literal_);
+	in_literal_ = literal >> 63;
+
+	auto positions = (masks.op | quotes | literal_start) & ~string_content;
+	while (positions != 0) {
+		positions_.push_back(offset_ + count_trailing_zeros(positions));
+		positions &= positions - 1;
+	}
+}
+
+std::uint64_t StructuralIndex::escaped_characters(std::uint64_t backslash)
+{
+	std::uint64_t escaped = escape_pending_;
+	escape_pending_ = 0;
+	// An escaped backslash doesn't escape the following character
+	backslash &= ~escaped;
+	while (backslash != 0) {
+		const auto position = count_trailing_zeros(backslash);
+		backslash &= backslash - 1;
+		if (position == block_size - 1) {
+			escape_pending_ = 1;
+			break;
+		}
+		const auto next = std::uint64_t(1) << (position + 1);
+		escaped |= next;
+		backslash &= ~next;
+	}
+	return escaped;
+}
+
+bool is_literal_end(char c)
+{
+	switch (c) {
+	case '{':
+	case '}':
+	case '[':
+	case ']':
+	case ':':
+	case ',':
+	case '"':
+	case ' ':
+	case '\t':
+	case '\n':
+	case '\r':
+		return true;
+	default:
+		return false;
+	}
+}
+
+///
+/// Stage 2: build the tree by walking the positions of the structural index, with the conventions of
+/// `pt::read_json`: all the values are strings, arrays are children with empty keys and repeated keys are kept.
+///
+class TreeBuilder {
+public:
+	TreeBuilder(ParserInput& input, StructuralIndex& index) : input_(input), index_(index) {}
+
+	void parse(pt::ptree& json)
+	{
+		parse_value(index_.next(), json);
+		const auto garbage = index_.next();
+		if (garbage != input_.size()) {
+			parse_error("garbage after data", garbage);
+		}
+	}
+
+private:
+	//! The character at the position returned by the index, 0 at the end of the input
+	char at(std::size_t position) const { return position < input_.size() ? *input_.at(position) : 0; }
+
+	void parse_value(std::size_t position, pt::ptree& value);
+	void parse_object(pt::ptree& object);
+	void parse_array(pt::ptree& array);
+	void parse_string(std::size_t open, std::string& text);
+	void parse_literal(std::size_t position, std::string& text);
+
+	//! Append the character of the escape sequence following the backslash at `it`, and move `it` past it
+	void parse_escape(const char*& it, const char* end, std::string& text);
+
+	//! Append the bytes of a run of unescaped characters, that must be valid UTF-8
+	void append_run(const char* begin, const char* end, std::string& text);
+
+	std::size_t offset(const char* it) const { return input_.offset(it); }
+
+	ParserInput& input_;
+	StructuralIndex& index_;
+};
+
+void TreeBuilder::parse_value(std::size_t position, pt::ptree& value)
+{
+	if (position == input_.size()) {
+		parse_error("expected value", position);
+	}
+	switch (*input_.at(position)) {
+	case '{':
+		parse_object(value);
+		return;
+	case '[':
+		parse_array(value);
+		return;
+	case '"':
+		parse_string(position, value.data());
+		return;
+	case '}':
+	case ']':
+	case ':':
+	case ',':
+		parse_error("expected value", position);
+	default:
+		parse_literal(position, value.data());
+	}
+}
+
+void TreeBuilder::parse_object(pt::ptree& object)
+{
+	auto position = index_.next();
+	if (at(position) == '}') {
+		return;
+	}
+	for (;;) {
+		if (at(position) != '"') {
+			parse_error("expected key string", position);
+		}
+		std::string key;
+		parse_string(position, key);
+
+		position = index_.next();
+		if (at(position) != ':') {
+			parse_error("expected ':'", position);
+		}
+		auto& child = object.push_back(pt::ptree::value_type(std::move(key), pt::ptree()))->second;
+		parse_value(index_.next(), child);
+
+		position = index_.next();
+		if (at(position) == '}') {
+			return;
+		}
+		if (at(position) != ',') {
+			parse_error("expected '}' or ','", position);
+		}
+		position = index_.next();
+	}
+}
+
+void TreeBuilder::parse_array(pt::ptree& array)
+{
+	auto position = index_.next();
+	if (at(position) == ']') {
+		return;
+	}
+	for (;;) {
+		auto& child = array.push_back(pt::ptree::value_type("", pt::ptree()))->second;
+		parse_value(position, child);
+
+		position = index_.next();
+		if (at(position) == ']') {
+			return;
+		}
+		if (at(position) != ',') {
+			parse_error("expected ']' or ','", position);
+		}
+		position = index_.next();
+	}
+}
+
+void TreeBuilder::parse_string(std::size_t open, std::string& text)
+{
+	// The index pairs the quotes, the position following an opening quote is its closing quote
+	const auto close = index_.next();
+	if (at(close) != '"') {
+		parse_error("unterminated string", close);
+	}
+
+	const char* it = input_.at(open) + 1;
+	const char* const end = input_.at(close);
+	text.clear();
+	text.reserve(static_cast<std::size_t>(end - it));
+	for (;;) {
+		const auto backslash = static_cast<const char*>(std::memchr(it, '\\', static_cast<std::size_t>(end - it)));
+		const auto run_end = backslash != nullptr ? backslash : end;
+		append_run(it, run_end, text);
+		if (run_end == end) {
+			return;
+		}
+		it = run_end + 1;
+		parse_escape(it, end, text);
+	}
+}
+
+void TreeBuilder::append_run(const char* begin, const char* end, std::string& text)
+{
+	// Control characters were rejected by the index, only the bytes above 0x7f remain to be checked
+	const char* it = begin;
+	while (it != end) {
+		if (end - it >= 8) {
+			std::uint64_t bytes = 0;
+			std::memcpy(&bytes, it, sizeof(bytes));
+			if ((bytes & 0x8080808080808080ull) == 0) {
+				it += 8;
+				continue;
+			}
+		}
+		const auto lead = static_cast<unsigned char>(*it);
+		if (lead < 0x80) {
+			++it;
+			continue;
+		}
+		const auto trailing = trailing_bytes(lead);
+		if (trailing < 0) {
+			parse_error("invalid code sequence", offset(it));
+		}
+		++it;
+		for (int i = 0; i < trailing; ++i, ++it) {
+			if (it == end or (static_cast<unsigned char>(*it) & 0xc0) != 0x80) {
+				parse_error("invalid code sequence", offset(it));
+			}
+		}
+	}
+	text.append(begin, end);
+}
+
+void TreeBuilder::parse_escape(const char*& it, const char* end, std::string& text)
+{
+	decode_escape([&]() { return it != end ? static_cast<unsigned char>(*it++) : -1; },
+	              [&](const char* msg) { parse_error(msg, offset(it)); }, text);
+}
+
+void TreeBuilder::parse_literal(std::size_t position, std::string& text)
+{
+	// The literal ends before the next position, that is indexed first so the input holds the whole literal
+	const auto next = index_.peek();
+	const char* const begin = input_.at(position);
+	const char* const end = input_.at(next);
+	const char* it = begin;
+	while (it != end and not is_literal_end(*it)) {
+		++it;
+	}
+
+	const auto literal = boost::string_view(begin, static_cast<std::size_t>(it - begin));
+	if (literal != "true" and literal != "false" and literal != "null" and not is_json_number(literal)) {
+		parse_error("expected value", position);
+	}
+	text.assign(begin, it);
+}
+
+}
+
+SimdLevel select_simd_level(SimdLevel requested)
+{
+	static const auto supported = supported_level();
+	if (requested == SimdLevel::automatic or static_cast<int>(requested) > static_cast<int>(supported)) {
+		return supported;
+	}
+	return requested;
+}
+
+namespace {
+
+void parse_input(ParserInput& input, pt::ptree& json, SimdLevel level)
+{
+	while (input.size() < 3 and input.read_more(0)) {
+	}
+
+	// Like `pt::read_json`, skip what may be a UTF-8 byte order mark
+	std::size_t first = 0;
+	if (input.size() != 0 and static_cast<unsigned char>(*input.at(0)) == 0xef) {
+		first = input.size() < 3 ? input.size() : 3;
+	}
+
+	StructuralIndex index(input, first, classifier(select_simd_level(level)));
+	pt::ptree parsed;
+	TreeBuilder(input, index).parse(parsed);
+	json.swap(parsed);
+}
+
+}
+
+void parse_json(const char* begin, const char* end, pt::ptree& json, SimdLevel level)
+{
+	ParserInput input(begin, end);
+	parse_input(input, json, level);
+}
+
+void parse_json(std::streambuf& input, pt::ptree& json, SimdLevel level)
+{
+	ParserInput stream_input(input);
+	parse_input(stream_input, json, level);
+}
+
+}}} // namespace reven::jsonresource::detail
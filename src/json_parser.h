@@ -0,0 +1,34 @@
+#pragma once
+
+#include <streambuf>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "reader.h"
+
+namespace pt = boost::property_tree;
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+//! The level actually used for `requested`: the best one supported by the processor for `SimdLevel::automatic`,
+//! otherwise the requested level lowered to the best supported one
+SimdLevel select_simd_level(SimdLevel requested);
+
+///
+/// \brief parse_json Parse a Json input into `json`, with the same result as `pt::read_json`
+///
+/// The input is parsed in two stages. First the structural characters, the quotes and the beginnings of literals
+/// outside strings are located by blocks of 64 bytes, using vector instructions when available. Then the tree is
+/// built by walking these positions, without looking at the bytes in between except to copy strings and literals.
+///
+/// \throws JsonScanError if the input is not valid Json
+void parse_json(const char* begin, const char* end, pt::ptree& json, SimdLevel level = SimdLevel::automatic);
+
+//! Parse the rest of the stream, that is read by chunks: only the bytes that the parser still needs are kept, such
+//! as the whole of a string being read
+//! \throws JsonScanError if the input is not valid Json
+void parse_json(std::streambuf& input, pt::ptree& json, SimdLevel level = SimdLevel::automatic);
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,172 @@
+#include "json_pointer.h"
+
+#include <algorithm>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+//! Array index of the token, that must be "0" or a number without leading zeros
+bool parse_index(const std::string& token, std::size_t& index)
+{
+	if (token.empty() or (token[0] == '0' and token.size() > 1)) {
+		return false;
+	}
+	index = 0;
+	for (const char c : token) {
+		if (c < '0' or c > '9') {
+			return false;
+		}
+		index = index * 10 + static_cast<std::size_t>(c - '0');
+	}
+	return true;
+}
+
+}
+
+bool parse_pointer(const std::string& text, JsonPointer& pointer)
+{
+	pointer.clear();
+	if (text.empty()) {
+		return true;
+	}
+	if (text[0] != '/') {
+		return false;
+	}
+
+	for (std::size_t i = 0; i < text.size(); ++i) {
+		if (text[i] == '/') {
+			pointer.emplace_back();
+		} else if (text[i] != '~') {
+			pointer.back().push_back(text[i]);
+		} else if (i + 1 < text.size() and text[i + 1] == '0') {
+			pointer.back().push_back('~');
+			++i;
+		} else if (i + 1 < text.size() and text[i + 1] == '1') {
+			pointer.back().push_back('/');
+			++i;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+const pt::ptree* resolve_pointer(const pt::ptree& json, const JsonPointer& pointer, std::size_t first)
+{
+	const pt::ptree* value = &json;
+	for (std::size_t i = first; i < pointer.size(); ++i) {
+		const auto& token = pointer[i];
+		std::size_t index = 0;
+
+		// Arrays are children with empty keys, as written by `pt::read_json`
+		if (not value->empty() and value->front().first.empty() and parse_index(token, index)) {
+			if (index >= value->size()) {
+				return nullptr;
+			}
+			auto it = value->begin();
+			std::advance(it, static_cast<std::ptrdiff_t>(index));
+			value = &it->second;
+			continue;
+		}
+
+		const auto it = value->find(token);
+		if (it == value->not_found()) {
+			return nullptr;
+		}
+		value = &it->second;
+	}
+	return value;
+}
+
+PointerScan::PointerScan(const std::vector<JsonPointer>& pointers)
+	: pointers_(pointers), values_(pointers.size()), settled_(pointers.size(), false), remaining_(pointers.size())
+{
+}
+
+void PointerScan::scan(JsonScanner& scanner)
+{
+	std::vector<std::size_t> candidates(pointers_.size());
+	for (std::size_t i = 0; i < candidates.size(); ++i) {
+		candidates[i] = i;
+	}
+	scan_value(scanner, candidates, 0);
+}
+
+std::vector<std::size_t> PointerScan::select(const std::vector<std::size_t>& candidates, std::size_t depth,
+                                             const std::string& token) const
+{
+	std::vector<std::size_t> selected;
+	for (const auto candidate : candidates) {
+		if (not settled_[candidate] and pointers_[candidate][depth] == token) {
+			selected.push_back(candidate);
+		}
+	}
+	return selected;
+}
+
+void PointerScan::scan_value(JsonScanner& scanner, const std::vector<std::size_t>& candidates, std::size_t depth)
+{
+	if (candidates.empty()) {
+		scanner.skip_value();
+		return;
+	}
+
+	// A pointer ends at this value: build it once, the longer pointers are resolved inside it
+	const bool complete = std::any_of(candidates.begin(), candidates.end(),
+	                                  [&](std::size_t candidate) { return pointers_[candidate].size() == depth; });
+	if (complete) {
+		pt::ptree value;
+		scanner.read_value(value);
+		for (const auto candidate : candidates) {
+			const auto resolved = resolve_pointer(value, pointers_[candidate], depth);
+			if (resolved != nullptr) {
+				values_[candidate] = *resolved;
+			}
+			settled_[candidate] = true;
+			--remaining_;
+		}
+		return;
+	}
+
+	switch (scanner.peek()) {
+	case '{':
+		scanner.expect('{');
+		if (scanner.consume('}')) {
+			return;
+		}
+		do {
+			const auto key = scanner.read_string();
+			scanner.expect(':');
+			scan_value(scanner, select(candidates, depth, key), depth + 1);
+			if (remaining_ == 0) {
+				return;
+			}
+		} while (scanner.consume(','));
+		scanner.expect('}');
+		return;
+	case '[':
+		scanner.expect('[');
+		if (scanner.consume(']')) {
+			return;
+		}
+		for (std::size_t index = 0;; ++index) {
+			scan_value(scanner, select(candidates, depth, std::to_string(index)), depth + 1);
+			if (remaining_ == 0) {
+				return;
+			}
+			if (not scanner.consume(',')) {
+				break;
+			}
+		}
+		scanner.expect(']');
+		return;
+	default:
+		// A scalar has no children to reference
+		scanner.skip_value();
+	}
+}
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "json_scanner.h"
+
+namespace pt = boost::property_tree;
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+//! Unescaped reference tokens of a JSON Pointer (RFC 6901). The empty pointer references the whole document.
+using JsonPointer = std::vector<std::string>;
+
+//! Split the pointer into its reference tokens, return false if it is not a valid JSON Pointer
+bool parse_pointer(const std::string& text, JsonPointer& pointer);
+
+//! Value referenced by the tokens of the pointer starting at `first`, or nullptr
+const pt::ptree* resolve_pointer(const pt::ptree& json, const JsonPointer& pointer, std::size_t first = 0);
+
+///
+/// Evaluate JSON Pointers in a single forward scan of a Json value.
+/// Only the referenced values are built, the rest of the input is skipped. The scan stops as soon as all the
+/// pointers are settled, so the input following the last referenced value is not validated.
+/// As with `pt::read_json`, the first occurrence of a repeated key is the one referenced.
+///
+class PointerScan {
+public:
+	explicit PointerScan(const std::vector<JsonPointer>& pointers);
+
+	//! Scan the value at the position of the scanner
+	//! \throws JsonScanError if the input is not valid Json
+	void scan(JsonScanner& scanner);
+
+	//! The values, set for the pointers that reference a value
+	std::vector<boost::optional<pt::ptree>>& values() { return values_; }
+
+private:
+	void scan_value(JsonScanner& scanner, const std::vector<std::size_t>& candidates, std::size_t depth);
+
+	//! Candidates whose token at `depth` is `token`
+	std::vector<std::size_t> select(const std::vector<std::size_t>& candidates, std::size_t depth,
+	                                const std::string& token) const;
+
+	const std::vector<JsonPointer>& pointers_;
+	std::vector<boost::optional<pt::ptree>> values_;
+
+	//! Whether the value of the pointer is known, found or not
+	std::vector<bool> settled_;
+	std::size_t remaining_;
+};
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,284 @@
+#include "json_scanner.h"
+#include "json_escape.h"
+#include "number.h"
+
+#include <cstring>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+constexpr std::size_t chunk_size = 16 * 1024;
+
+bool is_whitespace(char c)
+{
+	return c == ' ' or c == '\n' or c == '\r' or c == '\t';
+}
+
+bool is_literal_char(char c)
+{
+	return (c >= '0' and c <= '9') or (c >= 'a' and c <= 'z') or c == '-' or c == '+' or c == '.' or c == 'E';
+}
+
+}
+
+JsonScanner::JsonScanner(std::istream& input)
+	: input_(&input), buffer_(chunk_size)
+{
+	base_ = cur_ = end_ = buffer_.data();
+}
+
+JsonScanner::JsonScanner(const char* begin, const char* end)
+	: base_(begin), cur_(begin), end_(end)
+{
+}
+
+bool JsonScanner::fill()
+{
+	if (cur_ != end_) {
+		return true;
+	}
+	if (input_ == nullptr) {
+		return false;
+	}
+
+	consumed_ += static_cast<std::uint64_t>(end_ - base_);
+	const auto count = input_->rdbuf()->sgetn(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+	base_ = cur_ = buffer_.data();
+	end_ = base_ + (count > 0 ? count : 0);
+	return cur_ != end_;
+}
+
+char JsonScanner::get()
+{
+	if (not fill()) {
+		error("unexpected end of input");
+	}
+	return *cur_++;
+}
+
+char JsonScanner::peek()
+{
+	while (fill()) {
+		if (not is_whitespace(*cur_)) {
+			return *cur_;
+		}
+		++cur_;
+	}
+	return 0;
+}
+
+void JsonScanner::expect(char c)
+{
+	if (peek() != c) {
+		error(std::string("expected '") + c + "'");
+	}
+	++cur_;
+}
+
+bool JsonScanner::consume(char c)
+{
+	if (peek() != c) {
+		return false;
+	}
+	++cur_;
+	return true;
+}
+
+void JsonScanner::read_escape(std::string& out)
+{
+	decode_escape([this]() { return fill() ? static_cast<unsigned char>(*cur_++) : -1; },
+	              [this](const char* msg) { error(msg); }, out);
+}
+
+std::string JsonScanner::read_string()
+{
+	expect('"');
+
+	std::string result;
+	for (;;) {
+		if (not fill()) {
+			error("unterminated string");
+		}
+
+		// Copy the run of plain ASCII characters at once
+		const char* run = cur_;
+		while (cur_ != end_ and *cur_ != '"' and *cur_ != '\\' and static_cast<unsigned char>(*cur_) < 0x80) {
+			if (static_cast<unsigned char>(*cur_) < 0x20) {
+				error("invalid code sequence");
+			}
+			++cur_;
+		}
+		result.append(run, cur_);
+
+		if (cur_ == end_) {
+			continue;
+		}
+
+		const char c = *cur_++;
+		if (c == '"') {
+			return result;
+		}
+		if (c == '\\') {
+			read_escape(result);
+		} else {
+			read_utf8(static_cast<unsigned char>(c), result);
+		}
+	}
+}
+
+void JsonScanner::read_utf8(unsigned char lead, std::string& out)
+{
+	const auto trailing = trailing_bytes(lead);
+	if (trailing < 0) {
+		error("invalid code sequence");
+	}
+	out += static_cast<char>(lead);
+	for (int i = 0; i < trailing; ++i) {
+		if (not fill() or (static_cast<unsigned char>(*cur_) & 0xc0) != 0x80) {
+			error("invalid code sequence");
+		}
+		out += *cur_++;
+	}
+}
+
+void JsonScanner::skip_string()
+{
+	expect('"');
+
+	for (;;) {
+		if (not fill()) {
+			error("unterminated string");
+		}
+
+		const char* quote = static_cast<const char*>(std::memchr(cur_, '"', static_cast<std::size_t>(end_ - cur_)));
+		const char* backslash = static_cast<const char*>(
+			std::memchr(cur_, '\\', static_cast<std::size_t>((quote ? quote : end_) - cur_)));
+
+		if (backslash != nullptr) {
+			cur_ = backslash + 1;
+			get();
+		} else if (quote != nullptr) {
+			cur_ = quote + 1;
+			return;
+		} else {
+			cur_ = end_;
+		}
+	}
+}
+
+std::string JsonScanner::read_literal_text()
+{
+	peek();
+
+	std::string literal;
+	while (fill() and is_literal_char(*cur_)) {
+		literal += *cur_++;
+	}
+
+	if (literal.empty()) {
+		error("expected value");
+	}
+	return literal;
+}
+
+void JsonScanner::skip_value()
+{
+	std::size_t depth = 0;
+	do {
+		switch (peek()) {
+		case '"':
+			skip_string();
+			break;
+		case '{':
+		case '[':
+			++cur_;
+			++depth;
+			break;
+		case '}':
+		case ']':
+			if (depth == 0) {
+				error("unexpected end of container");
+			}
+			++cur_;
+			--depth;
+			break;
+		case ',':
+		case ':':
+			if (depth == 0) {
+				error("expected value");
+			}
+			++cur_;
+			break;
+		case 0:
+			error("unexpected end of input");
+		default:
+			read_literal();
+		}
+	} while (depth != 0);
+}
+
+void JsonScanner::read_value(pt::ptree& value)
+{
+	switch (peek()) {
+	case '{':
+		++cur_;
+		if (consume('}')) {
+			return;
+		}
+		do {
+			std::string key = read_string();
+			expect(':');
+			auto it = value.push_back(pt::ptree::value_type(std::move(key), pt::ptree()));
+			read_value(it->second);
+		} while (consume(','));
+		expect('}');
+		return;
+	case '[':
+		++cur_;
+		if (consume(']')) {
+			return;
+		}
+		do {
+			auto it = value.push_back(pt::ptree::value_type(std::string(), pt::ptree()));
+			read_value(it->second);
+		} while (consume(','));
+		expect(']');
+		return;
+	case '"':
+		value.data() = read_string();
+		return;
+	default:
+		break;
+	}
+
+	value.data() = read_literal();
+}
+
+std::string JsonScanner::read_literal()
+{
+	std::string literal = read_literal_text();
+	if (literal != "true" and literal != "false" and literal != "null" and not is_json_number(literal)) {
+		error("invalid literal '" + literal + "'");
+	}
+	return literal;
+}
+
+void JsonScanner::skip_bom()
+{
+	// The 3 bytes are skipped without being checked, like `pt::read_json` does
+	if (fill() and static_cast<unsigned char>(*cur_) == 0xef) {
+		for (int i = 0; i < 3 and fill(); ++i) {
+			++cur_;
+		}
+	}
+}
+
+void JsonScanner::error(const std::string& msg) const
+{
+	throw JsonScanError(msg + " at offset " + std::to_string(offset()));
+}
+
+}}} // namespace reven::jsonresource::detail
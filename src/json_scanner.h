@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace pt = boost::property_tree;
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Exception that occurs when the scanned input is not valid Json
+///
+class JsonScanError : public std::runtime_error {
+public:
+	JsonScanError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+///
+/// Forward-only Json tokenizer.
+/// Values that are not needed can be skipped without being built, which allows to extract a small part of a
+/// resource without paying for the parsing of the whole document.
+///
+class JsonScanner {
+public:
+	//! Scan the stream from its current position, reading it by chunks
+	explicit JsonScanner(std::istream& input);
+
+	//! Scan an in-memory buffer
+	JsonScanner(const char* begin, const char* end);
+
+	//! Skip whitespaces and return the next character without consuming it, or 0 at the end of the input
+	char peek();
+
+	//! Consume the next non-whitespace character, that must be `c`
+	void expect(char c);
+
+	//! Consume the next non-whitespace character if it is `c`
+	bool consume(char c);
+
+	//! Read a string and return its unescaped content
+	std::string read_string();
+
+	//! Read a number, boolean or null and return its text
+	std::string read_literal();
+
+	//! Skip what may be a UTF-8 byte order mark at the current position, like `pt::read_json` does
+	void skip_bom();
+
+	//! Skip a whole value without building it
+	void skip_value();
+
+	//! Read a whole value into `value`, following the conventions of `pt::read_json`
+	void read_value(pt::ptree& value);
+
+	//! Number of bytes consumed since the beginning of the scan
+	std::uint64_t offset() const { return consumed_ + static_cast<std::uint64_t>(cur_ - base_); }
+
+private:
+	bool fill();
+	char get();
+	void skip_string();
+	std::string read_literal_text();
+	void read_escape(std::string& out);
+	void read_utf8(unsigned char lead, std::string& out);
+
+	[[noreturn]] void error(const std::string& msg) const;
+
+	std::istream* input_ = nullptr;
+	std::vector<char> buffer_;
+
+	const char* base_ = nullptr;
+	const char* cur_ = nullptr;
+	const char* end_ = nullptr;
+
+	//! Bytes consumed before `base_`
+	std::uint64_t consumed_ = 0;
+};
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,67 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string& what)
+{
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+}
+
+std::shared_ptr<const MappedFile> MappedFile::open(const char* filename)
+{
+	const int fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw_errno(std::string("Can't open ") + filename);
+	}
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		const int error = errno;
+		::close(fd);
+		errno = error;
+		throw_errno(std::string("Can't stat ") + filename);
+	}
+
+	const auto size = static_cast<std::size_t>(st.st_size);
+	void* data = nullptr;
+	if (size != 0) {
+		data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			const int error = errno;
+			::close(fd);
+			errno = error;
+			throw_errno(std::string("Can't map ") + filename);
+		}
+		// The whole file is parsed from the beginning to the end
+		::madvise(data, size, MADV_SEQUENTIAL);
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+
+	return std::shared_ptr<const MappedFile>(new MappedFile(static_cast<const char*>(data), size));
+}
+
+MappedFile::~MappedFile()
+{
+	if (size_ != 0) {
+		::munmap(const_cast<char*>(data_), size_);
+	}
+}
+
+}}} // namespace reven::jsonresource::detail
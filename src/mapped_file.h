@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Read-only memory mapping of a whole file.
+/// The mapping is released when the object is destroyed.
+///
+class MappedFile {
+public:
+	///
+	/// \brief open Map the file passed in parameter
+	/// \throws std::system_error if the file can't be opened or mapped
+	static std::shared_ptr<const MappedFile> open(const char* filename);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const { return data_; }
+	std::size_t size() const { return size_; }
+
+private:
+	MappedFile(const char* data, std::size_t size) : data_(data), size_(size) {}
+
+	const char* data_;
+	std::size_t size_;
+};
+
+}}} // namespace reven::jsonresource::detail
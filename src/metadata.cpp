@@ -1,23 +1,155 @@
 #include "metadata.h"
+#include "cbor.h"
 #include "common.h"
+#include "compression.h"
+#include "json_emitter.h"
+#include "json_scanner.h"
+#include "number.h"
+#include "stats_recorder.h"
 
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <typeinfo>
+#include <vector>
 
 namespace reven {
 namespace jsonresource {
 
-void Metadata::serialize(pt::ptree& json, std::ostream& out) const
+void Metadata::serialize(pt::ptree& json, std::ostream& out, const OutputFormat& format) const
 {
 	write_metadata(json);
 	try {
-		pt::write_json(out, json);
+		detail::emit_document(out, json, format);
 	} catch (const std::exception& e) {
 		throw WriteMetadataError((std::string("Can't write Json output: ") + e.what()).c_str());
 	}
 }
 
+///
+/// Description of the fields of the metadata, in the order they are written.
+/// Reading and writing the metadata both go through this table, so a field is added by adding an entry to it.
+///
+struct Metadata::Fields {
+	struct Field {
+		const char* name;
+		bool required;
+
+		//! Written as a Json number. Quoted numbers, written by earlier versions, are still read.
+		bool number;
+
+		//! Return nullptr, or the name of the type the value can't be converted to
+		const char* (*decode)(Metadata& md, const pt::ptree& value);
+
+		void (*encode)(const Metadata& md, pt::ptree& value);
+	};
+
+	template <typename T, T Metadata::*member>
+	static const char* decode_number(Metadata& md, const pt::ptree& value)
+	{
+		if (not detail::parse_unsigned(value.data(), md.*member)) {
+			return typeid(T).name();
+		}
+		return nullptr;
+	}
+
+	template <typename T, T Metadata::*member>
+	static void encode_number(const Metadata& md, pt::ptree& value)
+	{
+		char buffer[detail::max_number_size];
+		value.data().assign(buffer, detail::format_number(static_cast<std::uint64_t>(md.*member), buffer));
+	}
+
+	template <detail::Interned<std::string> Metadata::*member>
+	static const char* decode_string(Metadata& md, const pt::ptree& value)
+	{
+		md.*member = detail::Interned<std::string>(value.data());
+		return nullptr;
+	}
+
+	template <detail::Interned<std::string> Metadata::*member>
+	static void encode_string(const Metadata& md, pt::ptree& value)
+	{
+		value.put_value((md.*member).get());
+	}
+
+	static void encode_version(const Metadata&, pt::ptree& value)
+	{
+		char buffer[detail::max_number_size];
+		value.data().assign(buffer, detail::format_number(static_cast<std::uint64_t>(metadata_version), buffer));
+	}
+
+	static const char* decode_custom(Metadata& md, const pt::ptree& value)
+	{
+		std::vector<CustomMetadata::value_type> entries;
+		entries.reserve(value.size());
+		for (const auto& custom : value) {
+			entries.emplace_back(custom.first, custom.second.data());
+		}
+		md.custom_metadata_ = detail::Interned<CustomMetadata>(CustomMetadata(std::move(entries)));
+		return nullptr;
+	}
+
+	static void encode_custom(const Metadata& md, pt::ptree& value)
+	{
+		for (const auto& custom : md.custom_metadata_.get()) {
+			value.push_back(pt::ptree::value_type(custom.first, pt::ptree(custom.second)));
+		}
+	}
+
+	static constexpr std::size_t version = 0;
+	static constexpr std::size_t custom = 7;
+
+	static constexpr Field table[] = {
+		// Decoded before the other fields, as it tells whether they can be read
+		{"metadata_version", true, true, nullptr, &encode_version},
+		{"type", true, true, &decode_number<std::uint32_t, &Metadata::type_>,
+		                     &encode_number<std::uint32_t, &Metadata::type_>},
+		{"format_version", true, false, &decode_string<&Metadata::format_version_>,
+		                                &encode_string<&Metadata::format_version_>},
+		{"tool_version", true, false, &decode_string<&Metadata::tool_version_>,
+		                              &encode_string<&Metadata::tool_version_>},
+		{"tool_name", true, false, &decode_string<&Metadata::tool_name_>,
+		                           &encode_string<&Metadata::tool_name_>},
+		{"tool_info", true, false, &decode_string<&Metadata::tool_info_>,
+		                           &encode_string<&Metadata::tool_info_>},
+		{"generation_date", true, true, &decode_number<std::uint64_t, &Metadata::generation_date_>,
+		                                &encode_number<std::uint64_t, &Metadata::generation_date_>},
+		{"custom", false, false, &decode_custom, &encode_custom},
+	};
+
+	static constexpr std::size_t size = sizeof(table) / sizeof(table[0]);
+
+	static_assert(custom + 1 == size, "custom is the last field");
+
+	//! Index of the field with the name passed in parameter, or `size` if it is not a field of the metadata
+	static std::size_t find(const std::string& name)
+	{
+		for (std::size_t i = 0; i < size; ++i) {
+			if (name == table[i].name) {
+				return i;
+			}
+		}
+		return size;
+	}
+};
+
+constexpr Metadata::Fields::Field Metadata::Fields::table[];
+
+namespace detail {
+
+bool is_number_field(boost::string_view name)
+{
+	for (const auto& field : Metadata::Fields::table) {
+		if (name == field.name) {
+			return field.number;
+		}
+	}
+	return false;
+}
+
+}
+
 void Metadata::write_metadata(pt::ptree& json) const
 {
 
@@ -30,23 +162,18 @@ void Metadata::write_metadata(pt::ptree& json) const
 
 	pt::ptree jmetadata;
 	try {
-		jmetadata.put("metadata_version", metadata_version);
-		jmetadata.put("type", type_);
-		jmetadata.put("format_version", format_version_);
-		jmetadata.put("tool_version", tool_version_);
-		jmetadata.put("tool_name", tool_name_);
-		jmetadata.put("tool_info", tool_info_);
-		jmetadata.put("generation_date", generation_date_);
-
-		if (not custom_metadata_.empty()) {
-			pt::ptree jcustom_metadata;
-			for (const auto& custom : custom_metadata_) {
-				jcustom_metadata.put(custom.first, custom.second);
+		for (std::size_t i = 0; i < Fields::size; ++i) {
+			const auto& field = Fields::table[i];
+			pt::ptree value;
+			field.encode(*this, value);
+			if (i == Fields::custom and value.empty()) {
+				continue;
 			}
-			jmetadata.add_child("custom", jcustom_metadata);
+			jmetadata.push_back(pt::ptree::value_type(field.name, pt::ptree()))->second.swap(value);
 		}
 
-		json.add_child("metadata", jmetadata);
+		// Written first, so that readers looking only for the metadata can stop early
+		json.push_front(pt::ptree::value_type("metadata", pt::ptree()))->second.swap(jmetadata);
 	} catch (const std::exception& e) {
 		throw WriteMetadataError((std::string("Can't write Json output: ") + e.what()).c_str());
 	}
@@ -55,62 +182,146 @@ void Metadata::write_metadata(pt::ptree& json) const
 Metadata Metadata::read_metadata(pt::ptree& json)
 {
 	Metadata md;
+	ResourceError error;
+	if (not decode_metadata(json, md, error)) {
+		error.raise();
+	}
+	return md;
+}
 
-	try {
-		json.get_child("metadata");
-	} catch (const std::exception&) {
-		throw MissingMetadata("Missing \"metadata\" field");
+Expected<Metadata> Metadata::try_read_metadata(const pt::ptree& json)
+{
+	Metadata md;
+	ResourceError error;
+	if (not decode_metadata(json, md, error)) {
+		return error;
 	}
+	return md;
+}
 
-	std::uint32_t metadata_version = 0;
-	try {
-		metadata_version = json.get<std::uint32_t>("metadata.metadata_version");
-	} catch (const std::exception&) {
-		throw MissingMetadataVersion("Missing \"metadata_version\" field");
+bool Metadata::decode_metadata(const pt::ptree& json, Metadata& md, ResourceError& error)
+{
+	const auto jmetadata = json.get_child_optional("metadata");
+	if (not jmetadata) {
+		error = ResourceError(ErrorCode::missing_metadata);
+		return false;
 	}
 
-	if (metadata_version > ::reven::jsonresource::metadata_version) {
-		std::stringstream msg;
-		msg << "Can't read a metadata with metadata version bigger than the current"
-		    << " (" << metadata_version <<  " > " << ::reven::jsonresource::metadata_version << ")";
-		throw IncompatibleMetadataVersion(msg.str().c_str());
+	// Single pass over the members, the first occurrence of a field is kept
+	const pt::ptree* values[Fields::size] = {};
+	for (const auto& member : *jmetadata) {
+		const auto index = Fields::find(member.first);
+		if (index != Fields::size and values[index] == nullptr) {
+			values[index] = &member.second;
+		}
 	}
 
-	try {
-		md.type_ = json.get<std::uint32_t>("metadata.type");
-		md.format_version_ = json.get<std::string>("metadata.format_version");
-		md.tool_version_ = json.get<std::string>("metadata.tool_version");
-		md.tool_name_ = json.get<std::string>("metadata.tool_name");
-		md.tool_info_ = json.get<std::string>("metadata.tool_info");
-		md.generation_date_ = json.get<std::uint64_t>("metadata.generation_date");
-	} catch (const pt::ptree_bad_path& e) {
-		throw MissingMetadataField((std::string("Missing metadata field: ") + e.what()).c_str());
-	} catch (const pt::ptree_bad_data& e) {
-		throw BadMetadataField((std::string("Can't read a metadata field: ") + e.what()).c_str());
-	}
-
-	const auto custom_metadata = json.get_child_optional("metadata.custom");
-	if (custom_metadata) {
-		for (const boost::property_tree::ptree::value_type& custom : custom_metadata.value()) {
-			md.custom_metadata_.emplace(custom.first, custom.second.data());
+	const auto jversion = values[Fields::version];
+	std::uint32_t version = 0;
+	if (jversion == nullptr or not detail::parse_unsigned(jversion->data(), version)) {
+		error = ResourceError(ErrorCode::missing_metadata_version);
+		return false;
+	}
+
+	if (version > ::reven::jsonresource::metadata_version) {
+		error = ResourceError(ErrorCode::incompatible_metadata_version);
+		error.version_ = version;
+		return false;
+	}
+
+	for (std::size_t i = Fields::version + 1; i < Fields::size; ++i) {
+		const auto& field = Fields::table[i];
+		if (values[i] == nullptr) {
+			if (field.required) {
+				error = ResourceError(ErrorCode::missing_metadata_field);
+				error.name_ = field.name;
+				return false;
+			}
+			continue;
 		}
+
+		const auto bad_type = field.decode(md, *values[i]);
+		if (bad_type != nullptr) {
+			error = ResourceError(ErrorCode::bad_metadata_field);
+			error.name_ = bad_type;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Metadata Metadata::deserialize(std::istream& input, bool rewind)
+{
+	return std::move(try_deserialize(input, rewind).value());
+}
+
+Expected<Metadata> Metadata::try_deserialize(std::istream& input, bool rewind)
+{
+	detail::StatsRecorder recorder(Operation::metadata_deserialize);
+	const auto begin = recorder.enabled() and not rewind ? detail::stream_position(input, std::ios_base::in) : 0;
+
+	pt::ptree json;
+	const auto parsed = recorder.time(&OperationStats::parse_time, [&]() {
+		try {
+			detail::ResourceInput resource(input, rewind);
+			if (resource.is_binary()) {
+				detail::CborDecoder(*resource.stream().rdbuf()).read_document(json);
+			} else {
+				pt::read_json(resource.stream(), json);
+			}
+		} catch (const std::exception& e) {
+			return ResourceError(ErrorCode::read_metadata_error, std::string("Can't read Json input: ") + e.what());
+		}
+		return ResourceError();
+	});
+	if (parsed.code() != ErrorCode::none) {
+		return parsed;
 	}
 
+	auto md = recorder.time(&OperationStats::validate_time, [&]() { return try_read_metadata(json); });
+	if (recorder.enabled()) {
+		const auto end = detail::stream_position(input, std::ios_base::in);
+		recorder.stats().bytes_read = end > begin ? end - begin : 0;
+		recorder.stats().node_count = detail::count_nodes(json);
+		recorder.finish();
+	}
 	return md;
 }
 
-Metadata Metadata::deserialize(std::istream& input)
+Metadata Metadata::peek(std::istream& input, bool rewind)
+{
+	return std::move(try_peek(input, rewind).value());
+}
+
+Expected<Metadata> Metadata::try_peek(std::istream& input, bool rewind)
 {
-	input.clear();
-	input.seekg(0, std::ios::beg);
 	pt::ptree json;
 	try {
-		pt::read_json(input, json);
+		// Only the beginning of a compressed resource is decompressed
+		detail::ResourceInput resource(input, rewind);
+		if (resource.is_binary()) {
+			detail::CborDecoder(*resource.stream().rdbuf()).read_metadata(json);
+		} else {
+			detail::JsonScanner scanner(resource.stream());
+			scanner.expect('{');
+			if (not scanner.consume('}')) {
+				do {
+					const auto key = scanner.read_string();
+					scanner.expect(':');
+					if (key == "metadata") {
+						scanner.read_value(json.add_child("metadata", pt::ptree()));
+						break;
+					}
+					scanner.skip_value();
+				} while (scanner.consume(','));
+			}
+		}
 	} catch (const std::exception& e) {
-		throw ReadMetadataError((std::string("Can't read Json input: ") + e.what()).c_str());
+		return ResourceError(ErrorCode::read_metadata_error, std::string("Can't read Json input: ") + e.what());
 	}
 
-	return read_metadata(json);
+	return try_read_metadata(json);
 }
 
 }} // namespace reven::binresource
@@ -0,0 +1,253 @@
+#include "number.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <locale.h>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+bool is_space(char c)
+{
+	return c == ' ' or c == '\t' or c == '\n' or c == '\r' or c == '\v' or c == '\f';
+}
+
+bool is_digit(char c)
+{
+	return c >= '0' and c <= '9';
+}
+
+boost::string_view trim(boost::string_view text)
+{
+	while (not text.empty() and is_space(text.front())) {
+		text.remove_prefix(1);
+	}
+	while (not text.empty() and is_space(text.back())) {
+		text.remove_suffix(1);
+	}
+	return text;
+}
+
+//! Significant digits that are enough to round any decimal number to the nearest double, when the digits after
+//! them are only known to be zero or not
+constexpr std::size_t max_significant_digits = 768;
+
+///
+/// Switch the calling thread to the C locale, so the C library formats numbers with a '.' whatever the global
+/// locale. Only the thread is affected, unlike `setlocale`.
+///
+class CLocaleScope {
+public:
+	CLocaleScope() : previous_(c_locale() != locale_t(0) ? ::uselocale(c_locale()) : locale_t(0)) {}
+
+	~CLocaleScope()
+	{
+		if (previous_ != locale_t(0)) {
+			::uselocale(previous_);
+		}
+	}
+
+	CLocaleScope(const CLocaleScope&) = delete;
+	CLocaleScope& operator=(const CLocaleScope&) = delete;
+
+private:
+	//! Never freed, as numbers can be converted by static objects
+	static locale_t c_locale()
+	{
+		static const auto locale = ::newlocale(LC_ALL_MASK, "C", locale_t(0));
+		return locale;
+	}
+
+	locale_t previous_;
+};
+
+}
+
+std::size_t format_number(std::uint64_t value, char* buffer)
+{
+	char digits[20];
+	std::size_t size = 0;
+	do {
+		digits[size++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	for (std::size_t i = 0; i < size; ++i) {
+		buffer[i] = digits[size - 1 - i];
+	}
+	return size;
+}
+
+std::size_t format_number(std::int64_t value, char* buffer)
+{
+	if (value >= 0) {
+		return format_number(static_cast<std::uint64_t>(value), buffer);
+	}
+	// Negated as unsigned, as the opposite of the minimum does not fit in int64
+	buffer[0] = '-';
+	return 1 + format_number(~static_cast<std::uint64_t>(value) + 1, buffer + 1);
+}
+
+std::size_t format_number(double value, char* buffer)
+{
+	const CLocaleScope scope;
+	for (int precision = 15; precision <= 17; ++precision) {
+		const auto size = static_cast<std::size_t>(std::snprintf(buffer, max_number_size, "%.*g", precision, value));
+		double parsed = 0;
+		if (precision == 17 or (parse_number(boost::string_view(buffer, size), parsed) and parsed == value)) {
+			return size;
+		}
+	}
+	return 0;
+}
+
+bool is_json_number(boost::string_view text)
+{
+	auto it = text.begin();
+	const auto end = text.end();
+	if (it != end and *it == '-') {
+		++it;
+	}
+	if (it == end or not is_digit(*it)) {
+		return false;
+	}
+	if (*it == '0') {
+		++it;
+	} else {
+		while (it != end and is_digit(*it)) {
+			++it;
+		}
+	}
+	if (it != end and *it == '.') {
+		++it;
+		if (it == end or not is_digit(*it)) {
+			return false;
+		}
+		while (it != end and is_digit(*it)) {
+			++it;
+		}
+	}
+	if (it != end and (*it == 'e' or *it == 'E')) {
+		++it;
+		if (it != end and (*it == '+' or *it == '-')) {
+			++it;
+		}
+		if (it == end or not is_digit(*it)) {
+			return false;
+		}
+		while (it != end and is_digit(*it)) {
+			++it;
+		}
+	}
+	return it == end;
+}
+
+bool parse_number(boost::string_view text, std::uint64_t& value)
+{
+	text = trim(text);
+	if (text.empty()) {
+		return false;
+	}
+
+	std::uint64_t parsed = 0;
+	for (const char c : text) {
+		if (not is_digit(c)) {
+			return false;
+		}
+		const auto digit = static_cast<std::uint64_t>(c - '0');
+		if (parsed > (std::numeric_limits<std::uint64_t>::max() - digit) / 10) {
+			return false;
+		}
+		parsed = parsed * 10 + digit;
+	}
+	value = parsed;
+	return true;
+}
+
+bool parse_number(boost::string_view text, std::int64_t& value)
+{
+	text = trim(text);
+	const bool negative = not text.empty() and text.front() == '-';
+	if (negative) {
+		text.remove_prefix(1);
+	}
+
+	std::uint64_t magnitude = 0;
+	const auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+	if (not parse_number(text, magnitude) or magnitude > max + (negative ? 1 : 0)) {
+		return false;
+	}
+	value = negative ? static_cast<std::int64_t>(~magnitude + 1) : static_cast<std::int64_t>(magnitude);
+	return true;
+}
+
+bool parse_number(boost::string_view text, double& value)
+{
+	text = trim(text);
+	if (not is_json_number(text)) {
+		return false;
+	}
+
+	// The number is rewritten in a fixed buffer as its significant digits followed by an exponent. Without a decimal
+	// point, `strtod` reads it the same way in every locale. The digits beyond the ones that matter for rounding are
+	// replaced by a single nonzero digit when they are not all zeros.
+	char buffer[1 + max_significant_digits + 1 + 1 + max_number_size];
+	std::size_t size = 0;
+	std::size_t digits = 0;
+	std::int64_t exponent = 0;
+	bool truncated = false;
+	auto it = text.begin();
+	if (*it == '-') {
+		buffer[size++] = *it++;
+	}
+	for (bool fraction = false; it != text.end() and *it != 'e' and *it != 'E'; ++it) {
+		if (*it == '.') {
+			fraction = true;
+		} else if (digits == 0 and *it == '0') {
+			exponent -= fraction ? 1 : 0;
+		} else if (digits < max_significant_digits) {
+			buffer[size++] = *it;
+			++digits;
+			exponent -= fraction ? 1 : 0;
+		} else {
+			truncated = truncated or *it != '0';
+			exponent += fraction ? 0 : 1;
+		}
+	}
+	if (digits == 0) {
+		buffer[size++] = '0';
+	} else if (truncated) {
+		buffer[size++] = '1';
+		--exponent;
+	}
+
+	// Exponents past the range of doubles all give zero or an overflow, they are clamped so they can't overflow
+	constexpr std::int64_t max_exponent = 100000;
+	if (it != text.end()) {
+		++it;
+		const bool negative = *it == '-';
+		it += *it == '-' or *it == '+' ? 1 : 0;
+		std::int64_t written = 0;
+		for (; it != text.end(); ++it) {
+			written = std::min<std::int64_t>(written * 10 + (*it - '0'), max_exponent);
+		}
+		exponent += negative ? -written : written;
+	}
+	exponent = std::max(std::min(exponent, 2 * max_exponent), -2 * max_exponent);
+	buffer[size++] = 'e';
+	size += format_number(exponent, buffer + size);
+	buffer[size] = 0;
+
+	char* end = nullptr;
+	value = std::strtod(buffer, &end);
+	return end == buffer + size and std::isfinite(value);
+}
+
+}}} // namespace reven::jsonresource::detail
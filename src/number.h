@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include <boost/utility/string_view.hpp>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Conversions between numbers and their Json text.
+/// They do not allocate and do not depend on the global locale, unlike the stream-based conversions of ptree.
+///
+
+//! Size of a buffer large enough for any formatted number
+constexpr std::size_t max_number_size = 32;
+
+//! Write the number in the buffer and return the number of characters written
+std::size_t format_number(std::uint64_t value, char* buffer);
+std::size_t format_number(std::int64_t value, char* buffer);
+
+//! Write the shortest text that reads back as the same double. The value must be finite.
+std::size_t format_number(double value, char* buffer);
+
+//! Whether the text follows the grammar of Json numbers
+bool is_json_number(boost::string_view text);
+
+//! Parse an integer, possibly surrounded by whitespaces. Return false if the text is not an integer or overflows.
+bool parse_number(boost::string_view text, std::uint64_t& value);
+bool parse_number(boost::string_view text, std::int64_t& value);
+
+//! Parse a Json number, possibly surrounded by whitespaces
+bool parse_number(boost::string_view text, double& value);
+
+//! Parse an unsigned integer that must fit in T
+template <typename T>
+bool parse_unsigned(boost::string_view text, T& value)
+{
+	std::uint64_t parsed = 0;
+	if (not parse_number(text, parsed) or parsed > std::numeric_limits<T>::max()) {
+		return false;
+	}
+	value = static_cast<T>(parsed);
+	return true;
+}
+
+}}} // namespace reven::jsonresource::detail
@@ -1,26 +1,428 @@
 #include "reader.h"
+#include "cbor.h"
 #include "common.h"
+#include "compression.h"
+#include "json_parser.h"
+#include "json_pointer.h"
+#include "json_scanner.h"
+#include "mapped_file.h"
+#include "resource_index.h"
+#include "stats_recorder.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 namespace reven {
 namespace jsonresource {
 
+namespace {
+
+//! Check that the key of the entry is at its offset, followed by the value at the offset of the entry
+bool check_key(std::istream& input, const detail::IndexEntry& entry)
+{
+	input.clear();
+	input.seekg(static_cast<std::streamoff>(entry.key_offset));
+	detail::JsonScanner scanner(input);
+	if (scanner.read_string() != entry.key) {
+		return false;
+	}
+	scanner.expect(':');
+	scanner.peek();
+	return entry.key_offset + scanner.offset() == entry.offset;
+}
+
+//! Parse the value at the byte range of the entry, return false if the range doesn't match a value
+bool read_entry(std::istream& input, const detail::IndexEntry& entry, pt::ptree& value)
+{
+	if (not check_key(input, entry)) {
+		return false;
+	}
+	input.clear();
+	input.seekg(static_cast<std::streamoff>(entry.offset));
+	detail::JsonScanner scanner(input);
+	scanner.read_value(value);
+	return scanner.offset() == entry.length;
+}
+
+//! Parse at most `count` elements starting at `first` from the array of the entry, return false on mismatch
+bool read_elements(std::istream& input, const detail::IndexEntry& entry, std::uint64_t first, std::uint64_t count,
+                   pt::ptree& elements)
+{
+	if (not check_key(input, entry)) {
+		return false;
+	}
+
+	// Start from the chunk containing the first element, or from the beginning of the array
+	std::uint64_t offset = entry.offset;
+	std::uint64_t element = 0;
+	bool in_array = false;
+	for (const auto& chunk : entry.chunks) {
+		if (chunk.first > first) {
+			break;
+		}
+		offset = chunk.offset;
+		element = chunk.first;
+		in_array = true;
+	}
+
+	input.clear();
+	input.seekg(static_cast<std::streamoff>(offset));
+	detail::JsonScanner scanner(input);
+	if (not in_array) {
+		scanner.expect('[');
+		if (scanner.consume(']')) {
+			return true;
+		}
+	}
+
+	for (; element < first; ++element) {
+		scanner.skip_value();
+		if (not scanner.consume(',')) {
+			return scanner.peek() == ']';
+		}
+	}
+
+	for (std::uint64_t i = 0; i < count; ++i) {
+		scanner.read_value(elements.push_back(pt::ptree::value_type("", pt::ptree()))->second);
+		if (not scanner.consume(',')) {
+			return scanner.peek() == ']';
+		}
+	}
+	return true;
+}
+
+}
+
+Reader::Reader(std::istream& stream, const ReaderOptions& options)
+{
+	detail::ResourceInput input(stream, options.rewind);
+	bool binary = false;
+	try {
+		binary = input.is_binary();
+		if (binary) {
+			detail::CborDecoder(*input.stream().rdbuf()).read_document(json_);
+		} else {
+			detail::parse_json(*input.stream().rdbuf(), json_, options.simd);
+		}
+	} catch (const std::exception& e) {
+		throw ReaderError((std::string(binary ? "Binary" : "Json") + " input malformed: " + e.what()).c_str());
+	}
+}
+
 Reader Reader::open(const char* filename) {
-	std::ifstream stream(filename);
-	return Reader::open(stream);
+	return Reader::open(filename, ReaderOptions{});
+}
+
+Reader Reader::open(const char* filename, const ReaderOptions& options) {
+	return Reader::open_file(filename, options, nullptr);
 }
 
 Reader Reader::open(std::istream& stream) {
-	Reader reader(stream);
-	reader.md_ = reader.read_metadata();
+	return Reader::open(stream, ReaderOptions{});
+}
+
+Reader Reader::open(std::istream& stream, const ReaderOptions& options) {
+	return Reader::open_stream(stream, options, nullptr);
+}
+
+Expected<Reader> Reader::try_open(const char* filename, const ReaderOptions& options)
+{
+	ResourceError error;
+	try {
+		auto reader = Reader::open_file(filename, options, &error);
+		if (error.code() == ErrorCode::none) {
+			return reader;
+		}
+	} catch (const ReaderError& e) {
+		return ResourceError(ErrorCode::read_error, e.what());
+	}
+	return error;
+}
+
+Expected<Reader> Reader::try_open(std::istream& stream, const ReaderOptions& options)
+{
+	ResourceError error;
+	try {
+		auto reader = Reader::open_stream(stream, options, &error);
+		if (error.code() == ErrorCode::none) {
+			return reader;
+		}
+	} catch (const ReaderError& e) {
+		return ResourceError(ErrorCode::read_error, e.what());
+	}
+	return error;
+}
+
+Reader Reader::open_file(const char* filename, const ReaderOptions& options, ResourceError* error) {
+	if (not options.memory_map) {
+		std::ifstream stream(filename, std::ios::binary);
+		return Reader::open_stream(stream, options, error);
+	}
+
+	Reader reader;
+	try {
+		reader.mapping_ = detail::MappedFile::open(filename);
+	} catch (const std::exception& e) {
+		throw ReaderError(e.what());
+	}
+
+	if (detail::detect_compression(reader.mapping_->data(), reader.mapping_->size()) != Compression::none) {
+		// Decompressed through the stream path, the mapping is not kept as its bytes are not the resource
+		detail::MemoryBuffer buffer(reader.mapping_->data(), reader.mapping_->data() + reader.mapping_->size());
+		std::istream stream(&buffer);
+		ReaderOptions decompressed;
+		decompressed.simd = options.simd;
+		return Reader::open_stream(stream, decompressed, error);
+	}
+
+	detail::StatsRecorder recorder(Operation::reader_open);
+	recorder.time(&OperationStats::parse_time, [&]() {
+		if (detail::is_cbor(reader.mapping_->data(), reader.mapping_->size())) {
+			try {
+				detail::MemoryBuffer buffer(reader.mapping_->data(),
+				                            reader.mapping_->data() + reader.mapping_->size());
+				detail::CborDecoder(buffer).read_document(reader.json_);
+			} catch (const std::exception& e) {
+				throw ReaderError((std::string("Binary input malformed: ") + e.what()).c_str());
+			}
+			return;
+		}
+
+		// Parse straight from the mapped bytes instead of going through the stream machinery
+		try {
+			const char* begin = reader.mapping_->data();
+			detail::parse_json(begin, begin + reader.mapping_->size(), reader.json_, options.simd);
+		} catch (const std::exception& e) {
+			throw ReaderError((std::string("Json input malformed: ") + e.what()).c_str());
+		}
+	});
+
+	recorder.time(&OperationStats::validate_time, [&]() { reader.decode_metadata(error); });
+	if (recorder.enabled()) {
+		recorder.stats().bytes_read = reader.mapping_->size();
+		recorder.stats().node_count = detail::count_nodes(reader.json_);
+		reader.stats_ = recorder.finish();
+	}
+	return reader;
+}
+
+Reader Reader::open_stream(std::istream& stream, const ReaderOptions& options, ResourceError* error) {
+	detail::StatsRecorder recorder(Operation::reader_open);
+	const auto begin = recorder.enabled() and not options.rewind ? detail::stream_position(stream, std::ios_base::in)
+	                                                              : 0;
+
+	auto reader = recorder.time(&OperationStats::parse_time, [&]() { return Reader(stream, options); });
+	recorder.time(&OperationStats::validate_time, [&]() { reader.decode_metadata(error); });
+	if (recorder.enabled()) {
+		const auto end = detail::stream_position(stream, std::ios_base::in);
+		recorder.stats().bytes_read = end > begin ? end - begin : 0;
+		recorder.stats().node_count = detail::count_nodes(reader.json_);
+		reader.stats_ = recorder.finish();
+	}
+	return reader;
+}
+
+Metadata Reader::peek_metadata(const char* filename) {
+	std::ifstream stream(filename, std::ios::binary);
+	if (not stream) {
+		throw ReaderError((std::string("Can't open ") + filename).c_str());
+	}
+	return Metadata::peek(stream);
+}
+
+Reader Reader::open_section(const char* filename, const std::string& key)
+{
+	Reader reader;
+
+	const auto index = detail::ResourceIndex::load(filename);
+	if (index) {
+		try {
+			std::ifstream input(filename);
+			bool valid = true;
+			for (const auto& section : {std::string("metadata"), key}) {
+				const auto entry = index->find(section);
+				if (entry != nullptr and valid and not reader.json_.get_child_optional(section)) {
+					valid = read_entry(input, *entry, reader.json_.add_child(section, pt::ptree()));
+				}
+			}
+			if (valid) {
+				reader.md_ = reader.read_metadata();
+				return reader;
+			}
+		} catch (const std::exception&) {
+		}
+		// The index doesn't match the resource, fall back to a full parse
+		reader.json_.clear();
+	}
+
+	auto full = Reader::open(filename);
+	for (const auto& section : {std::string("metadata"), key}) {
+		const auto child = full.json_.get_child_optional(section);
+		if (child and not reader.json_.get_child_optional(section)) {
+			reader.json_.add_child(section, pt::ptree()).swap(child.value());
+		}
+	}
+	reader.md_ = full.md_;
 	return reader;
 }
 
+Reader Reader::open_elements(const char* filename, const std::string& key, std::uint64_t first,
+                             std::uint64_t count)
+{
+	Reader reader;
+
+	const auto index = detail::ResourceIndex::load(filename);
+	const auto metadata_entry = index ? index->find("metadata") : nullptr;
+	if (metadata_entry != nullptr) {
+		try {
+			std::ifstream input(filename);
+			bool valid = read_entry(input, *metadata_entry, reader.json_.add_child("metadata", pt::ptree()));
+			const auto entry = index->find(key);
+			if (valid and entry != nullptr) {
+				valid = read_elements(input, *entry, first, count, reader.json_.add_child(key, pt::ptree()));
+			}
+			if (valid) {
+				reader.md_ = reader.read_metadata();
+				return reader;
+			}
+		} catch (const std::exception&) {
+		}
+		reader.json_.clear();
+	}
+
+	auto full = Reader::open(filename);
+	reader.json_.add_child("metadata", pt::ptree()).swap(full.json_.get_child("metadata"));
+	const auto array = full.json_.get_child_optional(key);
+	if (array) {
+		auto& elements = reader.json_.add_child(key, pt::ptree());
+		std::uint64_t element = 0;
+		for (auto& child : array.value()) {
+			if (element >= first and element - first < count) {
+				elements.push_back(pt::ptree::value_type("", pt::ptree()))->second.swap(child.second);
+			}
+			++element;
+		}
+	}
+	reader.md_ = full.md_;
+	return reader;
+}
+
+std::vector<ReaderResult> Reader::open_many(const std::vector<std::string>& paths, const OpenManyOptions& options)
+{
+	std::vector<ReaderResult> results(options.keep_order ? paths.size() : 0);
+	std::mutex completed;
+	std::atomic<std::size_t> next{0};
+	auto worker = [&]() {
+		for (auto i = next++; i < paths.size(); i = next++) {
+			ReaderResult result;
+			result.index = i;
+			result.path = paths[i];
+			try {
+				result.reader = Reader::open(paths[i].c_str(), options.reader);
+			} catch (...) {
+				result.error = std::current_exception();
+			}
+
+			if (options.keep_order) {
+				results[i] = std::move(result);
+			} else {
+				std::lock_guard<std::mutex> lock(completed);
+				results.push_back(std::move(result));
+			}
+		}
+	};
+
+	auto thread_count = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+	thread_count = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, paths.size()));
+	std::vector<std::thread> threads;
+	for (std::size_t i = 1; i < thread_count; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	return results;
+}
+
+QueryResult Reader::query(const char* filename, const std::string& pointer)
+{
+	return Reader::query_many(filename, {pointer});
+}
+
+QueryResult Reader::query_many(const char* filename, const std::vector<std::string>& pointers)
+{
+	// The metadata are queried along with the values, to be validated
+	std::vector<detail::JsonPointer> parsed(pointers.size() + 1);
+	for (std::size_t i = 0; i < pointers.size(); ++i) {
+		if (not detail::parse_pointer(pointers[i], parsed[i])) {
+			throw ReaderError(("Invalid JSON Pointer: \"" + pointers[i] + "\"").c_str());
+		}
+	}
+	parsed.back().push_back("metadata");
+
+	std::shared_ptr<const detail::MappedFile> mapping;
+	try {
+		mapping = detail::MappedFile::open(filename);
+	} catch (const std::exception& e) {
+		throw ReaderError(e.what());
+	}
+
+	if (detail::detect_compression(mapping->data(), mapping->size()) != Compression::none or
+	    detail::is_cbor(mapping->data(), mapping->size())) {
+		// The bytes are not Json that can be scanned
+		const auto full = Reader::open(filename);
+		QueryResult result(full.md_);
+		for (std::size_t i = 0; i < pointers.size(); ++i) {
+			const auto value = detail::resolve_pointer(full.json_, parsed[i]);
+			result.values_.push_back(value != nullptr ? boost::make_optional(*value) : boost::none);
+		}
+		return result;
+	}
+
+	detail::PointerScan scan(parsed);
+	try {
+		detail::JsonScanner scanner(mapping->data(), mapping->data() + mapping->size());
+		scan.scan(scanner);
+	} catch (const std::exception& e) {
+		throw ReaderError((std::string("Json input malformed: ") + e.what()).c_str());
+	}
+
+	auto& values = scan.values();
+	pt::ptree json;
+	if (values.back()) {
+		json.add_child("metadata", pt::ptree()).swap(*values.back());
+	}
+	values.pop_back();
+
+	QueryResult result(Metadata::read_metadata(json));
+	result.values_.swap(values);
+	return result;
+}
+
+boost::string_view Reader::raw() const
+{
+	if (not mapping_) {
+		return {};
+	}
+	return {mapping_->data(), mapping_->size()};
+}
+
 Metadata Reader::read_metadata()
 {
 	return Metadata::read_metadata(json_);
 }
 
+void Reader::decode_metadata(ResourceError* error)
+{
+	ResourceError local_error;
+	if (not Metadata::decode_metadata(json_, md_, error != nullptr ? *error : local_error) and error == nullptr) {
+		local_error.raise();
+	}
+}
+
 }} // namespace reven::jsonresource
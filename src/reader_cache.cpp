@@ -0,0 +1,140 @@
+#include "reader_cache.h"
+#include "file_stat.h"
+
+#include <functional>
+#include <iterator>
+
+namespace reven {
+namespace jsonresource {
+
+std::size_t ReaderCache::KeyHash::operator()(const Key& key) const
+{
+	std::hash<std::uint64_t> hash;
+	std::size_t seed = hash(key.inode);
+	for (const auto value : {key.device, key.size, static_cast<std::uint64_t>(key.mtime)}) {
+		seed ^= hash(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+	return seed;
+}
+
+namespace {
+
+//! Estimate of the memory used by the nodes of the tree and their strings
+std::uint64_t memory_size(const pt::ptree& json)
+{
+	std::uint64_t size = 0;
+	for (const auto& child : json) {
+		// Each node is also linked by the two indexes of its parent
+		size += sizeof(child) + 4 * sizeof(void*) + child.first.size() + child.second.data().size();
+		size += memory_size(child.second);
+	}
+	return size;
+}
+
+}
+
+ReaderCache::ReaderCache(std::uint64_t byte_budget)
+	: byte_budget_(byte_budget)
+{
+}
+
+std::shared_ptr<const Reader> ReaderCache::open(const char* filename, const ReaderOptions& options)
+{
+	detail::FileStat st;
+	if (not detail::stat_file(filename, st)) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			++stats_.misses;
+		}
+		// Let the reader report the error
+		return std::make_shared<const Reader>(Reader::open(filename, options));
+	}
+	const Key key{st.device, st.inode, st.size, st.mtime};
+
+	// Declared before the locks, so the released readers are destroyed once the lock is released
+	std::vector<std::shared_ptr<const Reader>> released;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto it = index_.find(key);
+		if (it != index_.end()) {
+			++stats_.hits;
+			entries_.splice(entries_.begin(), entries_, it->second);
+			return it->second->reader;
+		}
+		++stats_.misses;
+
+		// The file changed since it was cached
+		const auto file = files_.find(filename);
+		if (file != files_.end()) {
+			erase(file->second, released);
+		}
+	}
+	released.clear();
+
+	// Parsed without holding the lock, so other resources can be served meanwhile
+	auto reader = std::make_shared<const Reader>(Reader::open(filename, options));
+	const auto size = sizeof(Reader) + memory_size(reader->json());
+
+	// Only cache the resource if the file did not change while it was read
+	detail::FileStat after;
+	if (not detail::stat_file(filename, after) or after != st or size > byte_budget_) {
+		return reader;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (index_.find(key) == index_.end()) {
+		// Another version of the file may have been cached meanwhile
+		const auto file = files_.find(filename);
+		if (file != files_.end()) {
+			erase(file->second, released);
+		}
+
+		entries_.push_front(Entry{key, filename, size, reader});
+		index_.emplace(key, entries_.begin());
+		files_[filename] = entries_.begin();
+		stats_.bytes += size;
+		evict(released);
+	}
+	return reader;
+}
+
+void ReaderCache::erase(std::list<Entry>::iterator entry, std::vector<std::shared_ptr<const Reader>>& released)
+{
+	stats_.bytes -= entry->size;
+	index_.erase(entry->key);
+	const auto file = files_.find(entry->filename);
+	if (file != files_.end() and file->second == entry) {
+		files_.erase(file);
+	}
+	released.push_back(std::move(entry->reader));
+	entries_.erase(entry);
+}
+
+void ReaderCache::evict(std::vector<std::shared_ptr<const Reader>>& released)
+{
+	while (stats_.bytes > byte_budget_) {
+		erase(std::prev(entries_.end()), released);
+		++stats_.evictions;
+	}
+}
+
+void ReaderCache::clear()
+{
+	// Destroyed once the lock is released
+	std::list<Entry> released;
+	std::lock_guard<std::mutex> lock(mutex_);
+	released.swap(entries_);
+	index_.clear();
+	files_.clear();
+	stats_.bytes = 0;
+}
+
+ReaderCacheStats ReaderCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto stats = stats_;
+	stats.entries = entries_.size();
+	return stats;
+}
+
+}} // namespace reven::jsonresource
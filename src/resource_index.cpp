@@ -0,0 +1,190 @@
+#include "resource_index.h"
+#include "json_scanner.h"
+
+#include <fstream>
+
+#include <boost/property_tree/json_parser.hpp>
+
+namespace pt = boost::property_tree;
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+constexpr std::uint32_t index_version = 2;
+
+}
+
+std::string ResourceIndex::filename_for(const char* filename)
+{
+	return std::string(filename) + ".idx";
+}
+
+ResourceIndex ResourceIndex::build(const char* filename, std::uint64_t array_chunk)
+{
+	ResourceIndex index;
+
+	if (not stat_file(filename, index.stat_)) {
+		throw std::runtime_error(std::string("Can't stat ") + filename);
+	}
+
+	std::ifstream input(filename);
+	if (not input) {
+		throw std::runtime_error(std::string("Can't open ") + filename);
+	}
+
+	JsonScanner scanner(input);
+	scanner.expect('{');
+	if (scanner.consume('}')) {
+		return index;
+	}
+
+	do {
+		IndexEntry entry;
+		scanner.peek();
+		entry.key_offset = scanner.offset();
+		entry.key = scanner.read_string();
+		scanner.expect(':');
+
+		const char first = scanner.peek();
+		entry.offset = scanner.offset();
+
+		if (first == '[' and array_chunk != 0) {
+			scanner.expect('[');
+			if (scanner.peek() != ']') {
+				std::uint64_t element = 0;
+				do {
+					scanner.peek();
+					if (element % array_chunk == 0) {
+						entry.chunks.push_back(IndexChunk{element, 0, scanner.offset(), 0});
+					}
+					scanner.skip_value();
+
+					auto& chunk = entry.chunks.back();
+					chunk.count += 1;
+					chunk.length = scanner.offset() - chunk.offset;
+					++element;
+				} while (scanner.consume(','));
+			}
+			scanner.expect(']');
+		} else {
+			scanner.skip_value();
+		}
+
+		entry.length = scanner.offset() - entry.offset;
+		index.entries_.push_back(std::move(entry));
+	} while (scanner.consume(','));
+	scanner.expect('}');
+
+	return index;
+}
+
+boost::optional<ResourceIndex> ResourceIndex::load(const char* filename)
+{
+	FileStat st;
+	if (not stat_file(filename, st)) {
+		return boost::none;
+	}
+
+	std::ifstream input(filename_for(filename));
+	if (not input) {
+		return boost::none;
+	}
+
+	ResourceIndex index;
+	try {
+		pt::ptree json;
+		pt::read_json(input, json);
+
+		if (json.get<std::uint32_t>("index_version") != index_version) {
+			return boost::none;
+		}
+
+		index.stat_.device = json.get<std::uint64_t>("device");
+		index.stat_.inode = json.get<std::uint64_t>("inode");
+		index.stat_.size = json.get<std::uint64_t>("size");
+		index.stat_.mtime = json.get<std::int64_t>("mtime");
+		if (index.stat_ != st) {
+			return boost::none;
+		}
+
+		for (const auto& jentry : json.get_child("entries")) {
+			IndexEntry entry;
+			entry.key = jentry.second.get<std::string>("key");
+			entry.key_offset = jentry.second.get<std::uint64_t>("key_offset");
+			entry.offset = jentry.second.get<std::uint64_t>("offset");
+			entry.length = jentry.second.get<std::uint64_t>("length");
+
+			const auto jchunks = jentry.second.get_child_optional("chunks");
+			if (jchunks) {
+				for (const auto& jchunk : jchunks.value()) {
+					entry.chunks.push_back(IndexChunk{
+						jchunk.second.get<std::uint64_t>("first"),
+						jchunk.second.get<std::uint64_t>("count"),
+						jchunk.second.get<std::uint64_t>("offset"),
+						jchunk.second.get<std::uint64_t>("length"),
+					});
+				}
+			}
+
+			index.entries_.push_back(std::move(entry));
+		}
+	} catch (const std::exception&) {
+		return boost::none;
+	}
+
+	return index;
+}
+
+void ResourceIndex::save(const char* filename) const
+{
+	pt::ptree json;
+	json.put("index_version", index_version);
+	json.put("device", stat_.device);
+	json.put("inode", stat_.inode);
+	json.put("size", stat_.size);
+	json.put("mtime", stat_.mtime);
+
+	auto& jentries = json.add_child("entries", pt::ptree());
+	for (const auto& entry : entries_) {
+		pt::ptree jentry;
+		jentry.put("key", entry.key);
+		jentry.put("key_offset", entry.key_offset);
+		jentry.put("offset", entry.offset);
+		jentry.put("length", entry.length);
+
+		if (not entry.chunks.empty()) {
+			auto& jchunks = jentry.add_child("chunks", pt::ptree());
+			for (const auto& chunk : entry.chunks) {
+				pt::ptree jchunk;
+				jchunk.put("first", chunk.first);
+				jchunk.put("count", chunk.count);
+				jchunk.put("offset", chunk.offset);
+				jchunk.put("length", chunk.length);
+				jchunks.push_back(pt::ptree::value_type("", jchunk));
+			}
+		}
+
+		jentries.push_back(pt::ptree::value_type("", jentry));
+	}
+
+	std::ofstream output(filename_for(filename), std::fstream::trunc);
+	pt::write_json(output, json, false);
+	if (not output) {
+		throw std::runtime_error("Can't write " + filename_for(filename));
+	}
+}
+
+const IndexEntry* ResourceIndex::find(const std::string& key) const
+{
+	for (const auto& entry : entries_) {
+		if (entry.key == key) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+}}} // namespace reven::jsonresource::detail
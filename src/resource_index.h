@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "file_stat.h"
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Byte range of consecutive elements of a top-level array
+///
+struct IndexChunk {
+	std::uint64_t first;
+	std::uint64_t count;
+	std::uint64_t offset;
+	std::uint64_t length;
+};
+
+///
+/// Byte range of the value of a top-level key
+///
+struct IndexEntry {
+	std::string key;
+	//! Offset of the key, that is checked before the value is read
+	std::uint64_t key_offset;
+	std::uint64_t offset;
+	std::uint64_t length;
+	//! Only filled for arrays, when the index was built with array chunks
+	std::vector<IndexChunk> chunks;
+};
+
+///
+/// Sidecar index mapping the top-level keys of a resource to byte ranges of the resource file
+///
+class ResourceIndex {
+public:
+	//! Name of the sidecar file of the resource
+	static std::string filename_for(const char* filename);
+
+	///
+	/// \brief build Scan the resource and index its top-level keys
+	/// \param array_chunk Number of array elements per chunk for top-level arrays, 0 to not index array elements
+	/// \throws std::runtime_error if the resource can't be read or is malformed
+	static ResourceIndex build(const char* filename, std::uint64_t array_chunk);
+
+	///
+	/// \brief load Load the sidecar index of the resource
+	/// \return none if the index is missing, malformed or if the resource changed or was replaced since it was built
+	static boost::optional<ResourceIndex> load(const char* filename);
+
+	//! Write the sidecar index of the resource
+	//! \throws std::runtime_error if the index can't be written
+	void save(const char* filename) const;
+
+	//! Return the entry of the key, or nullptr if the key is not a top-level key of the resource
+	const IndexEntry* find(const std::string& key) const;
+
+private:
+	//! State of the resource when it was indexed
+	FileStat stat_;
+	std::vector<IndexEntry> entries_;
+};
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,113 @@
+#include "stats.h"
+#include "stats_recorder.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+
+namespace reven {
+namespace jsonresource {
+
+namespace detail {
+
+namespace {
+
+//! Whether an operation collects its statistics, the only check made when they are disabled
+std::atomic<bool> stats_collected{false};
+
+std::mutex settings_mutex;
+bool stats_enabled = false;
+std::shared_ptr<const StatsCallback> stats_callback;
+std::atomic<std::uint64_t (*)()> allocation_counter{nullptr};
+
+std::uint64_t allocations()
+{
+	const auto counter = allocation_counter.load(std::memory_order_relaxed);
+	return counter != nullptr ? counter() : 0;
+}
+
+}
+
+StatsRecorder::StatsRecorder(Operation operation)
+	: enabled_(stats_collected.load(std::memory_order_relaxed))
+{
+	if (enabled_) {
+		stats_.operation = operation;
+		allocations_ = allocations();
+	}
+}
+
+const OperationStats& StatsRecorder::finish()
+{
+	if (not enabled_) {
+		return stats_;
+	}
+
+	stats_.allocation_count = allocations() - allocations_;
+
+	std::shared_ptr<const StatsCallback> callback;
+	{
+		std::lock_guard<std::mutex> lock(settings_mutex);
+		callback = stats_callback;
+	}
+	if (callback) {
+		(*callback)(stats_);
+	}
+	return stats_;
+}
+
+std::uint64_t stream_position(std::ios& stream, std::ios_base::openmode which)
+{
+	if (stream.rdbuf() == nullptr) {
+		return 0;
+	}
+	const auto position = stream.rdbuf()->pubseekoff(0, std::ios_base::cur, which);
+	return position == std::streampos(-1) ? 0 : static_cast<std::uint64_t>(position);
+}
+
+std::uint64_t count_nodes(const boost::property_tree::ptree& json)
+{
+	std::uint64_t count = 1;
+	for (const auto& child : json) {
+		count += count_nodes(child.second);
+	}
+	return count;
+}
+
+std::uint64_t count_nodes(DocumentNode node)
+{
+	std::uint64_t count = 1;
+	for (const auto child : node) {
+		count += count_nodes(child);
+	}
+	return count;
+}
+
+std::uint64_t count_nodes(Document& doc)
+{
+	return count_nodes(doc.root());
+}
+
+} // namespace detail
+
+void enable_stats(bool enable)
+{
+	std::lock_guard<std::mutex> lock(detail::settings_mutex);
+	detail::stats_enabled = enable;
+	detail::stats_collected = detail::stats_enabled or detail::stats_callback != nullptr;
+}
+
+void set_stats_callback(StatsCallback callback)
+{
+	std::lock_guard<std::mutex> lock(detail::settings_mutex);
+	detail::stats_callback = callback ? std::make_shared<const StatsCallback>(std::move(callback)) : nullptr;
+	detail::stats_collected = detail::stats_enabled or detail::stats_callback != nullptr;
+}
+
+void set_allocation_counter(std::uint64_t (*counter)())
+{
+	detail::allocation_counter = counter;
+}
+
+}} // namespace reven::jsonresource
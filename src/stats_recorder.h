@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ios>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "document.h"
+#include "stats.h"
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Statistics of an operation being measured. Nothing is measured when the statistics are disabled.
+///
+class StatsRecorder {
+public:
+	explicit StatsRecorder(Operation operation);
+
+	bool enabled() const { return enabled_; }
+	OperationStats& stats() { return stats_; }
+
+	//! Run the function, and add its duration to the field if the statistics are collected
+	template <typename Function>
+	auto time(std::chrono::nanoseconds OperationStats::* field, Function&& function) -> decltype(function())
+	{
+		Timer timer(enabled_ ? &(stats_.*field) : nullptr);
+		return function();
+	}
+
+	//! Complete the statistics and publish them to the callback
+	const OperationStats& finish();
+
+private:
+	class Timer {
+	public:
+		explicit Timer(std::chrono::nanoseconds* field) : field_(field)
+		{
+			if (field_ != nullptr) {
+				start_ = std::chrono::steady_clock::now();
+			}
+		}
+
+		~Timer()
+		{
+			if (field_ != nullptr) {
+				*field_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+				                                                                start_);
+			}
+		}
+
+	private:
+		std::chrono::nanoseconds* field_;
+		std::chrono::steady_clock::time_point start_;
+	};
+
+	bool enabled_;
+	OperationStats stats_;
+	std::uint64_t allocations_ = 0;
+};
+
+//! Position of the stream buffer, or 0 if it can't tell it. The state of the stream is left untouched.
+std::uint64_t stream_position(std::ios& stream, std::ios_base::openmode which);
+
+//! Number of nodes of the tree, the root included
+std::uint64_t count_nodes(const boost::property_tree::ptree& json);
+std::uint64_t count_nodes(DocumentNode node);
+std::uint64_t count_nodes(Document& doc);
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,168 @@
+#include "stream_writer.h"
+#include "common.h"
+#include "json_emitter.h"
+#include "number.h"
+
+#include <cmath>
+#include <fstream>
+
+namespace reven {
+namespace jsonresource {
+
+StreamWriter StreamWriter::create(const char* filename, const Metadata& md, const OutputFormat& format)
+{
+	return StreamWriter::create(std::make_unique<std::ofstream>(filename, std::fstream::trunc), md, format);
+}
+
+StreamWriter StreamWriter::create(std::unique_ptr<std::ostream>&& stream, const Metadata& md,
+                                  const OutputFormat& format)
+{
+	if (!*stream) {
+		throw WriterError("Bad stream");
+	}
+	return StreamWriter(std::move(stream), md, format);
+}
+
+StreamWriter::StreamWriter(std::unique_ptr<std::ostream>&& stream, const Metadata& md, const OutputFormat& format)
+	: stream_(std::move(stream)), emitter_(std::make_unique<detail::JsonEmitter>(*stream_, format))
+{
+	pt::ptree json;
+	md.write_metadata(json);
+
+	emitter_->begin_object();
+	emitter_->key("metadata");
+	detail::emit_metadata(*emitter_, json.get_child("metadata"));
+	emitter_->padding(format.metadata_padding);
+	objects_.push_back(true);
+}
+
+StreamWriter::StreamWriter(StreamWriter&&) = default;
+StreamWriter::~StreamWriter() = default;
+
+void StreamWriter::before_value()
+{
+	if (objects_.empty()) {
+		throw WriterError("Can't write a value after the end of the resource");
+	}
+	if (objects_.back() and not after_key_) {
+		throw WriterError("Can't write a value in an object without a key");
+	}
+	after_key_ = false;
+}
+
+void StreamWriter::end_container(bool object)
+{
+	// The root object is closed by finalize
+	if (objects_.size() <= 1 or objects_.back() != object) {
+		throw WriterError(object ? "No object to end" : "No array to end");
+	}
+	if (after_key_) {
+		throw WriterError("Can't end an object after a key");
+	}
+	objects_.pop_back();
+}
+
+StreamWriter& StreamWriter::begin_object()
+{
+	before_value();
+	emitter_->begin_object();
+	objects_.push_back(true);
+	return *this;
+}
+
+StreamWriter& StreamWriter::end_object()
+{
+	end_container(true);
+	emitter_->end_object();
+	return *this;
+}
+
+StreamWriter& StreamWriter::begin_array()
+{
+	before_value();
+	emitter_->begin_array();
+	objects_.push_back(false);
+	return *this;
+}
+
+StreamWriter& StreamWriter::end_array()
+{
+	end_container(false);
+	emitter_->end_array();
+	return *this;
+}
+
+StreamWriter& StreamWriter::key(boost::string_view key)
+{
+	if (objects_.empty() or not objects_.back() or after_key_) {
+		throw WriterError("Can't write a key outside of an object");
+	}
+	emitter_->key(key);
+	after_key_ = true;
+	return *this;
+}
+
+StreamWriter& StreamWriter::value(boost::string_view value)
+{
+	before_value();
+	emitter_->string(value);
+	return *this;
+}
+
+StreamWriter& StreamWriter::value(std::uint64_t value)
+{
+	before_value();
+	char buffer[detail::max_number_size];
+	emitter_->raw(boost::string_view(buffer, detail::format_number(value, buffer)));
+	return *this;
+}
+
+StreamWriter& StreamWriter::value(std::int64_t value)
+{
+	before_value();
+	char buffer[detail::max_number_size];
+	emitter_->raw(boost::string_view(buffer, detail::format_number(value, buffer)));
+	return *this;
+}
+
+StreamWriter& StreamWriter::value(double value)
+{
+	if (not std::isfinite(value)) {
+		throw WriterError("Can't write a non-finite number in Json");
+	}
+	before_value();
+	char buffer[detail::max_number_size];
+	emitter_->raw(boost::string_view(buffer, detail::format_number(value, buffer)));
+	return *this;
+}
+
+StreamWriter& StreamWriter::value(bool value)
+{
+	before_value();
+	emitter_->raw(value ? "true" : "false");
+	return *this;
+}
+
+StreamWriter& StreamWriter::null()
+{
+	before_value();
+	emitter_->raw("null");
+	return *this;
+}
+
+std::unique_ptr<std::ostream> StreamWriter::finalize() &&
+{
+	if (objects_.size() != 1 or after_key_) {
+		throw WriterError("Can't finalize a resource with unterminated containers");
+	}
+	objects_.pop_back();
+	emitter_->end_object();
+	emitter_->end_document();
+
+	if (not stream_->good()) {
+		throw WriterError("Can't write Json output: write error");
+	}
+	return std::move(stream_);
+}
+
+}} // namespace reven::jsonresource
@@ -0,0 +1,158 @@
+#include "temporary_file.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+namespace {
+
+constexpr std::size_t buffer_size = 64 * 1024;
+
+//! Path of the file the target designates, through symbolic links. A target that doesn't exist is kept.
+std::string resolve(const std::string& target)
+{
+	char resolved[PATH_MAX];
+	if (::realpath(target.c_str(), resolved) == nullptr) {
+		return target;
+	}
+	return resolved;
+}
+
+//! Create a uniquely named file from the template, that is replaced by the name of the file
+int create_file(std::string& name_template)
+{
+	const int fd = ::mkstemp(&name_template[0]);
+	if (fd < 0) {
+		throw std::system_error(errno, std::generic_category(), "Can't create the temporary file " + name_template);
+	}
+	return fd;
+}
+
+//! Flush the directory of the file, so that its entry is durable
+void sync_directory(const std::string& path)
+{
+	const auto separator = path.rfind('/');
+	std::string directory = ".";
+	if (separator != std::string::npos) {
+		directory = separator == 0 ? "/" : path.substr(0, separator);
+	}
+
+	const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd < 0) {
+		throw std::system_error(errno, std::generic_category(), "Can't open the directory " + directory);
+	}
+	// Some file systems don't support flushing a directory, they have nothing to flush
+	const bool synced = ::fsync(fd) == 0 or errno == EINVAL;
+	const int error = errno;
+	::close(fd);
+	if (not synced) {
+		throw std::system_error(error, std::generic_category(), "Can't flush the directory " + directory);
+	}
+}
+
+}
+
+DescriptorBuffer::DescriptorBuffer(int fd)
+	: fd_(fd), buffer_(buffer_size)
+{
+	setp(buffer_.data(), buffer_.data() + buffer_.size());
+}
+
+DescriptorBuffer::int_type DescriptorBuffer::overflow(int_type c)
+{
+	if (not write_buffer()) {
+		return traits_type::eof();
+	}
+	if (not traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+
+int DescriptorBuffer::sync()
+{
+	return write_buffer() ? 0 : -1;
+}
+
+DescriptorBuffer::pos_type DescriptorBuffer::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                    std::ios_base::openmode which)
+{
+	if (off != 0 or dir != std::ios_base::cur or which != std::ios_base::out) {
+		return pos_type(off_type(-1));
+	}
+	return pos_type(static_cast<off_type>(written_) + (pptr() - pbase()));
+}
+
+bool DescriptorBuffer::write_buffer()
+{
+	const char* it = pbase();
+	while (it != pptr()) {
+		const auto written = ::write(fd_, it, static_cast<std::size_t>(pptr() - it));
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		it += written;
+		written_ += static_cast<std::uint64_t>(written);
+	}
+	setp(buffer_.data(), buffer_.data() + buffer_.size());
+	return true;
+}
+
+TemporaryFile::TemporaryFile(const std::string& target)
+	: target_(resolve(target)), path_(target_ + ".XXXXXX"), fd_(create_file(path_)), buffer_(fd_), stream_(&buffer_)
+{
+	struct stat st;
+	if (::stat(target_.c_str(), &st) == 0) {
+		::fchmod(fd_, st.st_mode & 07777);
+	}
+}
+
+TemporaryFile::~TemporaryFile()
+{
+	if (fd_ >= 0) {
+		::close(fd_);
+	}
+	if (not committed_) {
+		::unlink(path_.c_str());
+	}
+}
+
+void TemporaryFile::commit()
+{
+	if (not stream_.flush()) {
+		throw std::system_error(EIO, std::generic_category(), "Can't write " + path_);
+	}
+
+	// The content must be on the disk before the rename, otherwise a crash may leave the target empty
+	if (::fsync(fd_) != 0) {
+		throw std::system_error(errno, std::generic_category(), "Can't flush " + path_);
+	}
+	const int fd = fd_;
+	fd_ = -1;
+	if (::close(fd) != 0) {
+		throw std::system_error(errno, std::generic_category(), "Can't close " + path_);
+	}
+
+	if (std::rename(path_.c_str(), target_.c_str()) != 0) {
+		throw std::system_error(errno, std::generic_category(), "Can't rename " + path_ + " to " + target_);
+	}
+	committed_ = true;
+
+	sync_directory(target_);
+}
+
+}}} // namespace reven::jsonresource::detail
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace reven {
+namespace jsonresource {
+namespace detail {
+
+///
+/// Output buffer writing to a file descriptor, that it doesn't own
+///
+class DescriptorBuffer : public std::streambuf {
+public:
+	explicit DescriptorBuffer(int fd);
+
+protected:
+	int_type overflow(int_type c) override;
+	int sync() override;
+
+	//! Only reports the current position, the output can't be seeked
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+private:
+	//! Write the buffered bytes, return false on error
+	bool write_buffer();
+
+	int fd_;
+	std::vector<char> buffer_;
+	//! Bytes written to the file
+	std::uint64_t written_ = 0;
+};
+
+///
+/// Temporary file created next to a target file, that atomically replaces the target when committed.
+/// The temporary file is removed if it is not committed.
+///
+class TemporaryFile {
+public:
+	///
+	/// \brief TemporaryFile Create a uniquely named file in the directory of the target
+	/// A symbolic link target is resolved, so the file it points to is replaced rather than the link.
+	/// The permissions of the target are kept if it exists.
+	/// \throws std::system_error if the file can't be created
+	explicit TemporaryFile(const std::string& target);
+	~TemporaryFile();
+
+	TemporaryFile(const TemporaryFile&) = delete;
+	TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+	std::ostream& stream() { return stream_; }
+	const std::string& path() const { return path_; }
+
+	///
+	/// \brief commit Flush the file to the disk and rename it over the target, then flush the directory so the
+	/// rename is durable too
+	/// \throws std::system_error if the file can't be written or renamed
+	void commit();
+
+private:
+	std::string target_;
+	std::string path_;
+	int fd_ = -1;
+	DescriptorBuffer buffer_;
+	std::ostream stream_;
+	bool committed_ = false;
+};
+
+}}} // namespace reven::jsonresource::detail
@@ -1,89 +1,833 @@
 #include "writer.h"
+#include "cbor.h"
+#include "commit_queue.h"
 #include "common.h"
+#include "compression.h"
+#include "json_emitter.h"
+#include "json_scanner.h"
+#include "number.h"
+#include "resource_index.h"
+#include "stats_recorder.h"
+#include "temporary_file.h"
 
+#include <atomic>
 #include <ostream>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
 
 namespace reven {
 namespace jsonresource {
 
 namespace {
 
-bool is_empty(std::ifstream& stream)
+bool is_empty(std::istream& stream)
 {
-	return stream.peek() == std::ifstream::traits_type::eof();
+	return stream.peek() == std::istream::traits_type::eof();
 }
 
+void copy_bytes(std::istream& input, std::ostream& output, std::uint64_t count)
+{
+	char buffer[64 * 1024];
+	while (count != 0 and input) {
+		input.read(buffer, static_cast<std::streamsize>(std::min<std::uint64_t>(count, sizeof(buffer))));
+		output.write(buffer, input.gcount());
+		count -= static_cast<std::uint64_t>(input.gcount());
+	}
 }
 
-Writer Writer::create(const char* filename, const Metadata& md)
+void copy_to_end(std::istream& input, std::ostream& output)
+{
+	char buffer[64 * 1024];
+	while (input) {
+		input.read(buffer, sizeof(buffer));
+		output.write(buffer, input.gcount());
+	}
+}
+
+//! Position of the members of a resource, found without building its content
+struct ResourceLayout {
+	//! Whether the input contains no value at all
+	bool blank = true;
+
+	//! Whether the root object has no member
+	bool empty = true;
+
+	//! Offset right after the opening brace of the root object
+	std::uint64_t content_begin = 0;
+
+	//! Region of the metadata value, that ends at the next token so the padding is included
+	bool has_metadata = false;
+	std::uint64_t metadata_begin = 0;
+	std::uint64_t metadata_end = 0;
+
+	//! Contains the "metadata" member if there is one
+	pt::ptree metadata;
+};
+
+///
+/// \brief scan_resource Locate the members of the resource in a single pass over the input
+/// \param stop_at_metadata Whether the scan stops after the metadata, or validates the whole input
+/// \throws WriterError if the input is not valid Json or if its root is not an object
+ResourceLayout scan_resource(std::istream& input, bool stop_at_metadata)
+{
+	ResourceLayout layout;
+	try {
+		detail::JsonScanner scanner(input);
+		if (scanner.peek() == 0) {
+			return layout;
+		}
+		layout.blank = false;
+
+		scanner.expect('{');
+		layout.content_begin = scanner.offset();
+		if (not scanner.consume('}')) {
+			layout.empty = false;
+			do {
+				const auto key = scanner.read_string();
+				scanner.expect(':');
+				if (key != "metadata" or layout.has_metadata) {
+					scanner.skip_value();
+					continue;
+				}
+
+				scanner.peek();
+				layout.has_metadata = true;
+				layout.metadata_begin = scanner.offset();
+				scanner.read_value(layout.metadata.add_child("metadata", pt::ptree()));
+				scanner.peek();
+				layout.metadata_end = scanner.offset();
+				if (stop_at_metadata) {
+					return layout;
+				}
+			} while (scanner.consume(','));
+			scanner.expect('}');
+		}
+
+		if (scanner.peek() != 0) {
+			throw detail::JsonScanError("garbage after data at offset " + std::to_string(scanner.offset()));
+		}
+	} catch (const std::exception& e) {
+		throw WriterError((std::string("Can't read Json input: ") + e.what()).c_str());
+	}
+	return layout;
+}
+
+//! Copy the value at the position of the scanner token by token, laid out by the emitter
+void copy_value(detail::JsonScanner& scanner, detail::JsonEmitter& emitter)
+{
+	switch (scanner.peek()) {
+	case '{':
+		scanner.expect('{');
+		if (scanner.consume('}')) {
+			emitter.raw("{}");
+			return;
+		}
+		emitter.begin_object();
+		do {
+			emitter.key(scanner.read_string());
+			scanner.expect(':');
+			copy_value(scanner, emitter);
+		} while (scanner.consume(','));
+		scanner.expect('}');
+		emitter.end_object();
+		return;
+	case '[':
+		scanner.expect('[');
+		if (scanner.consume(']')) {
+			emitter.raw("[]");
+			return;
+		}
+		emitter.begin_array();
+		do {
+			copy_value(scanner, emitter);
+		} while (scanner.consume(','));
+		scanner.expect(']');
+		emitter.end_array();
+		return;
+	case '"':
+		emitter.string(scanner.read_string());
+		return;
+	default:
+		emitter.raw(scanner.read_literal());
+	}
+}
+
+///
+/// \brief copy_members Copy the members of the root object of the input, except its metadata
+/// \param replace Whether the metadata of the input are dropped, otherwise the input must not contain any
+/// \throws WriterError if the input is not a Json object or contains unexpected metadata
+void copy_members(std::istream& input, detail::JsonEmitter& emitter, bool replace)
+{
+	try {
+		detail::JsonScanner scanner(input);
+		if (scanner.peek() == 0) {
+			return;
+		}
+
+		scanner.expect('{');
+		if (not scanner.consume('}')) {
+			do {
+				const auto key = scanner.read_string();
+				scanner.expect(':');
+				if (key == "metadata") {
+					if (not replace) {
+						throw WriterError("Can't create a Json resource file already containing metadata.");
+					}
+					scanner.skip_value();
+					continue;
+				}
+				emitter.key(key);
+				copy_value(scanner, emitter);
+			} while (scanner.consume(','));
+			scanner.expect('}');
+		}
+
+		if (scanner.peek() != 0) {
+			throw detail::JsonScanError("garbage after data at offset " + std::to_string(scanner.offset()));
+		}
+	} catch (const WriterError&) {
+		throw;
+	} catch (const std::exception& e) {
+		throw WriterError((std::string("Can't read Json input: ") + e.what()).c_str());
+	}
+}
+
+//! Compression and encoding of a resource
+struct ResourceFormat {
+	Compression compression = Compression::none;
+	ResourceEncoding encoding = ResourceEncoding::json;
+};
+
+//! Detect the format of the resource of the file, that is read from its beginning. An empty file is plain Json.
+//! \throws WriterError if the file can't be read
+ResourceFormat detect_format(std::istream& file)
+{
+	ResourceFormat format;
+	if (is_empty(file)) {
+		return format;
+	}
+	try {
+		detail::ResourceInput input(file);
+		format.compression = input.compression();
+		format.encoding = input.is_binary() ? ResourceEncoding::cbor : ResourceEncoding::json;
+	} catch (const std::exception& e) {
+		throw WriterError((std::string("Can't read Json input: ") + e.what()).c_str());
+	}
+	return format;
+}
+
+//! Write the sidecar index of the written file if requested by the options. The offsets of an index are positions
+//! in the file, so compressed and binary resources have none.
+void write_index(const std::string& filename, const WriterOptions& options)
+{
+	if (not options.write_index or options.encoding != ResourceEncoding::json or
+	    options.compression != Compression::none) {
+		return;
+	}
+
+	try {
+		detail::ResourceIndex::build(filename.c_str(), options.index_array_chunk).save(filename.c_str());
+	} catch (const std::exception& e) {
+		throw WriterError((std::string("Can't write the index: ") + e.what()).c_str());
+	}
+}
+
+//! Whether the resource of the file can be rewritten by `rewrite_resource`. Binary resources and binary outputs
+//! need the content of the resource to be read.
+bool is_streamable(const std::string& filename, const WriterOptions& options)
+{
+	if (options.encoding != ResourceEncoding::json) {
+		return false;
+	}
+	std::ifstream file(filename, std::ios::binary);
+	return detect_format(file).encoding == ResourceEncoding::json;
+}
+
+///
+/// \brief rewrite_resource Stream the Json resource of the file into a temporary file next to it, with the metadata
+/// as first member, then rename the temporary file over the original
+/// The memory used does not depend on the size of the resource, and the original file is left untouched if an error
+/// occurs. The members are laid out according to the format of the options, their values keep their Json types.
+/// \param replace Whether the existing metadata are replaced, otherwise the resource must not contain any
+/// \throws WriterError if the file is not a Json object, contains unexpected metadata, or can't be written
+OperationStats rewrite_resource(const std::string& filename, const Metadata& md, bool replace,
+                                const WriterOptions& options)
 {
 	pt::ptree json;
-	std::ifstream input(filename);
-	if (not is_empty(input)) {
+	md.write_metadata(json);
+
+	detail::StatsRecorder recorder(Operation::writer_commit);
+	std::ifstream file(filename, std::ios::binary);
+	std::unique_ptr<detail::TemporaryFile> output;
+	try {
+		output = std::make_unique<detail::TemporaryFile>(filename);
+	} catch (const std::exception& e) {
+		throw WriterError((std::string("Can't write Json output: ") + e.what()).c_str());
+	}
+
+	recorder.time(&OperationStats::serialize_time, [&]() {
+		auto stream = detail::open_output(output->stream(), options.compression, options.compression_level);
+		detail::JsonEmitter emitter(*stream, options.format);
+		emitter.begin_object();
+		emitter.key("metadata");
+		detail::emit_metadata(emitter, json.get_child("metadata"));
+		emitter.padding(options.format.metadata_padding);
+		if (not is_empty(file)) {
+			detail::ResourceInput input(file);
+			copy_members(input.stream(), emitter, replace);
+		}
+		emitter.end_object();
+		emitter.end_document();
+		stream->reset();
+	});
+
+	recorder.time(&OperationStats::flush_time, [&]() {
 		try {
-			pt::read_json(input, json);
+			if (recorder.enabled()) {
+				recorder.stats().bytes_written = static_cast<std::uint64_t>(output->stream().tellp());
+			}
+			file.close();
+			output->commit();
 		} catch (const std::exception& e) {
-			throw WriterError((std::string("Can't read Json input: ") + e.what()).c_str());
+			throw WriterError((std::string("Can't write Json output: ") + e.what()).c_str());
 		}
-	}
-	input.close();
-	return Writer::create(json, std::make_unique<std::ofstream>(filename, std::fstream::trunc), md);
+		write_index(filename, options);
+	});
+	return recorder.finish();
+}
+
 }
 
-Writer Writer::create(pt::ptree& json, std::unique_ptr<std::ostream>&& stream, const Metadata& md)
+Writer Writer::create(const char* filename, const Metadata& md)
 {
-	if (!*stream) {
-		throw WriterError("Bad stream");
+	return Writer::create(filename, md, WriterOptions{});
+}
+
+Writer Writer::create(const char* filename, const Metadata& md, const WriterOptions& options)
+{
+	auto writer = Writer::from_file(filename, options);
+	writer.stats_ = writer.write_resource(md, false);
+	return writer;
+}
+
+Writer Writer::create(pt::ptree& json, std::unique_ptr<std::ostream>&& stream, const Metadata& md,
+                      const WriterOptions& options)
+{
+	Writer writer(json, std::move(stream));
+	writer.options_ = options;
+	writer.check_no_metadata();
+	writer.create_resource(md);
+	return writer;
+}
+
+Writer Writer::create(pt::ptree&& json, std::unique_ptr<std::ostream>&& stream, const Metadata& md,
+                      const WriterOptions& options)
+{
+	Writer writer(std::move(json), std::move(stream));
+	writer.options_ = options;
+	writer.check_no_metadata();
+	writer.create_resource(md);
+	return writer;
+}
+
+Writer Writer::create(Document&& doc, std::unique_ptr<std::ostream>&& stream, const Metadata& md,
+                      const WriterOptions& options)
+{
+	Writer writer(std::move(doc), std::move(stream));
+	writer.options_ = options;
+	writer.check_no_metadata();
+	writer.create_resource(md);
+	return writer;
+}
+
+Writer Writer::open(const char* filename)
+{
+	return Writer::open(filename, WriterOptions{});
+}
+
+Writer Writer::open(const char* filename, const WriterOptions& options)
+{
+	auto writer = Writer::from_file(filename, options);
+
+	// Only the metadata are read to be checked, the content is read if it is accessed
+	std::ifstream file(filename, std::ios::binary);
+	if (is_empty(file)) {
+		throw MissingMetadata("Missing \"metadata\" field");
 	}
+	Metadata::peek(file);
+	return writer;
+}
+
+Writer Writer::open(pt::ptree& json, std::unique_ptr<std::ostream>&& stream, const WriterOptions& options)
+{
 	Writer writer(json, std::move(stream));
+	writer.options_ = options;
+	writer.check_stream();
+	writer.check_metadata();
+	return writer;
+}
 
-	json = writer.json();
+Writer Writer::open(pt::ptree&& json, std::unique_ptr<std::ostream>&& stream, const WriterOptions& options)
+{
+	Writer writer(std::move(json), std::move(stream));
+	writer.options_ = options;
+	writer.check_stream();
+	writer.check_metadata();
+	return writer;
+}
 
-	const auto& jmetadata = json.get_child_optional("metadata");
-	if (jmetadata) {
+Writer Writer::open(Document&& doc, std::unique_ptr<std::ostream>&& stream, const WriterOptions& options)
+{
+	Writer writer(std::move(doc), std::move(stream));
+	writer.options_ = options;
+	writer.check_stream();
+	writer.check_metadata();
+	return writer;
+}
+
+void Writer::inject_metadata(const char* filename, const Metadata& md, const WriterOptions& options)
+{
+	// The members of a binary output, or of a compressed or binary input, can't keep their bytes: the resource is
+	// created from its content
+	std::ifstream file(filename, std::ios::binary);
+	const auto format = detect_format(file);
+	if (options.encoding != ResourceEncoding::json or format.compression != Compression::none or
+	    format.encoding != ResourceEncoding::json) {
+		file.close();
+		Writer::create(filename, md, options);
+		return;
+	}
+
+	file.clear();
+	file.seekg(0);
+	const auto layout = scan_resource(file, false);
+	if (layout.has_metadata) {
 		throw WriterError("Can't create a Json resource file already containing metadata.");
 	}
 
-	writer.set_metadata(md);
+	pt::ptree json;
+	md.write_metadata(json);
+
+	try {
+		detail::TemporaryFile output(filename);
+		auto stream = detail::open_output(output.stream(), options.compression, options.compression_level);
+
+		detail::JsonEmitter emitter(*stream, options.format);
+		emitter.begin_object();
+		emitter.key("metadata");
+		detail::emit_metadata(emitter, json.get_child("metadata"));
+		emitter.padding(options.format.metadata_padding);
+
+		if (layout.empty) {
+			emitter.end_object();
+			emitter.end_document();
+		} else {
+			// The members keep their original bytes, only the separator with the metadata is added
+			stream->put(',');
+			file.clear();
+			file.seekg(static_cast<std::streamoff>(layout.content_begin));
+			copy_to_end(file, *stream);
+		}
+		stream->reset();
+		file.close();
+		output.commit();
+	} catch (const std::exception& e) {
+		throw WriterError((std::string("Can't write Json output: ") + e.what()).c_str());
+	}
+	write_index(filename, options);
+}
+
+bool Writer::patch_metadata(const char* filename, const Metadata& md, const WriterOptions& options)
+{
+	std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+	if (not file) {
+		throw WriterError((std::string("Can't open ") + filename).c_str());
+	}
+
+	// The metadata of compressed or binary resources can't be located in the file: they are rewritten with the
+	// compression and the encoding they already have
+	auto file_options = options;
+	const auto format = detect_format(file);
+	file_options.compression = format.compression;
+	file_options.encoding = format.encoding;
+	if (format.compression != Compression::none or format.encoding != ResourceEncoding::json) {
+		file.close();
+		Writer::open(filename, file_options).set_metadata(md);
+		return false;
+	}
+	file.clear();
+	file.seekg(0);
+
+	// The region to replace goes up to the next token, padding included
+	auto layout = scan_resource(file, true);
+
+	// Check metadata structure
+	Metadata::read_metadata(layout.metadata);
+	const auto begin = layout.metadata_begin;
+	const auto end = layout.metadata_end;
 
+	std::stringstream block;
+	{
+		pt::ptree json;
+		md.write_metadata(json);
+		detail::JsonEmitter emitter(block, options.format, 1);
+		detail::emit_metadata(emitter, json.get_child("metadata"));
+	}
+	const auto text = block.str();
+
+	bool in_place = text.size() <= end - begin;
+	try {
+		if (in_place) {
+			file.clear();
+			file.seekp(static_cast<std::streamoff>(begin));
+			file << text << std::string(end - begin - text.size(), ' ');
+			file.close();
+			if (file.fail()) {
+				throw std::runtime_error("write error");
+			}
+		} else {
+			detail::TemporaryFile output(filename);
+			file.clear();
+			file.seekg(0);
+			copy_bytes(file, output.stream(), begin);
+			output.stream() << text << std::string(options.format.metadata_padding, ' ');
+			file.seekg(static_cast<std::streamoff>(end));
+			copy_to_end(file, output.stream());
+			file.close();
+			output.commit();
+		}
+	} catch (const std::exception& e) {
+		throw WriterError((std::string("Can't write Json output: ") + e.what()).c_str());
+	}
+	write_index(filename, file_options);
+
+	return in_place;
+}
+
+pt::ptree& Writer::json()
+{
+	load_content();
+	if (backend_ == WriterBackend::arena) {
+		json_ = document_.to_ptree();
+		document_ = Document();
+		backend_ = WriterBackend::ptree;
+	}
+	return json_;
+}
+
+Document& Writer::document()
+{
+	load_content();
+	if (backend_ == WriterBackend::ptree) {
+		document_ = Document::from_ptree(json_);
+		json_.clear();
+		backend_ = WriterBackend::arena;
+	}
+	return document_;
+}
+
+Writer Writer::from_file(const char* filename, const WriterOptions& options)
+{
+	Writer writer = options.backend == WriterBackend::ptree ? Writer(pt::ptree(), nullptr)
+	                                                         : Writer(Document(), nullptr);
+	writer.filename_ = filename;
+	writer.options_ = options;
+	writer.loaded_ = false;
 	return writer;
 }
 
-Writer Writer::open(const char* filename)
+void Writer::load_content()
 {
-	pt::ptree json;
-	std::ifstream input(filename);
+	reclaim_content();
+	if (loaded_) {
+		return;
+	}
+	if (commits_) {
+		commits_->wait();
+	}
+
+	std::ifstream input(filename_, std::ios::binary);
 	if (not is_empty(input)) {
 		try {
-			pt::read_json(input, json);
+			detail::ResourceInput resource(input);
+			if (resource.is_binary()) {
+				detail::CborDecoder(*resource.stream().rdbuf()).read_document(json_);
+				if (backend_ == WriterBackend::arena) {
+					document_ = Document::from_ptree(json_);
+					json_.clear();
+				}
+			} else if (backend_ == WriterBackend::ptree) {
+				pt::read_json(resource.stream(), json_);
+			} else {
+				document_ = Document::read_json(resource.stream());
+			}
 		} catch (const std::exception& e) {
 			throw WriterError((std::string("Can't read Json input: ") + e.what()).c_str());
 		}
 	}
-	input.close();
-	return Writer::open(json, std::make_unique<std::ofstream>(filename, std::fstream::trunc));
+	loaded_ = true;
+}
+
+OperationStats Writer::write_resource(const Metadata& md, bool replace)
+{
+	if (not loaded_ and is_streamable(filename_, options_)) {
+		return rewrite_resource(filename_, md, replace, options_);
+	}
+
+	load_content();
+	if (not replace) {
+		check_no_metadata();
+	}
+	apply_metadata(md);
+	if (backend_ == WriterBackend::ptree) {
+		return commit_file(json_, filename_, options_);
+	}
+	return commit_file(document_, filename_, options_);
+}
+
+void Writer::reclaim_content()
+{
+	// The commit queue releases the commit before its future is ready, so the content is only shared while the
+	// commit runs. The fence pairs with the release of the last other reference, made by the commit thread.
+	if (committed_json_) {
+		if (committed_json_.use_count() == 1) {
+			std::atomic_thread_fence(std::memory_order_acquire);
+			json_.swap(*committed_json_);
+		} else {
+			json_ = *committed_json_;
+		}
+		committed_json_.reset();
+	}
+	if (committed_document_) {
+		if (committed_document_.use_count() == 1) {
+			std::atomic_thread_fence(std::memory_order_acquire);
+			document_ = std::move(*committed_document_);
+		} else {
+			document_ = committed_document_->copy();
+		}
+		committed_document_.reset();
+	}
 }
 
-Writer Writer::open(pt::ptree& json, std::unique_ptr<std::ostream>&& stream)
+void Writer::check_stream() const
 {
-	if (!*stream) {
+	if (!*stream_) {
 		throw WriterError("Bad stream");
 	}
-	Writer writer(json, std::move(stream));
+}
 
-	json = writer.json();
+void Writer::check_no_metadata()
+{
+	reclaim_content();
+	const bool has_metadata = backend_ == WriterBackend::ptree ? bool(json_.get_child_optional("metadata"))
+	                                                           : bool(document_.root().get_child_optional("metadata"));
+	if (has_metadata) {
+		throw WriterError("Can't create a Json resource file already containing metadata.");
+	}
+}
 
-	// Check metadata structure
+void Writer::check_metadata()
+{
+	reclaim_content();
+	if (backend_ == WriterBackend::ptree) {
+		Metadata::read_metadata(json_);
+		return;
+	}
+
+	// Only the metadata object is converted
+	pt::ptree json;
+	const auto jmetadata = document_.root().get_child_optional("metadata");
+	if (jmetadata) {
+		json.add_child("metadata", jmetadata->to_ptree());
+	}
 	Metadata::read_metadata(json);
+}
 
-	return writer;
+void Writer::create_resource(const Metadata& md)
+{
+	check_stream();
+	set_metadata(md);
 }
 
 void Writer::set_metadata(const Metadata& md)
 {
-	json_.erase("metadata");
-	md.serialize(json_, *stream_);
+	if (commits_) {
+		commits_->wait();
+	}
+
+	if (not filename_.empty()) {
+		stats_ = write_resource(md, true);
+		return;
+	}
+
+	apply_metadata(md);
+	if (backend_ == WriterBackend::ptree) {
+		stats_ = commit(*stream_, json_, options_);
+	} else {
+		stats_ = commit(*stream_, document_, options_);
+	}
+}
+
+std::future<void> Writer::commit_async(const Metadata& md)
+{
+	// The content is handed over to the commit, the writer takes it back when it is accessed again
+	std::function<void()> task;
+	const auto stream = stream_.get();
+	const auto filename = filename_;
+	const auto options = options_;
+	if (not filename.empty() and not loaded_ and is_streamable(filename, options)) {
+		task = [filename, options, md]() { rewrite_resource(filename, md, true, options); };
+	} else {
+		if (not filename.empty()) {
+			load_content();
+		}
+		apply_metadata(md);
+		if (backend_ == WriterBackend::ptree) {
+			committed_json_ = std::make_shared<pt::ptree>();
+			committed_json_->swap(json_);
+			const std::shared_ptr<const pt::ptree> content = committed_json_;
+			task = [stream, filename, options, content]() {
+				filename.empty() ? commit(*stream, *content, options) : commit_file(*content, filename, options);
+			};
+		} else {
+			committed_document_ = std::make_shared<Document>(std::move(document_));
+			document_ = Document();
+			const auto content = committed_document_;
+			task = [stream, filename, options, content]() {
+				filename.empty() ? commit(*stream, *content, options) : commit_file(*content, filename, options);
+			};
+		}
+	}
+
+	if (not commits_) {
+		commits_ = std::make_shared<detail::CommitQueue>();
+	}
+	return commits_->push(std::move(task));
+}
+
+template <typename Content>
+OperationStats Writer::commit(std::ostream& stream, Content& content, const WriterOptions& options)
+{
+	detail::StatsRecorder recorder(Operation::writer_commit);
+	const auto begin = recorder.enabled() ? detail::stream_position(stream, std::ios_base::out) : 0;
+
+	recorder.time(&OperationStats::serialize_time, [&]() { write_content(stream, content, options); });
+	recorder.time(&OperationStats::flush_time, [&]() { stream.flush(); });
+
+	if (recorder.enabled()) {
+		const auto end = detail::stream_position(stream, std::ios_base::out);
+		recorder.stats().bytes_written = end > begin ? end - begin : 0;
+		recorder.stats().node_count = detail::count_nodes(content);
+	}
+	return recorder.finish();
+}
+
+template <typename Content>
+OperationStats Writer::commit_file(Content& content, const std::string& filename, const WriterOptions& options)
+{
+	detail::StatsRecorder recorder(Operation::writer_commit);
+	std::unique_ptr<detail::TemporaryFile> output;
+	try {
+		output = std::make_unique<detail::TemporaryFile>(filename);
+	} catch (const std::exception& e) {
+		throw WriterError((std::string("Can't write Json output: ") + e.what()).c_str());
+	}
+
+	recorder.time(&OperationStats::serialize_time, [&]() {
+		auto stream = detail::open_output(output->stream(), options.compression, options.compression_level);
+		write_content(*stream, content, options);
+		stream->reset();
+	});
+	recorder.time(&OperationStats::flush_time, [&]() {
+		try {
+			if (recorder.enabled()) {
+				recorder.stats().bytes_written = static_cast<std::uint64_t>(output->stream().tellp());
+			}
+			output->commit();
+		} catch (const std::exception& e) {
+			throw WriterError((std::string("Can't write Json output: ") + e.what()).c_str());
+		}
+		write_index(filename, options);
+	});
+
+	if (recorder.enabled()) {
+		recorder.stats().node_count = detail::count_nodes(content);
+	}
+	return recorder.finish();
+}
+
+std::ostream* Writer::output_stream()
+{
+	if (commits_) {
+		commits_->wait();
+	}
+	return stream_.get();
+}
+
+std::unique_ptr<std::ostream>&& Writer::finalize() &&
+{
+	if (commits_) {
+		commits_->wait();
+	}
+	return std::move(stream_);
+}
+
+void Writer::apply_metadata(const Metadata& md)
+{
+	reclaim_content();
+	if (backend_ == WriterBackend::ptree) {
+		json_.erase("metadata");
+		md.write_metadata(json_);
+		return;
+	}
+
+	auto root = document_.root();
+	root.erase("metadata");
+
+	pt::ptree json;
+	md.write_metadata(json);
+	auto metadata = root.push_front("metadata");
+	metadata.assign(json.get_child("metadata"));
+
+	// Stored natively, so that the document writes them as numbers
+	for (auto field : metadata) {
+		std::uint64_t value = 0;
+		if (field.empty() and detail::is_number_field(field.key()) and detail::parse_number(field.data(), value)) {
+			field.put_value(value);
+		}
+	}
+}
+
+void Writer::write_content(std::ostream& stream, const pt::ptree& json, const WriterOptions& options)
+{
+	try {
+		if (options.encoding == ResourceEncoding::json) {
+			detail::emit_document(stream, json, options.format);
+		} else {
+			detail::write_cbor(stream, json);
+		}
+	} catch (const std::exception& e) {
+		throw WriteMetadataError((std::string(options.encoding == ResourceEncoding::json ? "Can't write Json output: "
+		                                                                                 : "Can't write binary output: ")
+		                          + e.what()).c_str());
+	}
+}
+
+void Writer::write_content(std::ostream& stream, Document& doc, const WriterOptions& options)
+{
+	try {
+		if (options.encoding == ResourceEncoding::json) {
+			write_json(stream, doc, options.format);
+		} else {
+			detail::write_cbor(stream, doc);
+		}
+	} catch (const std::exception& e) {
+		throw WriteMetadataError((std::string(options.encoding == ResourceEncoding::json ? "Can't write Json output: "
+		                                                                                 : "Can't write binary output: ")
+		                          + e.what()).c_str());
+	}
 }
 
 }} // namespace reven::jsonresource
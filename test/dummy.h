@@ -1,5 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <streambuf>
+#include <string>
+
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -77,6 +81,15 @@ public:
 		             dummy_tool_info,
 		             dummy_generation_date);
 	}
+	static MD custom_md(const reven::jsonresource::CustomMetadata& custom_metadata) {
+		return write(dummy_type,
+		             dummy_format_version,
+		             dummy_tool_name,
+		             dummy_tool_version,
+		             dummy_tool_info,
+		             dummy_generation_date,
+		             custom_metadata);
+	}
 	static MD dummy_md2() {
 		return write(dummy_type * 2,
 		             dummy_format_version,
@@ -87,6 +100,28 @@ public:
 	}
 };
 
+// Stream buffer that can't be seeked and gives its data by small chunks, like a pipe
+class PipeBuffer : public std::streambuf {
+public:
+	explicit PipeBuffer(std::string data) : data_(std::move(data)) {}
+
+protected:
+	int_type underflow() override {
+		if (position_ == data_.size()) {
+			return traits_type::eof();
+		}
+		const auto size = std::min<std::size_t>(7, data_.size() - position_);
+		const auto begin = &data_[position_];
+		setg(begin, begin, begin + size);
+		position_ += size;
+		return traits_type::to_int_type(*begin);
+	}
+
+private:
+	std::string data_;
+	std::size_t position_ = 0;
+};
+
 struct transient_directory {
 	//! Path of created directory.
 	boost::filesystem::path path;
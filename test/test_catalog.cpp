@@ -0,0 +1,197 @@
+#define BOOST_TEST_MODULE RVN_JSONRESOURCE_CATALOG
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catalog.h"
+#include "metadata.h"
+#include "writer.h"
+#include "dummy.h"
+
+using MD = reven::jsonresource::Metadata;
+using Catalog = reven::jsonresource::Catalog;
+using Writer = reven::jsonresource::Writer;
+
+namespace {
+
+void write_resource(const boost::filesystem::path& path, const MD& md)
+{
+	boost::filesystem::create_directories(path.parent_path());
+	init_json_file(path.generic_string(), valid_json);
+	Writer::inject_metadata(path.generic_string().c_str(), md);
+}
+
+void set_mtime(const boost::filesystem::path& path, std::int64_t seconds)
+{
+	const struct timespec times[2] = {{seconds, 0}, {seconds, 0}};
+	BOOST_REQUIRE(::utimensat(AT_FDCWD, path.generic_string().c_str(), times, 0) == 0);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(scan)
+{
+	transient_directory tmp_dir{};
+	write_resource(tmp_dir.path / "a.json", TestMDWriter::dummy_md());
+	write_resource(tmp_dir.path / "sub" / "b.json", TestMDWriter::dummy_md2());
+	write_resource(tmp_dir.path / "sub" / "deeper" / "c.json", TestMDWriter::dummy_md());
+	init_json_file((tmp_dir.path / "sub" / "no_metadata.json").generic_string(), valid_json);
+	init_json_file((tmp_dir.path / "other.txt").generic_string(), valid_json);
+
+	reven::jsonresource::CatalogOptions options;
+	options.threads = 3;
+
+	Catalog catalog;
+	const auto result = catalog.scan(tmp_dir.path.generic_string().c_str(), options);
+	BOOST_CHECK_EQUAL(result.read, 3);
+	BOOST_CHECK_EQUAL(result.kept, 0);
+	BOOST_CHECK_EQUAL(result.failed, 1);
+	BOOST_CHECK_EQUAL(result.removed, 0);
+
+	BOOST_REQUIRE_EQUAL(catalog.entries().size(), 3);
+	BOOST_CHECK_EQUAL(catalog.entries()[0].path, "a.json");
+	BOOST_CHECK_EQUAL(catalog.entries()[1].path, "sub/b.json");
+	BOOST_CHECK_EQUAL(catalog.entries()[2].path, "sub/deeper/c.json");
+	BOOST_CHECK_EQUAL(catalog.entries()[1].metadata, TestMDWriter::dummy_md2());
+	BOOST_CHECK_EQUAL(catalog.entries()[1].size, boost::filesystem::file_size(tmp_dir.path / "sub" / "b.json"));
+
+	BOOST_REQUIRE(catalog.find("sub/deeper/c.json") != nullptr);
+	BOOST_CHECK_EQUAL(catalog.find("sub/deeper/c.json")->metadata, TestMDWriter::dummy_md());
+	BOOST_CHECK(catalog.find("sub/no_metadata.json") == nullptr);
+
+	const auto selected = catalog.select([](const MD& md) { return md.type() == dummy_type * 2; });
+	BOOST_REQUIRE_EQUAL(selected.size(), 1);
+	BOOST_CHECK_EQUAL(selected[0]->path, "sub/b.json");
+
+	BOOST_REQUIRE_EQUAL(catalog.failures().size(), 1);
+	BOOST_CHECK_EQUAL(catalog.failures()[0].path, "sub/no_metadata.json");
+
+	// Unchanged files that are not resources are not read again
+	const auto again = catalog.scan(tmp_dir.path.generic_string().c_str(), options);
+	BOOST_CHECK_EQUAL(again.kept, 3);
+	BOOST_CHECK_EQUAL(again.failed, 0);
+	BOOST_CHECK_EQUAL(again.skipped, 1);
+	set_mtime(tmp_dir.path / "sub" / "no_metadata.json", 1000);
+	BOOST_CHECK_EQUAL(catalog.scan(tmp_dir.path.generic_string().c_str(), options).failed, 1);
+	write_resource(tmp_dir.path / "sub" / "no_metadata.json", TestMDWriter::dummy_md());
+	const auto fixed = catalog.scan(tmp_dir.path.generic_string().c_str(), options);
+	BOOST_CHECK_EQUAL(fixed.read, 1);
+	BOOST_CHECK_EQUAL(fixed.skipped, 0);
+	BOOST_CHECK(catalog.failures().empty());
+
+	options.extension = "";
+	BOOST_CHECK_EQUAL(Catalog().scan(tmp_dir.path.generic_string().c_str(), options).failed, 1);
+
+	BOOST_CHECK_THROW(Catalog().scan((tmp_dir.path / "missing").generic_string().c_str()),
+	                  reven::jsonresource::CatalogError);
+}
+
+BOOST_AUTO_TEST_CASE(save_and_rescan)
+{
+	transient_directory tmp_dir{};
+	const auto root = tmp_dir.path / "resources";
+	const auto catalog_file = (tmp_dir.path / "catalog.json").generic_string();
+	write_resource(root / "a.json", TestMDWriter::dummy_md());
+	write_resource(root / "b.json", TestMDWriter::dummy_md());
+	write_resource(root / "c.json", TestMDWriter::dummy_md());
+	init_json_file((root / "not_a_resource.json").generic_string(), valid_json);
+	set_mtime(root / "a.json", 1000);
+
+	{
+		Catalog catalog;
+		catalog.scan(root.generic_string().c_str());
+		catalog.save(catalog_file.c_str());
+	}
+
+	auto catalog = Catalog::load(catalog_file.c_str());
+	BOOST_REQUIRE_EQUAL(catalog.entries().size(), 3);
+	BOOST_CHECK_EQUAL(catalog.entries()[0].mtime, 1000000000000);
+	BOOST_CHECK_EQUAL(catalog.entries()[0].metadata, TestMDWriter::dummy_md());
+	BOOST_REQUIRE_EQUAL(catalog.failures().size(), 1);
+	BOOST_CHECK_EQUAL(catalog.failures()[0].path, "not_a_resource.json");
+
+	// Same size, other mtime
+	BOOST_CHECK(Writer::patch_metadata((root / "a.json").generic_string().c_str(), TestMDWriter::dummy_md2()));
+	set_mtime(root / "a.json", 2000);
+	boost::filesystem::remove(root / "b.json");
+	write_resource(root / "d.json", TestMDWriter::dummy_md());
+
+	const auto result = catalog.scan(root.generic_string().c_str());
+	BOOST_CHECK_EQUAL(result.read, 2);
+	BOOST_CHECK_EQUAL(result.kept, 1);
+	BOOST_CHECK_EQUAL(result.failed, 0);
+	BOOST_CHECK_EQUAL(result.skipped, 1);
+	BOOST_CHECK_EQUAL(result.removed, 1);
+
+	BOOST_REQUIRE_EQUAL(catalog.entries().size(), 3);
+	BOOST_CHECK_EQUAL(catalog.find("a.json")->metadata, TestMDWriter::dummy_md2());
+	BOOST_CHECK(catalog.find("b.json") == nullptr);
+	BOOST_CHECK(catalog.find("d.json") != nullptr);
+
+	// Nothing changed
+	const auto again = catalog.scan(root.generic_string().c_str());
+	BOOST_CHECK_EQUAL(again.read, 0);
+	BOOST_CHECK_EQUAL(again.kept, 3);
+
+	// Removed failures are counted too
+	boost::filesystem::remove(root / "not_a_resource.json");
+	BOOST_CHECK_EQUAL(catalog.scan(root.generic_string().c_str()).removed, 1);
+	BOOST_CHECK(catalog.failures().empty());
+}
+
+BOOST_AUTO_TEST_CASE(unlisted_directories)
+{
+	transient_directory tmp_dir{};
+	write_resource(tmp_dir.path / "a.json", TestMDWriter::dummy_md());
+	write_resource(tmp_dir.path / "z.json", TestMDWriter::dummy_md());
+
+	// Nested until the path is too long to be opened, even with privileges
+	const std::string name(200, 'd');
+	std::vector<int> directories = {::open(tmp_dir.path.generic_string().c_str(), O_RDONLY | O_DIRECTORY)};
+	for (int i = 0; i < 25; ++i) {
+		BOOST_REQUIRE(::mkdirat(directories.back(), name.c_str(), 0755) == 0);
+		directories.push_back(::openat(directories.back(), name.c_str(), O_RDONLY | O_DIRECTORY));
+		BOOST_REQUIRE(directories.back() >= 0);
+	}
+
+	Catalog catalog;
+	const auto result = catalog.scan(tmp_dir.path.generic_string().c_str());
+	BOOST_CHECK_EQUAL(result.read, 2);
+	BOOST_CHECK_EQUAL(result.failed, 1);
+	BOOST_REQUIRE_EQUAL(catalog.failures().size(), 1);
+	BOOST_CHECK_EQUAL(catalog.failures()[0].path.substr(0, name.size() + 1), name + "/");
+
+	// The directories are removed from the deepest, as their paths are too long for boost::filesystem
+	::close(directories.back());
+	directories.pop_back();
+	while (not directories.empty()) {
+		BOOST_CHECK(::unlinkat(directories.back(), name.c_str(), AT_REMOVEDIR) == 0);
+		::close(directories.back());
+		directories.pop_back();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(load_errors)
+{
+	transient_directory tmp_dir{};
+	const auto catalog_file = (tmp_dir.path / "catalog.json").generic_string();
+
+	BOOST_CHECK_THROW(Catalog::load(catalog_file.c_str()), reven::jsonresource::CatalogError);
+
+	for (const char* text : {"", "{}", "{\"catalog_version\": \"2\", \"entries\": []}",
+	                         "{\"catalog_version\": \"1\", \"entries\": [{\"path\": \"a.json\"}]}",
+	                         "{\"catalog_version\": \"1\", \"entries\": [",
+	                         "{\"entries\": [], \"catalog_version\": \"1\"}",
+	                         "{\"failures\": [], \"catalog_version\": \"1\", \"entries\": []}"}) {
+		init_json_file(catalog_file, text);
+		BOOST_CHECK_THROW(Catalog::load(catalog_file.c_str()), reven::jsonresource::CatalogError);
+	}
+
+	init_json_file(catalog_file, "{\"catalog_version\": \"1\", \"entries\": []}");
+	BOOST_CHECK(Catalog::load(catalog_file.c_str()).entries().empty());
+}
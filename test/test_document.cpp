@@ -0,0 +1,272 @@
+#define BOOST_TEST_MODULE RVN_JSONRESOURCE_DOCUMENT
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "document.h"
+#include "dummy.h"
+
+using Document = reven::jsonresource::Document;
+
+constexpr const char* nested_json =
+	"{\"a\": \"0\", \"b\": {\"c\": [\"1\", 2, true, null, {\"d\": \"\\\"\\/\\u0001\\u00e9\"}]}, \"e\": {}, \"f\": []}";
+
+pt::ptree json_from(const std::string& jsontext)
+{
+	std::stringstream istream(jsontext);
+	pt::ptree json;
+	pt::read_json(istream, json);
+	return json;
+}
+
+BOOST_AUTO_TEST_CASE(ptree_conversion)
+{
+	const auto json = json_from(nested_json);
+
+	const auto doc = Document::from_ptree(json);
+	BOOST_CHECK(doc.to_ptree() == json);
+	BOOST_CHECK(Document().to_ptree() == pt::ptree());
+}
+
+BOOST_AUTO_TEST_CASE(read_write_json)
+{
+	const auto json = json_from(nested_json);
+
+	std::stringstream input(nested_json);
+	const auto doc = Document::read_json(input);
+	BOOST_CHECK(doc.to_ptree() == json);
+
+	std::stringstream expected;
+	pt::write_json(expected, json);
+	std::stringstream output;
+	reven::jsonresource::write_json(output, Document::from_ptree(json));
+	BOOST_CHECK_EQUAL(output.str(), expected.str());
+
+	// Literals keep their type, and are written without quotes
+	std::stringstream typed_output;
+	reven::jsonresource::write_json(typed_output, doc);
+	BOOST_CHECK_NE(typed_output.str().find("\"1\",\n            2,\n            true,\n            null,"),
+	               std::string::npos);
+	std::stringstream typed_input(typed_output.str());
+	BOOST_CHECK(Document::read_json(typed_input).to_ptree() == json);
+
+	std::stringstream empty_expected;
+	pt::write_json(empty_expected, pt::ptree());
+	std::stringstream empty_output;
+	reven::jsonresource::write_json(empty_output, Document());
+	BOOST_CHECK_EQUAL(empty_output.str(), empty_expected.str());
+
+	std::stringstream malformed("{\"a\": [}");
+	BOOST_CHECK_THROW(Document::read_json(malformed), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(edit)
+{
+	Document doc;
+	auto root = doc.root();
+	root.put("a", "0");
+	root.push_back("b").put("", "1");
+	root.put("a", "2");
+	root.push_front("c").put_value("3");
+
+	BOOST_CHECK_EQUAL(root.size(), 4);
+	BOOST_CHECK_EQUAL((*root.begin()).key(), "c");
+	BOOST_CHECK_EQUAL(root.get_child_optional("a")->data(), "0");
+	BOOST_CHECK(not root.get_child_optional("d"));
+
+	BOOST_CHECK_EQUAL(root.erase("a"), 2);
+	BOOST_CHECK_EQUAL(root.size(), 2);
+	root.put("d", "4");
+
+	BOOST_CHECK(doc.to_ptree() == json_from("{\"c\": \"3\", \"b\": [\"1\"], \"d\": \"4\"}"));
+
+	// Root can't have data
+	root.put_value("5");
+	std::stringstream output;
+	BOOST_CHECK_THROW(reven::jsonresource::write_json(output, doc), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(arena)
+{
+	Document doc;
+	BOOST_CHECK_EQUAL(doc.allocated_bytes(), 0);
+
+	auto root = doc.root();
+	for (int i = 0; i < 100000; ++i) {
+		root.put(std::to_string(i), "value");
+	}
+	BOOST_CHECK_EQUAL(root.size(), 100000);
+	BOOST_CHECK_GT(doc.allocated_bytes(), 0);
+
+	auto moved = std::move(doc);
+	BOOST_CHECK_EQUAL(moved.root().size(), 100000);
+	BOOST_CHECK_EQUAL(doc.allocated_bytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(typed_values)
+{
+	using reven::jsonresource::ValueType;
+
+	Document doc;
+	auto root = doc.root();
+	root.push_back("u").put_value(std::uint64_t(18446744073709551615u));
+	root.push_back("i").put_value(-42);
+	root.push_back("f").put_value(0.1);
+	root.push_back("b").put_value(true);
+	root.push_back("n").put_null();
+	root.put("s", "42");
+	root.put("t", "not a number");
+
+	BOOST_CHECK(root.get_child_optional("u")->type() == ValueType::unsigned_integer);
+	BOOST_CHECK(root.get_child_optional("i")->type() == ValueType::signed_integer);
+	BOOST_CHECK(root.get_child_optional("s")->type() == ValueType::string);
+	BOOST_CHECK_EQUAL(root.get_child_optional("u")->data(), "18446744073709551615");
+	BOOST_CHECK_EQUAL(root.get_child_optional("f")->data(), "0.1");
+
+	BOOST_CHECK_EQUAL(*root.get_child_optional("u")->get_value_optional<std::uint64_t>(), 18446744073709551615u);
+	BOOST_CHECK(not root.get_child_optional("u")->get_value_optional<std::uint32_t>());
+	BOOST_CHECK(not root.get_child_optional("u")->get_value_optional<std::int64_t>());
+	BOOST_CHECK_EQUAL(*root.get_child_optional("i")->get_value_optional<int>(), -42);
+	BOOST_CHECK_EQUAL(*root.get_child_optional("i")->get_value_optional<double>(), -42.0);
+	BOOST_CHECK(not root.get_child_optional("i")->get_value_optional<unsigned>());
+	BOOST_CHECK_EQUAL(*root.get_child_optional("f")->get_value_optional<double>(), 0.1);
+	BOOST_CHECK(not root.get_child_optional("f")->get_value_optional<int>());
+	BOOST_CHECK(*root.get_child_optional("b")->get_value_optional<bool>());
+	BOOST_CHECK(not root.get_child_optional("n")->get_value_optional<int>());
+
+	// Quoted numbers are parsed
+	BOOST_CHECK_EQUAL(*root.get_child_optional("s")->get_value_optional<std::uint32_t>(), 42u);
+	BOOST_CHECK_EQUAL(*root.get_child_optional("s")->get_value_optional<double>(), 42.0);
+	BOOST_CHECK(not root.get_child_optional("t")->get_value_optional<int>());
+
+	std::stringstream output;
+	reven::jsonresource::OutputFormat format;
+	format.compact = true;
+	reven::jsonresource::write_json(output, doc, format);
+	BOOST_CHECK_EQUAL(output.str(), "{\"u\":18446744073709551615,\"i\":-42,\"f\":0.1,\"b\":true,\"n\":null,"
+	                                "\"s\":\"42\",\"t\":\"not a number\"}\n");
+
+	std::stringstream input(output.str());
+	auto read = Document::read_json(input);
+	BOOST_CHECK(read.root().get_child_optional("f")->type() == ValueType::floating);
+	BOOST_CHECK(read.root().get_child_optional("n")->type() == ValueType::null);
+	BOOST_CHECK_EQUAL(*read.root().get_child_optional("i")->get_value_optional<std::int64_t>(), -42);
+
+	auto copy = doc.copy();
+	BOOST_CHECK(copy.root().get_child_optional("b")->type() == ValueType::boolean);
+
+	root.push_back("nan").put_value(std::numeric_limits<double>::quiet_NaN());
+	std::stringstream nan_output;
+	BOOST_CHECK_THROW(reven::jsonresource::write_json(nan_output, doc), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(number_literals)
+{
+	using reven::jsonresource::ValueType;
+
+	// Numbers are written back with their text, including the ones that don't fit the native types
+	const std::string text = "{\"n\":[1.0,-0,1e400,-1e400,123456789012345678901234567890,-99999999999999999999,"
+	                         "1E2,0.10000000000000000001,18446744073709551615,-9223372036854775808]}\n";
+	std::stringstream input(text);
+	auto doc = Document::read_json(input);
+	std::vector<reven::jsonresource::DocumentNode> nodes;
+	std::vector<ValueType> types;
+	for (const auto& child : *doc.root().get_child_optional("n")) {
+		nodes.push_back(child);
+		types.push_back(child.type());
+	}
+	const std::vector<ValueType> expected = {
+		ValueType::floating, ValueType::signed_integer, ValueType::number, ValueType::number, ValueType::number,
+		ValueType::number, ValueType::floating, ValueType::floating, ValueType::unsigned_integer,
+		ValueType::signed_integer};
+	BOOST_CHECK(types == expected);
+
+	reven::jsonresource::OutputFormat format;
+	format.compact = true;
+	std::stringstream output;
+	reven::jsonresource::write_json(output, doc, format);
+	BOOST_CHECK_EQUAL(output.str(), text);
+
+	auto copy = doc.copy();
+	std::stringstream copy_output;
+	reven::jsonresource::write_json(copy_output, copy, format);
+	BOOST_CHECK_EQUAL(copy_output.str(), text);
+
+	// Numbers that don't fit are only converted when they can be represented
+	BOOST_CHECK_EQUAL(*nodes[0].get_value_optional<double>(), 1.0);
+	BOOST_CHECK(not nodes[2].get_value_optional<double>());
+	BOOST_CHECK(not nodes[2].get_value_optional<std::uint64_t>());
+	BOOST_CHECK_CLOSE(*nodes[4].get_value_optional<double>(), 1.2345678901234568e29, 1e-9);
+	BOOST_CHECK(not nodes[4].get_value_optional<std::uint64_t>());
+
+	BOOST_CHECK_THROW(nodes[0].put_number("12x"), std::runtime_error);
+	BOOST_CHECK_THROW(nodes[0].put_number("+5"), std::runtime_error);
+	BOOST_CHECK(nodes[0].type() == ValueType::floating);
+
+	// Doubles only convert to the types that can represent them
+	nodes[0].put_number("1e300");
+	BOOST_CHECK_EQUAL(*nodes[0].get_value_optional<double>(), 1e300);
+	BOOST_CHECK(not nodes[0].get_value_optional<float>());
+	nodes[0].put_number("-3e38");
+	BOOST_CHECK_CLOSE(*nodes[0].get_value_optional<float>(), -3e38f, 1e-4);
+	nodes[0].put_value(std::numeric_limits<double>::infinity());
+	BOOST_CHECK(nodes[0].get_value_optional<float>());
+
+	using reven::jsonresource::detail::fits;
+	BOOST_CHECK(fits<std::int64_t>(-9223372036854775808.0));
+	BOOST_CHECK(not fits<std::int64_t>(9223372036854775808.0));
+	BOOST_CHECK(fits<std::uint8_t>(255.0));
+	BOOST_CHECK(not fits<std::uint8_t>(256.0));
+	BOOST_CHECK(not fits<std::uint8_t>(-1.0));
+	BOOST_CHECK(not fits<int>(1.5));
+	BOOST_CHECK(not fits<int>(std::numeric_limits<double>::quiet_NaN()));
+}
+
+BOOST_AUTO_TEST_CASE(malformed_input)
+{
+	// Like `pt::read_json`, the input is rejected when a literal is not a Json number or a string is not UTF-8
+	const std::vector<std::string> malformed = {
+		"{\"a\": 1-2}", "{\"a\": +5}", "{\"a\": --}", "{\"a\": 01}", "{\"a\": 1.}", "{\"a\": .5}",
+		"{\"a\": 1e}", "{\"a\": nul}", "{\"a\": \"\xff\"}", "{\"a\": \"\xc3\"}", "{\"a\": \"\xe9t\xe9\"}",
+		"{\"\x80\": 1}",
+	};
+	for (const auto& text : malformed) {
+		BOOST_CHECK_THROW(json_from(text), pt::json_parser_error);
+		std::stringstream input(text);
+		BOOST_CHECK_THROW(Document::read_json(input), std::runtime_error);
+	}
+
+	// UTF-8 sequences are kept, and a byte order mark is skipped
+	const std::string valid = "\xef\xbb\xbf{\"\xc3\xa9\": [\"\xe2\x82\xac\xf0\x9f\x98\x80\", -1.5e-3]}";
+	std::stringstream input(valid);
+	BOOST_CHECK(Document::read_json(input).to_ptree() == json_from(valid));
+}
+
+BOOST_AUTO_TEST_CASE(long_numbers)
+{
+	// Numbers with many digits are rounded correctly, the digits past the ones that matter only count when nonzero
+	const auto zeros = std::string(800, '0');
+	const std::vector<std::pair<std::string, double>> numbers = {
+		{"1" + zeros + "e-800", 1.0},
+		{"-0." + zeros + "1e801", -1.0},
+		{"9007199254740993", 9007199254740992.0},
+		{"9007199254740993." + zeros, 9007199254740992.0},
+		{"9007199254740993." + zeros + "1", 9007199254740994.0},
+		{"0." + zeros + "e99999999999999999999", 0.0},
+		{"1e-99999999999999999999", 0.0},
+	};
+
+	Document doc;
+	for (const auto& number : numbers) {
+		auto node = doc.root().push_back("");
+		node.put_number(number.first);
+		BOOST_CHECK_EQUAL(*node.get_value_optional<double>(), number.second);
+		node.put_value(number.first);
+		BOOST_CHECK_EQUAL(*node.get_value_optional<double>(), number.second);
+	}
+	auto overflow = doc.root().push_back("");
+	overflow.put_number("1" + zeros);
+	BOOST_CHECK(not overflow.get_value_optional<double>());
+}
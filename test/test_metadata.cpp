@@ -1,8 +1,11 @@
 #define BOOST_TEST_MODULE RVN_JSONRESOURCE_METADATA
 #include <boost/test/unit_test.hpp>
 
+#include <cstring>
 #include <sstream>
 #include <fstream>
+#include <thread>
+#include <vector>
 
 #include "dummy.h"
 #include "common.h"
@@ -163,3 +166,286 @@ BOOST_AUTO_TEST_CASE(deserialize_incomplete_metadata)
 {
 	test_incomplete_metadata();
 }
+
+BOOST_AUTO_TEST_CASE(serialize_metadata_first)
+{
+	auto json = json_from("{\"a\": \"0\", \"b\": {\"c\": \"1\"}}");
+	std::stringstream stream;
+	TestMDWriter::dummy_md().serialize(json, stream);
+
+	BOOST_CHECK_EQUAL(json.begin()->first, "metadata");
+	BOOST_CHECK_EQUAL(stream.str().find("\"metadata\""), stream.str().find('"'));
+}
+
+BOOST_AUTO_TEST_CASE(peek)
+{
+	auto json = json_from("{\"a\": [\"0\", {\"b\": \"\\\"}\"}], \"c\": {}}");
+	std::stringstream stream;
+	const auto md = TestMDWriter::dummy_md();
+	md.serialize(json, stream);
+
+	BOOST_CHECK_EQUAL(MD::peek(stream), md);
+
+	// Metadata stored after other values
+	std::stringstream late_stream(std::string("{\"a\": [1, true, null, {\"b\": \"\\\"}\"}], \"c\": {},")
+	                              + std::string(metadata_json).substr(1));
+	BOOST_CHECK_EQUAL(MD::peek(late_stream), md);
+}
+
+BOOST_AUTO_TEST_CASE(peek_stops_after_metadata)
+{
+	std::stringstream stream(std::string(metadata_json).substr(0, std::string(metadata_json).size() - 1)
+	                         + ", \"truncated\": [");
+
+	BOOST_CHECK_THROW(MD::deserialize(stream), reven::jsonresource::ReadMetadataError);
+	BOOST_CHECK_EQUAL(MD::peek(stream), TestMDWriter::dummy_md());
+}
+
+BOOST_AUTO_TEST_CASE(peek_errors)
+{
+	std::stringstream no_metadata(valid_json);
+	BOOST_CHECK_THROW(MD::peek(no_metadata), reven::jsonresource::MissingMetadata);
+
+	std::stringstream incompatible(incompatible_metadata_version_json);
+	BOOST_CHECK_THROW(MD::peek(incompatible), reven::jsonresource::IncompatibleMetadataVersion);
+
+	std::stringstream malformed("{\"a\": [}");
+	BOOST_CHECK_THROW(MD::peek(malformed), reven::jsonresource::ReadMetadataError);
+}
+
+BOOST_AUTO_TEST_CASE(output_format)
+{
+	const auto md = TestMDWriter::dummy_md();
+
+	std::stringstream pretty;
+	pretty << md;
+	BOOST_CHECK_EQUAL(pretty.str().find("\n        \"metadata_version\""), pretty.str().find('\n', 2));
+
+	reven::jsonresource::OutputFormat format;
+	format.compact = true;
+	std::stringstream compact;
+	compact << reven::jsonresource::set_format(format) << md;
+	BOOST_CHECK_EQUAL(compact.str().find('\n'), compact.str().size() - 1);
+	BOOST_CHECK_EQUAL(compact.str().find("\": "), std::string::npos);
+	BOOST_CHECK_LT(compact.str().size(), pretty.str().size());
+	BOOST_CHECK_EQUAL(MD::deserialize(compact), md);
+
+	format.compact = false;
+	format.indent = 1;
+	format.metadata_padding = 3;
+	std::stringstream indented;
+	indented << reven::jsonresource::set_format(format) << md;
+	BOOST_CHECK_EQUAL(indented.str().substr(0, 16), "{\n \"metadata\": {");
+	BOOST_CHECK_EQUAL(indented.str().substr(indented.str().size() - 9), "\n }   \n}\n");
+	BOOST_CHECK_EQUAL(MD::deserialize(indented), md);
+
+	// Serializing with the default format gives the same output as pt::write_json, except for the numbers of the
+	// metadata that are not quoted
+	auto json = json_from("{\"a\": [\"0\", {\"b\": \"1\"}]}");
+	std::stringstream serialized;
+	md.serialize(json, serialized);
+	std::stringstream written;
+	pt::write_json(written, json);
+	auto expected = written.str();
+	for (const auto& number : {"\"metadata_version\": \"", "\"type\": \"", "\"generation_date\": \""}) {
+		const auto position = expected.find(number) + std::strlen(number) - 1;
+		expected.erase(position, 1);
+		expected.erase(expected.find('"', position), 1);
+	}
+	BOOST_CHECK_EQUAL(serialized.str(), expected);
+}
+
+BOOST_AUTO_TEST_CASE(deserialize_non_seekable)
+{
+	{
+		PipeBuffer pipe(std::string("garbage") + metadata_json);
+		std::istream stream(&pipe);
+		stream.ignore(7);
+		BOOST_CHECK_EQUAL(MD::deserialize(stream, false), TestMDWriter::dummy_md());
+	}
+	{
+		PipeBuffer pipe(std::string("garbage") + metadata_json);
+		std::istream stream(&pipe);
+		stream.ignore(7);
+		BOOST_CHECK_EQUAL(MD::peek(stream, false), TestMDWriter::dummy_md());
+	}
+	{
+		PipeBuffer pipe("{\"metadata\": ");
+		std::istream stream(&pipe);
+		BOOST_CHECK_THROW(MD::deserialize(stream, false), reven::jsonresource::ReadMetadataError);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(try_deserialize)
+{
+	using reven::jsonresource::ErrorCode;
+
+	{
+		std::istringstream input(metadata_json);
+		auto md = MD::try_deserialize(input);
+		BOOST_REQUIRE(md);
+		BOOST_CHECK(md.error().code() == ErrorCode::none);
+		BOOST_CHECK_EQUAL(*md, TestMDWriter::dummy_md());
+	}
+
+	// The errors match the exceptions of the throwing API
+	const std::pair<const char*, ErrorCode> invalid[] = {
+		{"{", ErrorCode::read_metadata_error},
+		{no_metadata_json, ErrorCode::missing_metadata},
+		{no_metadata_version_json, ErrorCode::missing_metadata_version},
+		{incompatible_metadata_version_json, ErrorCode::incompatible_metadata_version},
+		{incomplete_metadata_json, ErrorCode::missing_metadata_field},
+		{bad_metadata_field_json, ErrorCode::bad_metadata_field},
+	};
+	for (const auto& test : invalid) {
+		std::istringstream input(test.first);
+		auto md = MD::try_deserialize(input);
+		BOOST_REQUIRE(not md);
+		BOOST_CHECK(md.error().code() == test.second);
+
+		std::string expected;
+		try {
+			std::istringstream input(test.first);
+			MD::deserialize(input);
+		} catch (const reven::jsonresource::ReadMetadataError& e) {
+			expected = e.what();
+		}
+		BOOST_CHECK_EQUAL(md.error().message(), expected);
+		BOOST_CHECK_THROW(md.value(), reven::jsonresource::ReadMetadataError);
+
+		std::istringstream peek_input(test.first);
+		BOOST_CHECK(MD::try_peek(peek_input).error().code() == test.second);
+	}
+
+	BOOST_CHECK_THROW(MD::try_read_metadata(json_from(incomplete_metadata_json)).value(),
+	                  reven::jsonresource::MissingMetadataField);
+}
+
+BOOST_AUTO_TEST_CASE(interned_values)
+{
+	const auto md = TestMDWriter::dummy_md();
+
+	// Equal metadata share their strings, whether they are built or read
+	std::stringstream stream;
+	stream << md;
+	const auto md2 = MD::deserialize(stream);
+	BOOST_CHECK_EQUAL(&md.tool_name(), &md2.tool_name());
+	BOOST_CHECK_EQUAL(&md.tool_info(), &md2.tool_info());
+	BOOST_CHECK_EQUAL(md, md2);
+	BOOST_CHECK(not (md == TestMDWriter::dummy_md2()));
+
+	// The order of insertion of the custom metadata does not matter
+	reven::jsonresource::CustomMetadata first;
+	first.emplace("a", "1");
+	first.emplace("b", "2");
+	reven::jsonresource::CustomMetadata second;
+	second.emplace("b", "2");
+	second.emplace("a", "1");
+	const auto custom = TestMDWriter::custom_md(first);
+	BOOST_CHECK_EQUAL(&custom.custom_metadata(), &TestMDWriter::custom_md(second).custom_metadata());
+	BOOST_CHECK(not (custom == TestMDWriter::custom_md({{"a", "1"}})));
+	BOOST_CHECK_EQUAL(custom.custom_metadata().at("b"), "2");
+
+	// Empty values are not pooled
+	BOOST_CHECK(TestMDWriter::custom_md({}) == md);
+	BOOST_CHECK(TestMDWriter::custom_md({}).custom_metadata().empty());
+}
+
+BOOST_AUTO_TEST_CASE(interned_values_concurrently)
+{
+	// Threads intern and release the same values, each value keeps a single live instance
+	std::vector<std::vector<MD>> kept(4);
+	std::vector<std::thread> threads;
+	for (auto& values : kept) {
+		threads.emplace_back([&values]() {
+			for (int i = 0; i < 20000; ++i) {
+				const auto md = TestMDWriter::custom_md({{"key", std::to_string(i % 64)}});
+				if (i >= 20000 - 64) {
+					values.push_back(md);
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	for (const auto& values : kept) {
+		BOOST_REQUIRE_EQUAL(values.size(), 64);
+		for (std::size_t i = 0; i < values.size(); ++i) {
+			BOOST_CHECK_EQUAL(&values[i].custom_metadata(), &kept[0][i].custom_metadata());
+			BOOST_CHECK(values[i] == kept[0][i]);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(custom_metadata_order)
+{
+	using reven::jsonresource::CustomMetadata;
+
+	CustomMetadata custom({{"b", "2"}, {"c", "3"}, {"a", "1"}, {"b", "repeated"}});
+	BOOST_CHECK_EQUAL(custom.size(), 3u);
+	BOOST_CHECK_EQUAL(custom.begin()->first, "a");
+	BOOST_CHECK_EQUAL(custom.at(boost::string_view("b")), "2");
+	BOOST_CHECK(custom.find("d") == custom.end());
+	BOOST_CHECK_THROW(custom.at("d"), std::out_of_range);
+
+	BOOST_CHECK(not custom.emplace("a", "other").second);
+	const auto inserted = custom.emplace("aa", "4");
+	BOOST_CHECK(inserted.second);
+	BOOST_CHECK_EQUAL((inserted.first + 1)->first, "b");
+
+	// The interface of maps is kept: values are modified in place, and inserted by operator[] or insert
+	auto edited = custom;
+	edited["d"] = "5";
+	edited["c"] += "3";
+	BOOST_CHECK(not edited.insert({"d", "other"}).second);
+	BOOST_CHECK(edited.insert({"e", "6"}).second);
+	for (auto& entry : edited) {
+		entry.second += "!";
+	}
+	edited.at("e") = "7";
+	BOOST_CHECK(edited == CustomMetadata({{"a", "1!"}, {"aa", "4!"}, {"b", "2!"}, {"c", "33!"}, {"d", "5!"},
+	                                      {"e", "7"}}));
+
+	// The serialization does not depend on the order of insertion
+	CustomMetadata reversed;
+	for (auto it = custom.end(); it != custom.begin(); --it) {
+		reversed.emplace((it - 1)->first, (it - 1)->second);
+	}
+	std::ostringstream first;
+	first << TestMDWriter::custom_md(custom);
+	std::ostringstream second;
+	second << TestMDWriter::custom_md(reversed);
+	BOOST_CHECK_EQUAL(first.str(), second.str());
+	BOOST_CHECK_LT(first.str().find("\"a\""), first.str().find("\"aa\""));
+	BOOST_CHECK_LT(first.str().find("\"b\""), first.str().find("\"c\""));
+
+	std::istringstream input(first.str());
+	BOOST_CHECK_EQUAL(MD::deserialize(input).custom_metadata().at("aa"), "4");
+}
+
+BOOST_AUTO_TEST_CASE(number_fields)
+{
+	const auto md = TestMDWriter::dummy_md();
+
+	std::stringstream stream;
+	stream << md;
+	BOOST_CHECK_NE(stream.str().find("\"type\": 42,"), std::string::npos);
+	BOOST_CHECK_NE(stream.str().find("\"generation_date\": 42424242\n"), std::string::npos);
+	BOOST_CHECK_NE(stream.str().find("\"tool_version\": \"1.0.0\""), std::string::npos);
+	BOOST_CHECK_EQUAL(MD::deserialize(stream), md);
+
+	// Numbers quoted by earlier versions are still read
+	std::istringstream quoted(metadata_json);
+	BOOST_CHECK_EQUAL(MD::deserialize(quoted), md);
+
+	// Numbers that don't fit the field are rejected
+	auto json = json_from(metadata_json);
+	json.put("metadata.type", "4294967296");
+	BOOST_CHECK_THROW(MD::read_metadata(json), reven::jsonresource::BadMetadataField);
+	json.put("metadata.type", "-1");
+	BOOST_CHECK_THROW(MD::read_metadata(json), reven::jsonresource::BadMetadataField);
+	json.put("metadata.type", " 42 ");
+	BOOST_CHECK_EQUAL(MD::read_metadata(json), md);
+}
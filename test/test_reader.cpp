@@ -1,12 +1,19 @@
 #define BOOST_TEST_MODULE RVN_JSONRESOURCE_READER
 #include <boost/test/unit_test.hpp>
 
+#include <cstring>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "common.h"
+#include "document.h"
 #include "metadata.h"
 #include "reader.h"
+#include "writer.h"
 #include "dummy.h"
 
 using MD = reven::jsonresource::Metadata;
@@ -66,3 +73,582 @@ BOOST_AUTO_TEST_CASE(bad_metadata_field)
 
 	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str()), reven::jsonresource::BadMetadataField);
 }
+
+BOOST_AUTO_TEST_CASE(peek_metadata)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, metadata_json);
+
+	BOOST_CHECK_EQUAL(Reader::peek_metadata(tmp_file.c_str()), TestMDWriter::dummy_md());
+	BOOST_CHECK_THROW(Reader::peek_metadata((tmp_dir.path / "bar.json").generic_string().c_str()),
+	                  reven::jsonresource::ReaderError);
+}
+
+BOOST_AUTO_TEST_CASE(memory_map)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, metadata_json);
+
+	{
+		const auto reader = Reader::open(tmp_file.c_str(), reven::jsonresource::ReaderOptions{true});
+		BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+		BOOST_CHECK(reader.json() == Reader::open(tmp_file.c_str()).json());
+
+		const auto copy = reader;
+		BOOST_CHECK_EQUAL(copy.raw(), metadata_json);
+	}
+
+	BOOST_CHECK(Reader::open(tmp_file.c_str()).raw().empty());
+}
+
+BOOST_AUTO_TEST_CASE(binary_encoding)
+{
+	transient_directory tmp_dir{};
+	const auto json_file = (tmp_dir.path / "foo.json").generic_string();
+	const auto binary_file = (tmp_dir.path / "foo.cbor").generic_string();
+
+	pt::ptree json;
+	json.put("numbers.positive", "18446744073709551615");
+	json.put("numbers.negative", "-9223372036854775808");
+	json.put("numbers.zero", "0");
+	for (const char* text : {"007", "-0", "1.5", "1e3", "", "true", "null", "caf\xc3\xa9 \"/\\\n"}) {
+		json.add_child("texts", pt::ptree()).push_back(pt::ptree::value_type("", pt::ptree(text)));
+	}
+	auto& array = json.add_child("array", pt::ptree());
+	for (int i = -300; i < 70000; i += 7) {
+		array.push_back(pt::ptree::value_type("", pt::ptree(std::to_string(i))));
+	}
+	json.add_child("empty", pt::ptree());
+
+	reven::jsonresource::WriterOptions options;
+	options.encoding = reven::jsonresource::ResourceEncoding::cbor;
+	{
+		std::ofstream stream(json_file);
+		pt::write_json(stream, json);
+	}
+	{
+		std::ofstream stream(binary_file);
+		pt::write_json(stream, json);
+	}
+	reven::jsonresource::Writer::create(json_file.c_str(), TestMDWriter::dummy_md());
+	reven::jsonresource::Writer::create(binary_file.c_str(), TestMDWriter::dummy_md(), options);
+
+	BOOST_CHECK_LT(boost::filesystem::file_size(binary_file), boost::filesystem::file_size(json_file) / 2);
+
+	const auto expected = Reader::open(json_file.c_str());
+	for (const bool memory_map : {false, true}) {
+		const auto reader = Reader::open(binary_file.c_str(), reven::jsonresource::ReaderOptions{memory_map});
+		BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+		BOOST_CHECK(reader.json() == expected.json());
+		BOOST_CHECK_EQUAL(reader.json().front().first, "metadata");
+	}
+
+	BOOST_CHECK_EQUAL(Reader::peek_metadata(binary_file.c_str()), TestMDWriter::dummy_md());
+	std::ifstream stream(binary_file);
+	BOOST_CHECK_EQUAL(MD::deserialize(stream), TestMDWriter::dummy_md());
+
+	// Editing keeps the content
+	{
+		auto writer = reven::jsonresource::Writer::open(binary_file.c_str(), options);
+		writer.set_metadata(TestMDWriter::dummy_md2());
+	}
+	BOOST_CHECK_EQUAL(Reader::peek_metadata(binary_file.c_str()), TestMDWriter::dummy_md2());
+	BOOST_CHECK(Reader::open(binary_file.c_str()).json().get_child("array") == json.get_child("array"));
+}
+
+BOOST_AUTO_TEST_CASE(binary_encoding_errors)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.cbor").generic_string();
+
+	std::stringstream stream;
+	reven::jsonresource::WriterOptions options;
+	options.encoding = reven::jsonresource::ResourceEncoding::cbor;
+	{
+		auto writer = reven::jsonresource::Writer::create(pt::ptree(), std::make_unique<std::stringstream>(),
+		                                                  TestMDWriter::dummy_md(), options);
+		stream.str(static_cast<std::stringstream&>(*writer.output_stream()).str());
+	}
+	const auto binary = stream.str();
+
+	for (const auto& text : {binary.substr(0, binary.size() - 1), binary + "x", binary.substr(0, 3),
+	                         binary.substr(0, 3) + "\x81\x01", binary.substr(0, 3) + "\xa1\x01\x01"}) {
+		init_json_file(tmp_file, text);
+		BOOST_CHECK_THROW(Reader::open(tmp_file.c_str()), reven::jsonresource::ReaderError);
+		BOOST_CHECK_THROW(Reader::open(tmp_file.c_str(), reven::jsonresource::ReaderOptions{true}),
+		                  reven::jsonresource::ReaderError);
+	}
+
+	// A map without metadata
+	init_json_file(tmp_file, binary.substr(0, 3) + "\xa0");
+	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str()), reven::jsonresource::MissingMetadata);
+	BOOST_CHECK_THROW(Reader::peek_metadata(tmp_file.c_str()), reven::jsonresource::MissingMetadata);
+
+	// Members before the metadata are skipped: {"data": [255, -2, "x", {"k": true}, 1.5, null], "metadata": ...}
+	const auto data = std::string("\xa2\x64" "data" "\x86\x18\xff\x21\x61x\xa1\x61k\xf5\xfb\x3f\xf8", 19)
+	                  + std::string(6, '\0') + "\xf6";
+	init_json_file(tmp_file, binary.substr(0, 3) + data + binary.substr(4));
+	BOOST_CHECK_EQUAL(Reader::peek_metadata(tmp_file.c_str()), TestMDWriter::dummy_md());
+	BOOST_CHECK_EQUAL(Reader::open(tmp_file.c_str()).metadata(), TestMDWriter::dummy_md());
+	for (const auto& member : {std::string("\xa2\x64" "data" "\x82\x01"), std::string("\xa2\x64" "data" "\xc0\x01"),
+	                           std::string("\xa2\x64" "data" "\x9b\xff\xff\xff\xff\xff\xff\xff\xff")}) {
+		init_json_file(tmp_file, binary.substr(0, 3) + member);
+		BOOST_CHECK_THROW(Reader::peek_metadata(tmp_file.c_str()), reven::jsonresource::ReadMetadataError);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(peek_compressed)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json.gz").generic_string();
+
+	pt::ptree json;
+	auto& array = json.add_child("array", pt::ptree());
+	std::uint64_t state = 42;
+	for (int i = 0; i < 100000; ++i) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		array.push_back(pt::ptree::value_type("", pt::ptree(std::to_string(state))));
+	}
+	{
+		std::ofstream stream(tmp_file);
+		pt::write_json(stream, json);
+	}
+
+	reven::jsonresource::WriterOptions options;
+	options.compression = reven::jsonresource::Compression::gzip;
+	reven::jsonresource::Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md(), options);
+
+	std::stringstream compressed;
+	compressed << std::ifstream(tmp_file).rdbuf();
+	const auto size = compressed.str().size();
+
+	// Only the beginning of the resource is decompressed
+	BOOST_CHECK_EQUAL(MD::peek(compressed), TestMDWriter::dummy_md());
+	BOOST_CHECK_LT(static_cast<std::size_t>(compressed.tellg()), size / 10);
+
+	BOOST_CHECK_EQUAL(MD::deserialize(compressed), TestMDWriter::dummy_md());
+	BOOST_CHECK(Reader::open(compressed).json().get_child("array") == json.get_child("array"));
+
+	// Corrupted compressed data
+	init_json_file(tmp_file, compressed.str().substr(0, size / 2));
+	BOOST_CHECK_EQUAL(Reader::peek_metadata(tmp_file.c_str()), TestMDWriter::dummy_md());
+	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str()), reven::jsonresource::ReaderError);
+}
+
+BOOST_AUTO_TEST_CASE(non_seekable)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+
+	reven::jsonresource::ReaderOptions options;
+	options.rewind = false;
+
+	{
+		PipeBuffer pipe(std::string("header\n") + metadata_json);
+		std::istream stream(&pipe);
+		std::string header;
+		std::getline(stream, header);
+
+		const auto reader = Reader::open(stream, options);
+		BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+		BOOST_CHECK_EQUAL(reader.json().size(), 1);
+	}
+
+	// Compressed and binary resources
+	using reven::jsonresource::Compression;
+	using reven::jsonresource::ResourceEncoding;
+	for (const auto compression : {Compression::none, Compression::gzip, Compression::bzip2}) {
+		for (const auto encoding : {ResourceEncoding::json, ResourceEncoding::cbor}) {
+			init_json_file(tmp_file, "{\"toto\": [\"0\", \"1\"]}");
+			reven::jsonresource::WriterOptions writer_options;
+			writer_options.compression = compression;
+			writer_options.encoding = encoding;
+			reven::jsonresource::Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md(), writer_options);
+
+			std::stringstream content;
+			content << std::ifstream(tmp_file).rdbuf();
+
+			PipeBuffer pipe(content.str());
+			std::istream stream(&pipe);
+			const auto reader = Reader::open(stream, options);
+			BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+			BOOST_CHECK_EQUAL(reader.json().get_child("toto").size(), 2);
+
+			PipeBuffer peek_pipe(content.str());
+			std::istream peek_stream(&peek_pipe);
+			BOOST_CHECK_EQUAL(MD::peek(peek_stream, false), TestMDWriter::dummy_md());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(memory_map_errors)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	const reven::jsonresource::ReaderOptions options{true};
+
+	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str(), options), reven::jsonresource::ReaderError);
+
+	init_json_file(tmp_file, "");
+	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str(), options), reven::jsonresource::ReaderError);
+
+	init_json_file(tmp_file, "{\"metadata\": ");
+	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str(), options), reven::jsonresource::ReaderError);
+
+	init_json_file(tmp_file, incomplete_metadata_json);
+	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str(), options), reven::jsonresource::MissingMetadataField);
+}
+
+namespace {
+
+std::string write_indexed_resource(const transient_directory& tmp_dir)
+{
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, "{\"toto\": \"0\", \"array\": [\"a\", \"b\", {\"c\": \"d\"}, \"e\", \"f\"], \"titi\": {\"x\": \"1\"}}");
+
+	reven::jsonresource::WriterOptions options;
+	options.write_index = true;
+	options.index_array_chunk = 2;
+	reven::jsonresource::Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md(), options);
+	return tmp_file;
+}
+
+//! Replace a part of the file without changing its size and modification time
+void corrupt_file(const std::string& filename, const std::string& pattern, const std::string& replacement)
+{
+	struct stat st;
+	BOOST_REQUIRE(::stat(filename.c_str(), &st) == 0);
+
+	std::stringstream content;
+	content << std::ifstream(filename).rdbuf();
+	auto text = content.str();
+	text.replace(text.find(pattern), pattern.size(), replacement);
+	init_json_file(filename, text);
+
+	const struct timespec times[2] = {st.st_atim, st.st_mtim};
+	BOOST_REQUIRE(::utimensat(AT_FDCWD, filename.c_str(), times, 0) == 0);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(open_section)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = write_indexed_resource(tmp_dir);
+	BOOST_CHECK(boost::filesystem::exists(tmp_file + ".idx"));
+
+	const auto reader = Reader::open_section(tmp_file.c_str(), "titi");
+	BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+	BOOST_CHECK_EQUAL(reader.json().size(), 2);
+	BOOST_CHECK_EQUAL(reader.json().get<std::string>("titi.x"), "1");
+
+	BOOST_CHECK_EQUAL(Reader::open_section(tmp_file.c_str(), "missing").json().size(), 1);
+
+	// Only the requested section is parsed when the index is up-to-date
+	corrupt_file(tmp_file, "\"0\"", "[[[");
+	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str()), reven::jsonresource::ReaderError);
+	BOOST_CHECK_EQUAL(Reader::open_section(tmp_file.c_str(), "titi").json().get<std::string>("titi.x"), "1");
+}
+
+BOOST_AUTO_TEST_CASE(open_elements)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = write_indexed_resource(tmp_dir);
+
+	auto elements = [&tmp_file](std::uint64_t first, std::uint64_t count) {
+		std::string result;
+		const auto reader = Reader::open_elements(tmp_file.c_str(), "array", first, count);
+		BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+		for (const auto& element : reader.json().get_child("array")) {
+			result += element.second.empty() ? element.second.data() : element.second.get<std::string>("c");
+		}
+		return result;
+	};
+
+	BOOST_CHECK_EQUAL(elements(0, 10), "abdef");
+	BOOST_CHECK_EQUAL(elements(1, 2), "bd");
+	BOOST_CHECK_EQUAL(elements(3, 1), "e");
+	BOOST_CHECK_EQUAL(elements(4, 10), "f");
+	BOOST_CHECK_EQUAL(elements(5, 10), "");
+
+	// The keys are checked, a resource edited without changing its size and modification time is fully parsed
+	corrupt_file(tmp_file, "\"array\"", "\"arrax\"");
+	BOOST_CHECK(not Reader::open_elements(tmp_file.c_str(), "array", 0, 10).json().get_child_optional("array"));
+	BOOST_CHECK(not Reader::open_section(tmp_file.c_str(), "array").json().get_child_optional("array"));
+	corrupt_file(tmp_file, "\"arrax\"", "\"array\"");
+	BOOST_CHECK_EQUAL(elements(1, 2), "bd");
+
+	// A stale index is ignored
+	init_json_file(tmp_file, std::string("{\"array\": [\"z\", \"y\"],") + std::string(metadata_json).substr(1));
+	BOOST_CHECK_EQUAL(elements(0, 10), "zy");
+	BOOST_CHECK_EQUAL(Reader::open_section(tmp_file.c_str(), "array").json().get_child("array").size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(open_many)
+{
+	transient_directory tmp_dir{};
+	std::vector<std::string> paths;
+	for (int i = 0; i < 20; ++i) {
+		paths.push_back((tmp_dir.path / ("foo" + std::to_string(i) + ".json")).generic_string());
+		init_json_file(paths.back(), i % 5 == 1 ? no_metadata_json : i % 5 == 2 ? "{" : metadata_json);
+	}
+	paths.push_back((tmp_dir.path / "missing.json").generic_string());
+
+	reven::jsonresource::OpenManyOptions options;
+	options.threads = 4;
+	auto results = Reader::open_many(paths, options);
+	BOOST_REQUIRE_EQUAL(results.size(), paths.size());
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		auto& result = results[i];
+		BOOST_CHECK_EQUAL(result.index, i);
+		BOOST_CHECK_EQUAL(result.path, paths[i]);
+		if (i == paths.size() - 1 or i % 5 == 2) {
+			BOOST_CHECK(not result.ok());
+			BOOST_CHECK_THROW(result.get(), reven::jsonresource::ReaderError);
+		} else if (i % 5 == 1) {
+			BOOST_CHECK(not result.ok());
+			BOOST_CHECK_THROW(result.get(), reven::jsonresource::MissingMetadata);
+		} else {
+			BOOST_REQUIRE(result.ok());
+			BOOST_CHECK_EQUAL(result.get().metadata(), TestMDWriter::dummy_md());
+		}
+	}
+
+	// In completion order, every resource is still returned once
+	options.keep_order = false;
+	options.reader.memory_map = true;
+	results = Reader::open_many(paths, options);
+	BOOST_REQUIRE_EQUAL(results.size(), paths.size());
+	std::vector<bool> seen(paths.size(), false);
+	for (const auto& result : results) {
+		BOOST_REQUIRE_LT(result.index, paths.size());
+		BOOST_CHECK(not seen[result.index]);
+		seen[result.index] = true;
+		BOOST_CHECK_EQUAL(result.path, paths[result.index]);
+		BOOST_CHECK_EQUAL(result.ok(), result.index % 5 != 1 and result.index % 5 != 2 and result.index != 20);
+	}
+
+	BOOST_CHECK(Reader::open_many({}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(try_open)
+{
+	using reven::jsonresource::ErrorCode;
+
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+
+	for (const bool memory_map : {false, true}) {
+		reven::jsonresource::ReaderOptions options;
+		options.memory_map = memory_map;
+
+		init_json_file(tmp_file, metadata_json);
+		auto reader = Reader::try_open(tmp_file.c_str(), options);
+		BOOST_REQUIRE(reader);
+		BOOST_CHECK_EQUAL(reader->metadata(), TestMDWriter::dummy_md());
+
+		init_json_file(tmp_file, incompatible_metadata_version_json);
+		reader = Reader::try_open(tmp_file.c_str(), options);
+		BOOST_REQUIRE(not reader);
+		BOOST_CHECK(reader.error().code() == ErrorCode::incompatible_metadata_version);
+		BOOST_CHECK_EQUAL(reader.error().message(),
+		                  "Can't read a metadata with metadata version bigger than the current (3 > 2)");
+		BOOST_CHECK_THROW(reader.value(), reven::jsonresource::IncompatibleMetadataVersion);
+
+		init_json_file(tmp_file, "{");
+		reader = Reader::try_open(tmp_file.c_str(), options);
+		BOOST_CHECK(reader.error().code() == ErrorCode::read_error);
+		BOOST_CHECK_THROW(reader.value(), reven::jsonresource::ReaderError);
+	}
+
+	std::istringstream input(no_metadata_json);
+	BOOST_CHECK(Reader::try_open(input).error().code() == ErrorCode::missing_metadata);
+}
+
+BOOST_AUTO_TEST_CASE(query)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+
+	using reven::jsonresource::Compression;
+	for (const auto compression : {Compression::none, Compression::gzip}) {
+		init_json_file(tmp_file, "{\"a\": {\"b\": [\"10\", {\"c\": \"x\"}], \"b\": \"repeated\"}, \"m~n/o\": \"2\", "
+		                         "\"\": \"empty\", \"n\": 3.5}");
+		reven::jsonresource::WriterOptions writer_options;
+		writer_options.compression = compression;
+		reven::jsonresource::Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md(), writer_options);
+
+		const auto result = Reader::query_many(tmp_file.c_str(), {"/a/b/0", "/a/b/1/c", "/m~0n~1o", "/", "/n", "/a/b",
+		                                                          "/a/b/2", "/a/b/01", "/z", "/a/b/0/c", ""});
+		BOOST_CHECK_EQUAL(result.metadata(), TestMDWriter::dummy_md());
+		BOOST_REQUIRE_EQUAL(result.size(), 11);
+		BOOST_CHECK_EQUAL(result.get<int>(0), 10);
+		BOOST_CHECK_EQUAL(result.get<std::string>(1), "x");
+		BOOST_CHECK_EQUAL(result.get<int>(2), 2);
+		BOOST_CHECK_EQUAL(result.get<std::string>(3), "empty");
+		BOOST_CHECK_EQUAL(result.get<double>(4), 3.5);
+		BOOST_CHECK_EQUAL(result.value(5).size(), 2);
+		for (std::size_t i = 6; i < 10; ++i) {
+			BOOST_CHECK(not result.found(i));
+			BOOST_CHECK(not result.get_optional<int>(i));
+			BOOST_CHECK_THROW(result.value(i), reven::jsonresource::ReaderError);
+		}
+		BOOST_CHECK(result.value(10).get_child_optional("metadata"));
+		BOOST_CHECK(not result.get_optional<int>(1));
+
+		const auto single = Reader::query(tmp_file.c_str(), "/a/b/1");
+		BOOST_CHECK_EQUAL(single.value(0).get<std::string>("c"), "x");
+	}
+
+	BOOST_CHECK_THROW(Reader::query(tmp_file.c_str(), "a"), reven::jsonresource::ReaderError);
+	BOOST_CHECK_THROW(Reader::query(tmp_file.c_str(), "/~2"), reven::jsonresource::ReaderError);
+	BOOST_CHECK_THROW(Reader::query((tmp_dir.path / "bar.json").generic_string().c_str(), "/a"),
+	                  reven::jsonresource::ReaderError);
+
+	// The metadata are validated
+	init_json_file(tmp_file, no_metadata_json);
+	BOOST_CHECK_THROW(Reader::query(tmp_file.c_str(), "/a"), reven::jsonresource::MissingMetadata);
+	init_json_file(tmp_file, incomplete_metadata_json);
+	BOOST_CHECK_THROW(Reader::query(tmp_file.c_str(), "/a"), reven::jsonresource::MissingMetadataField);
+	init_json_file(tmp_file, "{\"a\": [1, }");
+	BOOST_CHECK_THROW(Reader::query(tmp_file.c_str(), "/a"), reven::jsonresource::ReaderError);
+
+	// The scan stops once the values are read
+	init_json_file(tmp_file, std::string(metadata_json).substr(0, std::strlen(metadata_json) - 1) +
+	                         ", \"a\": \"1\", \"b\": [");
+	BOOST_CHECK_EQUAL(Reader::query(tmp_file.c_str(), "/a").get<int>(0), 1);
+}
+
+namespace {
+
+//! Check that the Json parser of Reader, at each Simd level, builds the same tree as `pt::read_json` or fails like
+//! it. The scanner of documents must do the same.
+void check_conformance(const std::string& text)
+{
+	pt::ptree expected;
+	bool valid = true;
+	try {
+		std::istringstream input(text);
+		pt::read_json(input, expected);
+	} catch (const pt::json_parser_error&) {
+		valid = false;
+	}
+
+	using reven::jsonresource::SimdLevel;
+	for (const auto level : {SimdLevel::automatic, SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2}) {
+		reven::jsonresource::ReaderOptions options;
+		options.simd = level;
+		std::istringstream input(text);
+		if (valid) {
+			BOOST_CHECK_MESSAGE(Reader::open(input, options).json() == expected, text);
+		} else {
+			BOOST_CHECK_THROW(Reader::open(input, options), reven::jsonresource::ReaderError);
+		}
+	}
+
+	// The scanner of documents decodes the strings and their escapes the same way, and rejects the same inputs
+	std::istringstream input(text);
+	if (valid) {
+		BOOST_CHECK_MESSAGE(reven::jsonresource::Document::read_json(input).to_ptree() == expected, text);
+	} else {
+		BOOST_CHECK_THROW(reven::jsonresource::Document::read_json(input), std::runtime_error);
+	}
+}
+
+//! A resource whose "value" is `value`
+std::string with_value(const std::string& value)
+{
+	const std::string resource = metadata_json;
+	return resource.substr(0, resource.rfind('}')) + ", \"value\": " + value + "}";
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(parser_conformance)
+{
+	const std::vector<std::string> values = {
+		"\"abc\"", "\"\"", "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"", "\"\\u0041\\u00e9\\u20AC\\ud83d\\ude00\"", "\"\\u0000\"",
+		"\"h\xc3\xa9llo \xe2\x82\xac \xf0\x9f\x98\x80\"", "[]", "{}", "[1, -2.5e+3, 0, -0, 1E2, 0.5e-1, true, false, null]",
+		"{\"a\": {\"b\": [{\"c\": []}]}, \"a\": \"repeated\"}", " \t\r\n [ \"x\" , { } ] \n", "{\"\": \"\"}",
+		"\"{}[],:\"", "[[[[[[[[[[\"deep\"]]]]]]]]]]", "\"\x7f\"",
+		// Malformed values
+		"", "[", "]", "{\"a\"}", "{\"a\":}", "{\"a\": 1,}", "[1,]", "[1 2]", "[1,,2]", "{,}", "[}", "{]", "{1: 2}",
+		"01", "1.", ".5", "-", "+1", "1e", "1e+", "--1", "NaN", "tru", "truee", "nul", "'a'", "[1]x", "\\\"",
+		"{\"a\" \"b\"}", "\"a\" \"b\"", "\"abc", "\"\\x\"", "\"\\u12\"", "\"\\u12G4\"", "\"\\udc00\"", "\"\\ud800\"",
+		"\"\\ud800\\u0041\"", "\"\\ud800x\"", "\"\x01\"", "\"a\tb\"", "\"\x80\"", "\"\xc3\"", "\"\xc3(\"",
+		"\"\xf8\x88\x80\x80\x80\"", "[\"\\", std::string("\"a\0b\"", 5), "[1\"a\"]",
+	};
+	for (const auto& value : values) {
+		check_conformance(with_value(value));
+	}
+	for (const auto& escape : {"\\x", "\\u12", "\\u12G4", "\\udc00", "\\ud800", "\\ud800\\u0041", "\\ud800x"}) {
+		std::istringstream input(with_value("\"" + std::string(escape) + "\""));
+		BOOST_CHECK_THROW(reven::jsonresource::Document::read_json(input), std::runtime_error);
+	}
+
+	// Strings and runs of backslashes crossing the boundaries of the blocks scanned together
+	for (std::size_t padding = 0; padding < 130; ++padding) {
+		for (const std::size_t backslashes : {0, 1, 2, 3, 4, 63, 64, 65}) {
+			const auto run = std::string(padding, 'x') + std::string(backslashes, '\\');
+			check_conformance(with_value("[\"" + run + "\"]"));
+			check_conformance(with_value("[\"" + run + "\"\"]"));
+			check_conformance(with_value("{\"" + run + "\\n\": [\"" + run + "\\\"\", \"{\\u00e9}\"]}"));
+		}
+		check_conformance(with_value("\"" + std::string(padding, 'x') + "\x1f\""));
+		check_conformance(with_value("[" + std::string(padding, ' ') + "true" + std::string(padding, ' ') + "]"));
+	}
+
+	// Large enough to be indexed in several batches
+	std::string elements;
+	for (int i = 0; i < 5000; ++i) {
+		elements += std::string(i == 0 ? "" : ",") + "{\"k\\u00e9y\": \"v\\\\\\\"al\", \"n\": -1.5e3, \"z\": [null]}";
+	}
+	check_conformance(with_value("[" + elements + "]"));
+	check_conformance(with_value("[" + elements + "]]"));
+
+	// Streams are read by chunks: strings spanning several chunks, and literals crossing them
+	const auto long_string = "\"" + std::string(200000, 'x') + "\\\\" + std::string(100000, 'y') + "\"";
+	check_conformance(with_value(long_string));
+	check_conformance(with_value("[" + long_string.substr(0, 250000)));
+	std::string numbers;
+	for (int i = 0; i < 30000; ++i) {
+		numbers += std::string(i == 0 ? "" : ",") + std::to_string(i * 7919) + ".25e-1";
+	}
+	check_conformance(with_value("[" + numbers + "]"));
+	check_conformance(with_value("[" + numbers + ",tru]"));
+	std::string strings;
+	for (int i = 0; i < 5000; ++i) {
+		strings += std::string(i == 0 ? "" : ",") + "\"" + std::string(21, 'x') + "\"";
+	}
+	for (std::size_t shift = 0; shift < 128; shift += 4) {
+		// For some shifts, a batch of positions is full at the end of the first chunk, inside a string
+		check_conformance(with_value(std::string(shift, ' ') + "[" + strings + "]"));
+	}
+
+	// The root of the document
+	const std::string resource = metadata_json;
+	check_conformance("\xef\xbb\xbf" + resource);
+	check_conformance(resource + "{}");
+	check_conformance(resource + " x");
+	check_conformance(resource + " \n\t ");
+
+	// Memory-mapped files
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	for (const auto& value : {"[" + elements + "]", std::string("\"\\ud83d\\ude00\\\\\"")}) {
+		init_json_file(tmp_file, with_value(value));
+		reven::jsonresource::ReaderOptions options;
+		const auto expected = Reader::open(tmp_file.c_str(), options).json();
+		options.memory_map = true;
+		using reven::jsonresource::SimdLevel;
+		for (const auto level : {SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2}) {
+			options.simd = level;
+			BOOST_CHECK(Reader::open(tmp_file.c_str(), options).json() == expected);
+		}
+	}
+	init_json_file(tmp_file, with_value("[\"\\u12\"]"));
+	BOOST_CHECK_THROW(Reader::open(tmp_file.c_str(), reven::jsonresource::ReaderOptions{true}),
+	                  reven::jsonresource::ReaderError);
+}
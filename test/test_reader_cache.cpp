@@ -0,0 +1,113 @@
+#define BOOST_TEST_MODULE RVN_JSONRESOURCE_READER_CACHE
+#include <boost/test/unit_test.hpp>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "metadata.h"
+#include "reader_cache.h"
+#include "writer.h"
+#include "dummy.h"
+
+using Reader = reven::jsonresource::Reader;
+using ReaderCache = reven::jsonresource::ReaderCache;
+using Writer = reven::jsonresource::Writer;
+
+namespace {
+
+void set_mtime(const std::string& filename, std::int64_t seconds)
+{
+	const struct timespec times[2] = {{seconds, 0}, {seconds, 0}};
+	BOOST_REQUIRE(::utimensat(AT_FDCWD, filename.c_str(), times, 0) == 0);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(hits_and_misses)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, metadata_json);
+	set_mtime(tmp_file, 1000);
+
+	ReaderCache cache(1024 * 1024);
+	const auto first = cache.open(tmp_file.c_str());
+	const auto second = cache.open(tmp_file.c_str());
+	BOOST_CHECK_EQUAL(first, second);
+	BOOST_CHECK_EQUAL(second->metadata(), TestMDWriter::dummy_md());
+
+	auto stats = cache.stats();
+	BOOST_CHECK_EQUAL(stats.hits, 1);
+	BOOST_CHECK_EQUAL(stats.misses, 1);
+	BOOST_CHECK_EQUAL(stats.entries, 1);
+	BOOST_CHECK_GT(stats.bytes, boost::filesystem::file_size(tmp_file));
+
+	// A change of the file invalidates the entry, even when its size is the same
+	BOOST_CHECK(Writer::patch_metadata(tmp_file.c_str(), TestMDWriter::dummy_md2()));
+	set_mtime(tmp_file, 2000);
+	const auto third = cache.open(tmp_file.c_str());
+	BOOST_CHECK_NE(first, third);
+	BOOST_CHECK_EQUAL(third->metadata(), TestMDWriter::dummy_md2());
+	BOOST_CHECK_EQUAL(first->metadata(), TestMDWriter::dummy_md());
+	BOOST_CHECK_EQUAL(cache.stats().misses, 2);
+
+	// The entry of the previous version of the file is dropped
+	BOOST_CHECK_EQUAL(cache.stats().entries, 1);
+	BOOST_CHECK_EQUAL(cache.stats().bytes, stats.bytes);
+
+	cache.clear();
+	BOOST_CHECK_EQUAL(cache.stats().entries, 0);
+	BOOST_CHECK_EQUAL(cache.stats().bytes, 0);
+	BOOST_CHECK_NE(cache.open(tmp_file.c_str()), third);
+	BOOST_CHECK_EQUAL(cache.stats().misses, 3);
+}
+
+BOOST_AUTO_TEST_CASE(eviction)
+{
+	transient_directory tmp_dir{};
+	std::vector<std::string> files;
+	for (int i = 0; i < 3; ++i) {
+		files.push_back((tmp_dir.path / ("foo" + std::to_string(i) + ".json")).generic_string());
+		init_json_file(files.back(), metadata_json);
+	}
+	ReaderCache unbounded(1024 * 1024);
+	unbounded.open(files[0].c_str());
+	const auto entry_size = unbounded.stats().bytes;
+
+	ReaderCache cache(2 * entry_size);
+	cache.open(files[0].c_str());
+	cache.open(files[1].c_str());
+	cache.open(files[0].c_str());
+
+	// files[1] is the least recently used
+	cache.open(files[2].c_str());
+	auto stats = cache.stats();
+	BOOST_CHECK_EQUAL(stats.evictions, 1);
+	BOOST_CHECK_EQUAL(stats.entries, 2);
+	BOOST_CHECK_EQUAL(stats.bytes, 2 * entry_size);
+
+	cache.open(files[0].c_str());
+	BOOST_CHECK_EQUAL(cache.stats().hits, 2);
+	cache.open(files[1].c_str());
+	BOOST_CHECK_EQUAL(cache.stats().misses, 4);
+
+	// Resources bigger than the budget are not cached
+	ReaderCache small(entry_size - 1);
+	small.open(files[0].c_str());
+	small.open(files[0].c_str());
+	BOOST_CHECK_EQUAL(small.stats().misses, 2);
+	BOOST_CHECK_EQUAL(small.stats().entries, 0);
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+
+	ReaderCache cache(1024 * 1024);
+	BOOST_CHECK_THROW(cache.open(tmp_file.c_str()), reven::jsonresource::ReaderError);
+
+	init_json_file(tmp_file, no_metadata_json);
+	BOOST_CHECK_THROW(cache.open(tmp_file.c_str()), reven::jsonresource::MissingMetadata);
+	BOOST_CHECK_EQUAL(cache.stats().entries, 0);
+}
@@ -0,0 +1,134 @@
+#define BOOST_TEST_MODULE RVN_JSONRESOURCE_STATS
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "common.h"
+#include "metadata.h"
+#include "reader.h"
+#include "stats.h"
+#include "writer.h"
+#include "dummy.h"
+
+using MD = reven::jsonresource::Metadata;
+using Operation = reven::jsonresource::Operation;
+using OperationStats = reven::jsonresource::OperationStats;
+using Reader = reven::jsonresource::Reader;
+using Writer = reven::jsonresource::Writer;
+
+namespace {
+
+std::uint64_t fake_allocations = 0;
+
+std::uint64_t count_allocations()
+{
+	// Each call is one allocation, so every measured operation reports one
+	return fake_allocations++;
+}
+
+//! Collect the statistics published to the callback for the duration of the test
+struct Collector {
+	Collector()
+	{
+		reven::jsonresource::set_stats_callback([this](const OperationStats& stats) {
+			std::lock_guard<std::mutex> lock(mutex);
+			published.push_back(stats);
+		});
+	}
+
+	~Collector()
+	{
+		reven::jsonresource::set_stats_callback(nullptr);
+	}
+
+	std::mutex mutex;
+	std::vector<OperationStats> published;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, metadata_json);
+
+	const auto reader = Reader::open(tmp_file.c_str());
+	BOOST_CHECK_EQUAL(reader.stats().bytes_read, 0);
+	BOOST_CHECK_EQUAL(reader.stats().node_count, 0);
+	BOOST_CHECK(reader.stats().parse_time == std::chrono::nanoseconds(0));
+}
+
+BOOST_AUTO_TEST_CASE(reader_and_metadata)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, metadata_json);
+	const auto size = std::string(metadata_json).size();
+
+	Collector collector;
+	reven::jsonresource::set_allocation_counter(count_allocations);
+
+	for (const bool memory_map : {false, true}) {
+		reven::jsonresource::ReaderOptions options;
+		options.memory_map = memory_map;
+		const auto reader = Reader::open(tmp_file.c_str(), options);
+		const auto& stats = reader.stats();
+		BOOST_CHECK(stats.operation == Operation::reader_open);
+		BOOST_CHECK_EQUAL(stats.bytes_read, size);
+		BOOST_CHECK_GT(stats.parse_time.count(), 0);
+		BOOST_CHECK_GT(stats.validate_time.count(), 0);
+		// The root, the metadata and its 7 fields
+		BOOST_CHECK_EQUAL(stats.node_count, 9);
+		BOOST_CHECK_EQUAL(stats.allocation_count, 1);
+	}
+
+	std::istringstream input(metadata_json);
+	MD::deserialize(input);
+
+	reven::jsonresource::set_allocation_counter(nullptr);
+
+	BOOST_REQUIRE_EQUAL(collector.published.size(), 3);
+	const auto& stats = collector.published.back();
+	BOOST_CHECK(stats.operation == Operation::metadata_deserialize);
+	BOOST_CHECK_EQUAL(stats.bytes_read, size);
+	BOOST_CHECK_EQUAL(stats.node_count, 9);
+}
+
+BOOST_AUTO_TEST_CASE(writer)
+{
+	reven::jsonresource::enable_stats(true);
+
+	auto writer = Writer::create(pt::ptree(), std::make_unique<std::stringstream>(), TestMDWriter::dummy_md());
+	const auto& output = static_cast<std::stringstream&>(*writer.output_stream()).str();
+	BOOST_CHECK(writer.stats().operation == Operation::writer_commit);
+	BOOST_CHECK_EQUAL(writer.stats().bytes_written, output.size());
+	BOOST_CHECK_GT(writer.stats().serialize_time.count(), 0);
+	BOOST_CHECK_EQUAL(writer.stats().node_count, 9);
+
+	// Asynchronous commits are reported to the callback
+	{
+		Collector collector;
+		writer.commit_async(TestMDWriter::dummy_md2()).get();
+		BOOST_REQUIRE_EQUAL(collector.published.size(), 1);
+		BOOST_CHECK(collector.published[0].operation == Operation::writer_commit);
+		BOOST_CHECK_GT(collector.published[0].bytes_written, 0);
+	}
+
+	// Resources written to a file, by streaming them or from their content
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, "{\"a\": [1, 2]}");
+	auto file_writer = Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md());
+	BOOST_CHECK_EQUAL(file_writer.stats().bytes_written, boost::filesystem::file_size(tmp_file));
+	file_writer.json().put("b", 3);
+	file_writer.set_metadata(TestMDWriter::dummy_md2());
+	BOOST_CHECK_EQUAL(file_writer.stats().bytes_written, boost::filesystem::file_size(tmp_file));
+
+	reven::jsonresource::enable_stats(false);
+	writer.set_metadata(TestMDWriter::dummy_md());
+	BOOST_CHECK_EQUAL(writer.stats().bytes_written, 0);
+}
@@ -0,0 +1,127 @@
+#define BOOST_TEST_MODULE RVN_JSONRESOURCE_STREAM_WRITER
+#include <boost/test/unit_test.hpp>
+
+#include <clocale>
+#include <sstream>
+
+#include "common.h"
+#include "metadata.h"
+#include "reader.h"
+#include "stream_writer.h"
+#include "dummy.h"
+
+using Reader = reven::jsonresource::Reader;
+using StreamWriter = reven::jsonresource::StreamWriter;
+
+BOOST_AUTO_TEST_CASE(write_read)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+
+	const auto md = TestMDWriter::dummy_md();
+	{
+		auto writer = StreamWriter::create(tmp_file.c_str(), md);
+		writer.key("string").value("a\"b");
+		writer.key("values").begin_array();
+		for (std::uint64_t i = 0; i < 1000; ++i) {
+			writer.value(i);
+		}
+		writer.end_array();
+		writer.key("object").begin_object()
+			.key("negative").value(-1)
+			.key("double").value(0.5)
+			.key("bool").value(true)
+			.key("null").null()
+			.key("empty").begin_array().end_array()
+		.end_object();
+		BOOST_CHECK(std::move(writer).finalize());
+	}
+
+	const auto reader = Reader::open(tmp_file.c_str());
+	BOOST_CHECK_EQUAL(reader.metadata(), md);
+	BOOST_CHECK_EQUAL(reader.json().begin()->first, "metadata");
+	BOOST_CHECK_EQUAL(reader.json().get<std::string>("string"), "a\"b");
+	BOOST_CHECK_EQUAL(reader.json().get_child("values").size(), 1000);
+	BOOST_CHECK_EQUAL(reader.json().get_child("values").back().second.get_value<std::uint64_t>(), 999);
+	BOOST_CHECK_EQUAL(reader.json().get<std::int64_t>("object.negative"), -1);
+	BOOST_CHECK_EQUAL(reader.json().get<double>("object.double"), 0.5);
+	BOOST_CHECK_EQUAL(reader.json().get<bool>("object.bool"), true);
+	BOOST_CHECK_EQUAL(reader.json().get<std::string>("object.null"), "null");
+	BOOST_CHECK_EQUAL(reader.json().get<std::string>("object.empty"), "");
+}
+
+BOOST_AUTO_TEST_CASE(same_output_as_ptree)
+{
+	pt::ptree json;
+	json.put("a", "0");
+	json.put("b.c", "1");
+	json.add("d.", "2");
+	json.add("d.", "3");
+
+	std::stringstream expected;
+	TestMDWriter::dummy_md().serialize(json, expected,
+	                                   reven::jsonresource::OutputFormat{reven::jsonresource::default_metadata_padding});
+
+	auto writer = StreamWriter::create(std::make_unique<std::stringstream>(), TestMDWriter::dummy_md());
+	writer.key("a").value("0");
+	writer.key("b").begin_object().key("c").value("1").end_object();
+	writer.key("d").begin_array().value("2").value("3").end_array();
+	auto stream = std::move(writer).finalize();
+
+	BOOST_CHECK_EQUAL(static_cast<std::stringstream&>(*stream).str(), expected.str());
+}
+
+BOOST_AUTO_TEST_CASE(invalid_sequences)
+{
+	using reven::jsonresource::WriterError;
+	auto create = []() {
+		return StreamWriter::create(std::make_unique<std::stringstream>(), TestMDWriter::dummy_md());
+	};
+
+	BOOST_CHECK_THROW(create().value("a"), WriterError);
+	BOOST_CHECK_THROW(create().end_object(), WriterError);
+	BOOST_CHECK_THROW(create().key("a").key("b"), WriterError);
+	BOOST_CHECK_THROW(create().key("a").begin_array().key("b"), WriterError);
+	BOOST_CHECK_THROW(create().key("a").begin_array().end_object(), WriterError);
+	BOOST_CHECK_THROW(create().key("a").begin_object().key("b").end_object(), WriterError);
+	BOOST_CHECK_THROW(create().key("a").value(std::numeric_limits<double>::infinity()), WriterError);
+
+	{
+		auto writer = create();
+		writer.key("a").begin_array();
+		BOOST_CHECK_THROW(std::move(writer).finalize(), WriterError);
+	}
+	{
+		auto writer = create();
+		BOOST_CHECK_NO_THROW(std::move(writer).finalize());
+		BOOST_CHECK_THROW(writer.key("a"), WriterError);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(number_format)
+{
+	const auto write = [](double value) {
+		auto writer = StreamWriter::create(std::make_unique<std::stringstream>(), TestMDWriter::dummy_md(),
+		                                   reven::jsonresource::OutputFormat{0, 4, true});
+		writer.key("a").value(value);
+		auto stream = std::move(writer).finalize();
+		const auto text = static_cast<std::stringstream&>(*stream).str();
+		const auto begin = text.find("\"a\":") + 4;
+		return text.substr(begin, text.size() - begin - 2);
+	};
+
+	// Shortest text that reads back as the same value
+	BOOST_CHECK_EQUAL(write(0.1), "0.1");
+	BOOST_CHECK_EQUAL(write(-2.5e-300), "-2.5e-300");
+	BOOST_CHECK_EQUAL(std::stod(write(1.0 / 3)), 1.0 / 3);
+
+	// The decimal point does not depend on the locale
+	const std::string previous = std::setlocale(LC_NUMERIC, nullptr);
+	for (const auto locale : {"de_DE.UTF-8", "fr_FR.UTF-8", "de_DE", "fr_FR"}) {
+		if (std::setlocale(LC_NUMERIC, locale) != nullptr) {
+			BOOST_CHECK_EQUAL(write(0.5), "0.5");
+			break;
+		}
+	}
+	std::setlocale(LC_NUMERIC, previous.c_str());
+}
@@ -1,7 +1,15 @@
 #define BOOST_TEST_MODULE RVN_JSONRESOURCE_WRITER
 #include <boost/test/unit_test.hpp>
 
+#include <csignal>
+#include <cstdlib>
+#include <future>
+#include <new>
 #include <sstream>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "common.h"
 #include "metadata.h"
@@ -29,6 +37,9 @@ BOOST_AUTO_TEST_CASE(open_no_metadata)
 	init_json_file(tmp_file, no_metadata_json);
 
 	BOOST_CHECK_THROW(Writer::open(tmp_file.c_str()), reven::jsonresource::MissingMetadata);
+
+	init_json_file(tmp_file, "");
+	BOOST_CHECK_THROW(Writer::open(tmp_file.c_str()), reven::jsonresource::MissingMetadata);
 }
 
 BOOST_AUTO_TEST_CASE(open_no_metadata_version)
@@ -105,3 +116,545 @@ BOOST_AUTO_TEST_CASE(impossible_create_metadata)
 
 	BOOST_CHECK_THROW(Writer::create(tmp_file.c_str(), md), reven::jsonresource::WriterError);
 }
+
+BOOST_AUTO_TEST_CASE(arena_backend)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, valid_json);
+
+	const reven::jsonresource::WriterOptions options{reven::jsonresource::WriterBackend::arena};
+	auto md = TestMDWriter::dummy_md();
+	{
+		auto writer = Writer::create(tmp_file.c_str(), md, options);
+		BOOST_CHECK(writer.backend() == reven::jsonresource::WriterBackend::arena);
+	}
+	{
+		auto reader = Reader::open(tmp_file.c_str());
+		BOOST_CHECK_EQUAL(md, reader.metadata());
+		BOOST_CHECK_EQUAL(reader.json().get<std::string>("toto"), "0");
+	}
+
+	auto md2 = TestMDWriter::dummy_md2();
+	{
+		auto writer = Writer::open(tmp_file.c_str(), options);
+		writer.document().root().put("titi", "1");
+		writer.set_metadata(md2);
+	}
+	{
+		auto reader = Reader::open(tmp_file.c_str());
+		BOOST_CHECK_EQUAL(md2, reader.metadata());
+		BOOST_CHECK_EQUAL(reader.json().get<std::string>("titi"), "1");
+	}
+
+	BOOST_CHECK_THROW(Writer::create(tmp_file.c_str(), md, options), reven::jsonresource::WriterError);
+	init_json_file(tmp_file, incomplete_metadata_json);
+	BOOST_CHECK_THROW(Writer::open(tmp_file.c_str(), options), reven::jsonresource::MissingMetadataField);
+}
+
+BOOST_AUTO_TEST_CASE(backend_switch)
+{
+	pt::ptree json;
+	json.put("toto", "0");
+	auto writer = Writer::create(json, std::make_unique<std::stringstream>(), TestMDWriter::dummy_md());
+	BOOST_CHECK(writer.backend() == reven::jsonresource::WriterBackend::ptree);
+
+	writer.document().root().put("titi", "1");
+	BOOST_CHECK(writer.backend() == reven::jsonresource::WriterBackend::arena);
+
+	BOOST_CHECK_EQUAL(writer.json().get<std::string>("titi"), "1");
+	BOOST_CHECK_EQUAL(writer.json().get<std::string>("toto"), "0");
+	BOOST_CHECK(writer.backend() == reven::jsonresource::WriterBackend::ptree);
+}
+
+BOOST_AUTO_TEST_CASE(typed_document)
+{
+	for (const auto encoding : {reven::jsonresource::ResourceEncoding::json,
+	                            reven::jsonresource::ResourceEncoding::cbor}) {
+		reven::jsonresource::Document doc;
+		auto root = doc.root();
+		root.push_back("u").put_value(42u);
+		root.push_back("i").put_value(-42);
+		root.push_back("f").put_value(0.25);
+		root.push_back("b").put_value(false);
+		root.push_back("n").put_null();
+
+		reven::jsonresource::WriterOptions options;
+		options.encoding = encoding;
+		auto writer = Writer::create(std::move(doc), std::make_unique<std::stringstream>(), TestMDWriter::dummy_md(),
+		                             options);
+		auto stream = std::move(writer).finalize();
+		const auto content = static_cast<std::stringstream&>(*stream).str();
+		if (encoding == reven::jsonresource::ResourceEncoding::json) {
+			BOOST_CHECK_NE(content.find("\"type\": 42,"), std::string::npos);
+			BOOST_CHECK_NE(content.find("\"f\": 0.25,"), std::string::npos);
+		}
+
+		std::istringstream input(content);
+		const auto reader = Reader::open(input);
+		BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+		BOOST_CHECK_EQUAL(reader.json().get<unsigned>("u"), 42u);
+		BOOST_CHECK_EQUAL(reader.json().get<int>("i"), -42);
+		BOOST_CHECK_EQUAL(reader.json().get<double>("f"), 0.25);
+		BOOST_CHECK_EQUAL(reader.json().get<bool>("b"), false);
+		BOOST_CHECK_EQUAL(reader.json().get<std::string>("n"), "null");
+	}
+}
+
+BOOST_AUTO_TEST_CASE(patch_metadata)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, "{\"toto\": \"0\", \"titi\": [\"1\", \"2\"]}");
+
+	Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md());
+	const auto size = boost::filesystem::file_size(tmp_file);
+	boost::filesystem::permissions(tmp_file, boost::filesystem::owner_read | boost::filesystem::owner_write |
+	                                         boost::filesystem::group_read);
+
+	auto check = [&tmp_file](const MD& md) {
+		auto reader = Reader::open(tmp_file.c_str());
+		BOOST_CHECK_EQUAL(md, reader.metadata());
+		BOOST_CHECK_EQUAL(reader.json().get<std::string>("toto"), "0");
+		BOOST_CHECK_EQUAL(reader.json().get_child("titi").size(), 2);
+	};
+
+	// Fits in the padding
+	const auto md2 = TestMDWriter::custom_md({{"key", "value"}});
+	BOOST_CHECK(Writer::patch_metadata(tmp_file.c_str(), md2));
+	BOOST_CHECK_EQUAL(boost::filesystem::file_size(tmp_file), size);
+	check(md2);
+
+	// Too big, the resource is rewritten with a new padding
+	const auto md3 = TestMDWriter::custom_md({{"key", std::string(1000, 'a')}});
+	BOOST_CHECK(not Writer::patch_metadata(tmp_file.c_str(), md3));
+	check(md3);
+	BOOST_CHECK(boost::filesystem::status(tmp_file).permissions() ==
+	            (boost::filesystem::owner_read | boost::filesystem::owner_write | boost::filesystem::group_read));
+	BOOST_CHECK_EQUAL(std::distance(boost::filesystem::directory_iterator(tmp_dir.path),
+	                                boost::filesystem::directory_iterator()), 1);
+
+	BOOST_CHECK(Writer::patch_metadata(tmp_file.c_str(), TestMDWriter::dummy_md()));
+	check(TestMDWriter::dummy_md());
+}
+
+BOOST_AUTO_TEST_CASE(patch_metadata_errors)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+
+	BOOST_CHECK_THROW(Writer::patch_metadata(tmp_file.c_str(), TestMDWriter::dummy_md()),
+	                  reven::jsonresource::WriterError);
+
+	init_json_file(tmp_file, valid_json);
+	BOOST_CHECK_THROW(Writer::patch_metadata(tmp_file.c_str(), TestMDWriter::dummy_md()),
+	                  reven::jsonresource::MissingMetadata);
+
+	init_json_file(tmp_file, "{\"toto\": [");
+	BOOST_CHECK_THROW(Writer::patch_metadata(tmp_file.c_str(), TestMDWriter::dummy_md()),
+	                  reven::jsonresource::WriterError);
+
+	// Metadata written without padding by another tool
+	init_json_file(tmp_file, metadata_json);
+	const auto md = TestMDWriter::custom_md({{"key", "value"}});
+	BOOST_CHECK(not Writer::patch_metadata(tmp_file.c_str(), md));
+	BOOST_CHECK_EQUAL(Reader::open(tmp_file.c_str()).metadata(), md);
+}
+
+BOOST_AUTO_TEST_CASE(inject_metadata)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	const auto expected_file = (tmp_dir.path / "expected.json").generic_string();
+	const auto md = TestMDWriter::dummy_md();
+
+	// A resource in the layout of pt::write_json gives the same output as Writer::create
+	pt::ptree json;
+	json.put("toto.titi", "value");
+	json.put("tutu", "1");
+	{
+		std::ofstream stream(tmp_file);
+		pt::write_json(stream, json);
+	}
+	{
+		std::ofstream stream(expected_file);
+		pt::write_json(stream, json);
+	}
+	Writer::inject_metadata(tmp_file.c_str(), md);
+	Writer::create(expected_file.c_str(), md);
+
+	std::stringstream content;
+	content << std::ifstream(tmp_file).rdbuf();
+	std::stringstream expected;
+	expected << std::ifstream(expected_file).rdbuf();
+	BOOST_CHECK_EQUAL(content.str(), expected.str());
+
+	// The padding is reserved for in-place updates
+	BOOST_CHECK(Writer::patch_metadata(tmp_file.c_str(), TestMDWriter::dummy_md2()));
+
+	// Other members are kept as they are
+	init_json_file(tmp_file, "{\"a\":[1, 2],  \"b\" : {}}");
+	Writer::inject_metadata(tmp_file.c_str(), md);
+	content.str("");
+	content << std::ifstream(tmp_file).rdbuf();
+	BOOST_CHECK_NE(content.str().find(",\"a\":[1, 2],  \"b\" : {}}"), std::string::npos);
+	BOOST_CHECK_EQUAL(Reader::open(tmp_file.c_str()).metadata(), md);
+
+	for (const char* text : {"", "{}"}) {
+		init_json_file(tmp_file, text);
+		Writer::inject_metadata(tmp_file.c_str(), md);
+		auto reader = Reader::open(tmp_file.c_str());
+		BOOST_CHECK_EQUAL(reader.metadata(), md);
+		BOOST_CHECK_EQUAL(reader.json().size(), 1);
+	}
+
+	// The output is compressed and encoded as requested, compressed resources have no index
+	for (const auto encoding : {reven::jsonresource::ResourceEncoding::json,
+	                            reven::jsonresource::ResourceEncoding::cbor}) {
+		init_json_file(tmp_file, "{\"a\": [1, 2]}");
+		reven::jsonresource::WriterOptions options;
+		options.compression = reven::jsonresource::Compression::gzip;
+		options.encoding = encoding;
+		options.write_index = true;
+		Writer::inject_metadata(tmp_file.c_str(), md, options);
+		content.str("");
+		content << std::ifstream(tmp_file).rdbuf();
+		BOOST_CHECK_EQUAL(content.str().substr(0, 2), "\x1f\x8b");
+		BOOST_CHECK(not boost::filesystem::exists(tmp_file + ".idx"));
+		auto reader = Reader::open(tmp_file.c_str());
+		BOOST_CHECK_EQUAL(reader.metadata(), md);
+		BOOST_CHECK_EQUAL(reader.json().get_child("a").size(), 2);
+	}
+
+	// On error, the original file is left untouched
+	for (const char* text : {metadata_json, "{\"toto\": [", "[\"toto\"]", "{} {}"}) {
+		init_json_file(tmp_file, text);
+		BOOST_CHECK_THROW(Writer::inject_metadata(tmp_file.c_str(), md), reven::jsonresource::WriterError);
+		content.str("");
+		content << std::ifstream(tmp_file).rdbuf();
+		BOOST_CHECK_EQUAL(content.str(), text);
+	}
+	const auto files = std::distance(boost::filesystem::directory_iterator(tmp_dir.path),
+	                                 boost::filesystem::directory_iterator());
+	BOOST_CHECK_EQUAL(files, 2);
+}
+
+BOOST_AUTO_TEST_CASE(atomic_create)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	auto read_file = [&tmp_file]() {
+		std::stringstream content;
+		content << std::ifstream(tmp_file).rdbuf();
+		return content.str();
+	};
+	auto file_count = [&tmp_dir]() {
+		return std::distance(boost::filesystem::directory_iterator(tmp_dir.path),
+		                     boost::filesystem::directory_iterator());
+	};
+
+	std::string members;
+	for (int i = 0; i < 100000; ++i) {
+		members += (i == 0 ? "\"" : ", \"") + std::to_string(i) + "\": [\"value\", 1.5, true, null, {}]";
+	}
+
+	// The error is only found once most of the content is written: the original file is kept
+	const auto malformed = "{" + members + ", \"last\": [}";
+	init_json_file(tmp_file, malformed);
+	BOOST_CHECK_THROW(Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md()), reven::jsonresource::WriterError);
+	BOOST_CHECK(read_file() == malformed);
+	BOOST_CHECK_EQUAL(file_count(), 1);
+
+	const auto malformed_resource = std::string(metadata_json).substr(0, std::string(metadata_json).rfind('}')) + ", " +
+	                                members + ", \"last\": [}";
+	init_json_file(tmp_file, malformed_resource);
+	auto writer = Writer::open(tmp_file.c_str());
+	BOOST_CHECK_THROW(writer.set_metadata(TestMDWriter::dummy_md2()), reven::jsonresource::WriterError);
+	BOOST_CHECK(read_file() == malformed_resource);
+	BOOST_CHECK_EQUAL(file_count(), 1);
+
+	// The content is read when accessed, with the written metadata
+	init_json_file(tmp_file, "{" + members + "}");
+	auto created = Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md());
+	BOOST_CHECK_EQUAL(created.json().size(), 100001);
+	BOOST_CHECK_EQUAL(created.json().get_child("99999").front().second.data(), "value");
+	BOOST_CHECK_EQUAL(Reader::open(tmp_file.c_str()).metadata(), TestMDWriter::dummy_md());
+	BOOST_CHECK(created.output_stream() == nullptr);
+
+	// A symbolic link is kept, the file it points to is replaced
+	const auto link = (tmp_dir.path / "link.json").generic_string();
+	boost::filesystem::create_symlink(tmp_file, link);
+	Writer::open(link.c_str()).set_metadata(TestMDWriter::dummy_md2());
+	BOOST_CHECK(boost::filesystem::is_symlink(link));
+	BOOST_CHECK_EQUAL(Reader::open(tmp_file.c_str()).metadata(), TestMDWriter::dummy_md2());
+	BOOST_CHECK_EQUAL(file_count(), 2);
+	boost::filesystem::remove(link);
+
+	// A writer killed while writing leaves either the original file or the complete resource
+	for (const int delay_us : {0, 1000, 5000, 20000}) {
+		init_json_file(tmp_file, "{" + members + "}");
+		const auto pid = ::fork();
+		BOOST_REQUIRE(pid >= 0);
+		if (pid == 0) {
+			Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md());
+			::_exit(0);
+		}
+		::usleep(static_cast<useconds_t>(delay_us));
+		::kill(pid, SIGKILL);
+		::waitpid(pid, nullptr, 0);
+
+		pt::ptree json;
+		std::ifstream stream(tmp_file);
+		BOOST_REQUIRE_NO_THROW(pt::read_json(stream, json));
+		BOOST_CHECK_EQUAL(json.get_child("99999").front().second.data(), "value");
+		if (json.get_child_optional("metadata")) {
+			BOOST_CHECK_EQUAL(Reader::open(tmp_file.c_str()).metadata(), TestMDWriter::dummy_md());
+			BOOST_CHECK_EQUAL(json.size(), 100001);
+		} else {
+			BOOST_CHECK(read_file() == "{" + members + "}");
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(compression)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+
+	using reven::jsonresource::Compression;
+	const std::pair<Compression, std::string> magics[] = {
+		{Compression::gzip, "\x1f\x8b"}, {Compression::zlib, "\x78\xda"}, {Compression::bzip2, "BZh9"},
+	};
+
+	for (const auto& magic : magics) {
+		for (const auto encoding : {reven::jsonresource::ResourceEncoding::json,
+		                            reven::jsonresource::ResourceEncoding::cbor}) {
+			init_json_file(tmp_file, "{\"toto\": {\"titi\": [\"0\", \"1\"]}}");
+
+			reven::jsonresource::WriterOptions options;
+			options.compression = magic.first;
+			options.compression_level = 9;
+			options.encoding = encoding;
+			options.write_index = true;
+			Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md(), options);
+
+			std::stringstream content;
+			content << std::ifstream(tmp_file).rdbuf();
+			BOOST_CHECK_EQUAL(content.str().substr(0, magic.second.size()), magic.second);
+			BOOST_CHECK(not boost::filesystem::exists(tmp_file + ".idx"));
+
+			for (const bool memory_map : {false, true}) {
+				auto reader = Reader::open(tmp_file.c_str(), reven::jsonresource::ReaderOptions{memory_map});
+				BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+				BOOST_CHECK_EQUAL(reader.json().get_child("toto.titi").size(), 2);
+				BOOST_CHECK_EQUAL(reader.json().get_child("toto.titi").back().second.data(), "1");
+			}
+			BOOST_CHECK_EQUAL(Reader::peek_metadata(tmp_file.c_str()), TestMDWriter::dummy_md());
+
+			// Patched metadata can't be written in place, the resource keeps its compression and encoding
+			const auto md = TestMDWriter::custom_md({{"key", "value"}});
+			BOOST_CHECK(not Writer::patch_metadata(tmp_file.c_str(), md, options));
+			content.str("");
+			content << std::ifstream(tmp_file).rdbuf();
+			BOOST_CHECK_EQUAL(content.str().substr(0, magic.second.size()), magic.second);
+			{
+				auto reader = Reader::open(tmp_file.c_str());
+				BOOST_CHECK_EQUAL(reader.metadata(), md);
+				BOOST_CHECK_EQUAL(reader.json().get_child("toto.titi").back().second.data(), "1");
+			}
+
+			// Opened with the default options, the resource is written back uncompressed
+			Writer::open(tmp_file.c_str()).set_metadata(TestMDWriter::dummy_md2());
+			content.str("");
+			content << std::ifstream(tmp_file).rdbuf();
+			BOOST_CHECK_EQUAL(content.str().substr(0, 1), "{");
+			BOOST_CHECK_EQUAL(Reader::open(tmp_file.c_str()).metadata(), TestMDWriter::dummy_md2());
+		}
+	}
+}
+
+namespace {
+
+std::size_t allocation_count = 0;
+
+class NullBuffer : public std::streambuf {
+protected:
+	int overflow(int c) override { return c; }
+	std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+class NullStream : public std::ostream {
+public:
+	NullStream() : std::ostream(&buffer_) {}
+
+private:
+	NullBuffer buffer_;
+};
+
+pt::ptree big_json(std::size_t size)
+{
+	pt::ptree json;
+	for (std::size_t i = 0; i < size; ++i) {
+		json.put("key" + std::to_string(i), "a value long enough to not fit in the small string buffer");
+	}
+	return json;
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+	++allocation_count;
+	if (void* ptr = std::malloc(size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+BOOST_AUTO_TEST_CASE(move_without_copy)
+{
+	auto count_create = [](std::size_t size) {
+		auto json = big_json(size);
+		auto stream = std::make_unique<NullStream>();
+		const auto md = TestMDWriter::dummy_md();
+
+		const auto before = allocation_count;
+		auto writer = Writer::create(std::move(json), std::move(stream), md);
+		auto moved = std::move(writer);
+		const auto count = allocation_count - before;
+
+		BOOST_CHECK_EQUAL(moved.json().size(), size + 1);
+		return count;
+	};
+
+	auto count_open = [](std::size_t size) {
+		auto json = big_json(size);
+		TestMDWriter::dummy_md().write_metadata(json);
+		auto stream = std::make_unique<NullStream>();
+
+		const auto before = allocation_count;
+		auto writer = Writer::open(std::move(json), std::move(stream));
+		const auto count = allocation_count - before;
+
+		BOOST_CHECK_EQUAL(writer.json().size(), size + 1);
+		return count;
+	};
+
+	BOOST_CHECK_EQUAL(count_create(10), count_create(10000));
+	BOOST_CHECK_EQUAL(count_open(10), count_open(10000));
+}
+
+BOOST_AUTO_TEST_CASE(compact_output)
+{
+	transient_directory tmp_dir{};
+	const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+	init_json_file(tmp_file, "{\"toto\": {\"titi\": [\"0\", \"1\"]}}");
+
+	reven::jsonresource::WriterOptions options;
+	options.format.compact = true;
+	options.format.metadata_padding = 0;
+	Writer::create(tmp_file.c_str(), TestMDWriter::dummy_md(), options);
+
+	std::stringstream content;
+	content << std::ifstream(tmp_file).rdbuf();
+	BOOST_CHECK_EQUAL(content.str().find('\n'), content.str().size() - 1);
+	BOOST_CHECK_NE(content.str().find("\"toto\":{\"titi\":[\"0\",\"1\"]}"), std::string::npos);
+
+	auto reader = Reader::open(tmp_file.c_str());
+	BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md());
+	BOOST_CHECK_EQUAL(reader.json().get_child("toto.titi").size(), 2);
+
+	auto writer = Writer::create(pt::ptree(), std::make_unique<std::stringstream>(), TestMDWriter::dummy_md(),
+	                             options);
+	const auto& output = static_cast<std::stringstream&>(*writer.output_stream()).str();
+	BOOST_CHECK_EQUAL(output.find('\n'), output.size() - 1);
+}
+
+BOOST_AUTO_TEST_CASE(commit_async)
+{
+	// Each commit appends the whole resource to the stream, the last one is at the end
+	auto last_resource = [](Writer& writer) {
+		const auto output = static_cast<std::stringstream&>(*writer.output_stream()).str();
+		std::istringstream input(output.substr(output.rfind("{\n    \"metadata\"")));
+		return Reader::open(input);
+	};
+
+	for (const auto backend : {reven::jsonresource::WriterBackend::ptree, reven::jsonresource::WriterBackend::arena}) {
+		pt::ptree json;
+		json.put("toto", "0");
+		auto writer = Writer::create(std::move(json), std::make_unique<std::stringstream>(), TestMDWriter::dummy_md());
+		if (backend == reven::jsonresource::WriterBackend::arena) {
+			writer.document();
+		}
+
+		// The content can be modified as soon as the commit is requested
+		auto done = writer.commit_async(TestMDWriter::dummy_md2());
+		if (backend == reven::jsonresource::WriterBackend::ptree) {
+			writer.json().put("toto", "1");
+		} else {
+			writer.document().root().erase("toto");
+		}
+		BOOST_CHECK_NO_THROW(done.get());
+
+		auto reader = last_resource(writer);
+		BOOST_CHECK_EQUAL(reader.metadata(), TestMDWriter::dummy_md2());
+		BOOST_CHECK_EQUAL(reader.json().get<std::string>("toto"), "0");
+		if (backend == reven::jsonresource::WriterBackend::ptree) {
+			BOOST_CHECK_EQUAL(writer.json().get<std::string>("toto"), "1");
+		} else {
+			BOOST_CHECK(not writer.document().root().get_child_optional("toto"));
+		}
+
+		// Once the commit is written, the writer takes its content back without copying it
+		if (backend == reven::jsonresource::WriterBackend::ptree) {
+			const auto node = &writer.json().get_child("toto");
+			writer.commit_async(TestMDWriter::dummy_md()).get();
+			BOOST_CHECK_EQUAL(&writer.json().get_child("toto"), node);
+		}
+
+		// The last commit wins, every future is ready once it is written
+		std::vector<std::future<void>> commits;
+		for (int i = 0; i < 10; ++i) {
+			commits.push_back(writer.commit_async(i % 2 == 0 ? TestMDWriter::dummy_md2() : TestMDWriter::dummy_md()));
+		}
+		for (auto& commit : commits) {
+			BOOST_CHECK_NO_THROW(commit.get());
+		}
+		BOOST_CHECK_EQUAL(last_resource(writer).metadata(), TestMDWriter::dummy_md());
+
+		// Synchronous writes come after the pending commits
+		writer.commit_async(TestMDWriter::dummy_md());
+		writer.set_metadata(TestMDWriter::dummy_md2());
+		BOOST_CHECK_EQUAL(last_resource(writer).metadata(), TestMDWriter::dummy_md2());
+	}
+
+	// Errors are reported through the future
+	{
+		auto writer = Writer::create(pt::ptree(), std::make_unique<std::stringstream>(), TestMDWriter::dummy_md());
+		writer.output_stream()->setstate(std::ios::badbit);
+		auto done = writer.commit_async(TestMDWriter::dummy_md2());
+		BOOST_CHECK_THROW(done.get(), reven::jsonresource::WriteMetadataError);
+	}
+
+	// Destroying the writer waits for its pending commits
+	{
+		transient_directory tmp_dir{};
+		const auto tmp_file = (tmp_dir.path / "foo.json").generic_string();
+		init_json_file(tmp_file, metadata_json);
+		{
+			auto writer = Writer::open(tmp_file.c_str());
+			writer.commit_async(TestMDWriter::dummy_md2());
+		}
+		BOOST_CHECK_EQUAL(Reader::open(tmp_file.c_str()).metadata(), TestMDWriter::dummy_md2());
+	}
+}